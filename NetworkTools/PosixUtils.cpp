@@ -0,0 +1,13 @@
+#include "pch.h"
+
+#include <ctime>
+
+#include "XivAlexanderCommon/Utils/Utils.h"
+
+// Counterparts of Windows-only parts of XivAlexanderCommon/Utils/Utils.cpp.
+
+int64_t Utils::QpcUs() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,987 @@
+#include "pch.h"
+
+#include <csignal>
+#include <deque>
+#include <random>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <XivAlexanderCommon/Sqex/Network/AnimationLockTracker.h>
+#include <XivAlexanderCommon/Sqex/Network/BundleStream.h>
+#include <XivAlexanderCommon/Utils/LatencyHistogram.h>
+#include <XivAlexanderCommon/Utils/NumericStatisticsTracker.h>
+#include <XivAlexanderCommon/Utils/Utils.h>
+
+#include "SyntheticTraffic.h"
+
+using namespace Sqex::Network;
+using namespace Sqex::Network::Structure;
+
+// Usage:
+// Proxy proxy <listen host:port> <upstream host:port> [options]
+// Proxy server <listen host:port> [options]
+// Proxy client <host:port> [options]
+//
+// proxy relays game connections, and rewrites animation lock durations the same way XivAlexander does in the game.
+// One thread serves every connection with edge-triggered epoll. Data is received into and sent from the ring buffers
+// of BundleStream, so nothing is copied other than by bundles being decoded and encoded again.
+// Bundles compressed with Oodle cannot be decoded here, as the game's Oodle is only available on Windows; such bundles
+// are passed through untouched.
+//
+// server and client exchange synthetic traffic (see SyntheticTraffic.h), so that proxy can be tried without the game.
+// server holds each response for a round trip time of its own, so use --latency estimate on a loopback interface:
+//   Proxy server 127.0.0.1:55021 --rtt-ms 150 &
+//   Proxy proxy 127.0.0.1:55020 127.0.0.1:55021 --latency estimate &
+//   Proxy client 127.0.0.1:55020 --connections 16 --seconds 30
+
+static volatile std::sig_atomic_t s_stopRequested = 0;
+
+[[noreturn]] static void ThrowErrno(const char* what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+static void WarnToStderr(const std::string& s) {
+	std::cerr << s << std::endl;
+}
+
+static std::string DescribePercentiles(const Utils::LatencyHistogram& histogram) {
+	const auto snapshot = histogram.TakeSnapshot();
+	return std::format("p50 {}us, p90 {}us, p99 {}us, max {}us",
+		snapshot.ValueAtPercentile(50), snapshot.ValueAtPercentile(90), snapshot.ValueAtPercentile(99), snapshot.Max());
+}
+
+class FileDescriptor {
+	int m_fd;
+
+public:
+	explicit FileDescriptor(int fd = -1)
+		: m_fd(fd) {
+	}
+
+	FileDescriptor(FileDescriptor&& r) noexcept
+		: m_fd(std::exchange(r.m_fd, -1)) {
+	}
+
+	FileDescriptor& operator=(FileDescriptor&& r) noexcept {
+		if (this != &r) {
+			Close();
+			m_fd = std::exchange(r.m_fd, -1);
+		}
+		return *this;
+	}
+
+	FileDescriptor(const FileDescriptor&) = delete;
+	FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+	~FileDescriptor() {
+		Close();
+	}
+
+	void Close() {
+		if (m_fd != -1)
+			::close(m_fd);
+		m_fd = -1;
+	}
+
+	operator int() const {
+		return m_fd;
+	}
+};
+
+struct SocketAddress {
+	sockaddr_storage Storage{};
+	socklen_t Length = 0;
+
+	static SocketAddress Resolve(const std::string& hostAndPort) {
+		const auto colon = hostAndPort.rfind(':');
+		if (colon == std::string::npos)
+			throw std::invalid_argument(std::format("Expected host:port, got {}", hostAndPort));
+
+		auto host = hostAndPort.substr(0, colon);
+		if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+			host = host.substr(1, host.size() - 2);
+		const auto port = hostAndPort.substr(colon + 1);
+
+		addrinfo hints{};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* result = nullptr;
+		if (const auto err = getaddrinfo(host.c_str(), port.c_str(), &hints, &result))
+			throw std::runtime_error(std::format("Failed to resolve {}: {}", hostAndPort, gai_strerror(err)));
+
+		SocketAddress address;
+		memcpy(&address.Storage, result->ai_addr, result->ai_addrlen);
+		address.Length = result->ai_addrlen;
+		freeaddrinfo(result);
+		return address;
+	}
+
+	[[nodiscard]] const sockaddr* Get() const {
+		return reinterpret_cast<const sockaddr*>(&Storage);
+	}
+};
+
+static FileDescriptor CreateSocket(const SocketAddress& address) {
+	FileDescriptor fd(socket(address.Storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP));
+	if (fd == -1)
+		ThrowErrno("socket");
+	return fd;
+}
+
+static void SetNoDelay(int fd) {
+	constexpr int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+}
+
+static FileDescriptor Listen(const SocketAddress& address) {
+	auto fd = CreateSocket(address);
+	constexpr int one = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+	if (bind(fd, address.Get(), address.Length))
+		ThrowErrno("bind");
+	if (listen(fd, SOMAXCONN))
+		ThrowErrno("listen");
+	return fd;
+}
+
+static FileDescriptor Connect(const SocketAddress& address) {
+	auto fd = CreateSocket(address);
+	SetNoDelay(fd);
+	if (connect(fd, address.Get(), address.Length) && errno != EINPROGRESS)
+		ThrowErrno("connect");
+	return fd;
+}
+
+// Returns an invalid descriptor once there is nothing more to accept.
+static FileDescriptor Accept(int listener) {
+	while (true) {
+		FileDescriptor fd(accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC));
+		if (fd != -1) {
+			SetNoDelay(fd);
+			return fd;
+		}
+		if (errno == EINTR || errno == ECONNABORTED)
+			continue;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			WarnToStderr(std::format("accept: {}", strerror(errno)));
+		return fd;
+	}
+}
+
+static int GetSocketError(int fd) {
+	int err = 0;
+	socklen_t length = sizeof err;
+	if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &length))
+		return errno;
+	return err;
+}
+
+/*
+ * Single threaded epoll loop with timers.
+ * Sockets are registered edge-triggered, so handlers must read or write until EAGAIN.
+ * Handlers must stay alive until the batch of events being dispatched is done; use Defer to destroy them.
+ */
+class EventLoop {
+public:
+	using Handler = std::function<void(uint32_t events)>;
+
+private:
+	FileDescriptor m_epoll;
+	std::multimap<int64_t, std::function<void()>> m_timers;
+	std::vector<std::function<void()>> m_deferred;
+
+	void RunDeferred() {
+		while (!m_deferred.empty()) {
+			auto deferred = std::move(m_deferred);
+			m_deferred.clear();
+			for (const auto& fn : deferred)
+				fn();
+		}
+	}
+
+public:
+	EventLoop()
+		: m_epoll(epoll_create1(EPOLL_CLOEXEC)) {
+		if (m_epoll == -1)
+			ThrowErrno("epoll_create1");
+	}
+
+	void Add(int fd, Handler& handler, uint32_t events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET) {
+		epoll_event ev{};
+		ev.events = events;
+		ev.data.ptr = &handler;
+		if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev))
+			ThrowErrno("epoll_ctl");
+	}
+
+	void At(int64_t timeUs, std::function<void()> fn) {
+		m_timers.emplace(timeUs, std::move(fn));
+	}
+
+	void Defer(std::function<void()> fn) {
+		m_deferred.emplace_back(std::move(fn));
+	}
+
+	void Run(int64_t untilUs) {
+		epoll_event events[256];
+		while (!s_stopRequested) {
+			const auto nowUs = Utils::QpcUs();
+			while (!m_timers.empty() && m_timers.begin()->first <= nowUs) {
+				const auto fn = std::move(m_timers.begin()->second);
+				m_timers.erase(m_timers.begin());
+				fn();
+			}
+			RunDeferred();
+			if (nowUs >= untilUs)
+				break;
+
+			const auto nextUs = m_timers.empty() ? untilUs : std::min(untilUs, m_timers.begin()->first);
+			const auto timeoutMs = static_cast<int>(std::clamp<int64_t>((nextUs - nowUs + 999) / 1000, 0, 1000));
+			const auto count = epoll_wait(m_epoll, events, static_cast<int>(std::size(events)), timeoutMs);
+			if (count == -1) {
+				if (errno == EINTR)
+					continue;
+				ThrowErrno("epoll_wait");
+			}
+			for (int i = 0; i < count; ++i)
+				(*static_cast<Handler*>(events[i].data.ptr))(events[i].events);
+			RunDeferred();
+		}
+	}
+};
+
+struct ProxyOptions {
+	std::vector<uint16_t> ActionRequestOpcodes{ SyntheticTraffic::ActionRequestOpcode };
+	std::vector<uint16_t> ActionEffectOpcodes{ SyntheticTraffic::ActionEffectOpcode };
+	uint16_t ActorControlSelfOpcode = SyntheticTraffic::ActorControlSelfOpcode;
+	uint16_t ActorControlOpcode = 0;
+	uint16_t ActorCastOpcode = 0;
+	bool UseSocketLatency = true;
+	AnimationLockTracker::Options Tracker{};
+};
+
+// One client connection and its connection to the upstream server.
+class ProxyConnection {
+	// Index of each socket, and of the data read from it; same as Capture::Direction.
+	static constexpr size_t Upstream = 0;
+	static constexpr size_t Downstream = 1;
+
+	// Stop reading from a side while this much processed data is waiting to be sent to the other side.
+	static constexpr size_t MaxPendingBytes = 4 * 1048576;
+
+	struct ReceivedBatch {
+		uint64_t EndOffset;  // In bytes ever written to the processed stream
+		int64_t ReceivedUs;
+		uint64_t BundleCount;
+	};
+
+	EventLoop& m_loop;
+	const ProxyOptions& m_options;
+	Utils::LatencyHistogram(&m_forwardingDelayUs)[2];
+	const std::function<void(ProxyConnection&)> m_onClose;
+
+	FileDescriptor m_sockets[2];
+	EventLoop::Handler m_handlers[2];
+	BundleStream::MessageMangler m_manglers[2];
+	bool m_connected = false;
+	bool m_closed = false;
+	bool m_readEnded[2]{};
+	bool m_readPaused[2]{};
+	bool m_writeShutdown[2]{};
+
+	BundleStream m_raw[2];
+	BundleStream m_processed[2];
+	uint64_t m_processedBytes[2]{};
+	uint64_t m_sentBytes[2]{};
+	std::deque<ReceivedBatch> m_receivedBatches[2];
+
+	AnimationLockTracker m_tracker;
+	Utils::NumericStatisticsTracker m_applicationLatencyUs{ 10, 0 };
+	std::unique_ptr<Utils::LatencyHistogram> m_addedLatencyUs[2];  // Without and with mitigation; allocated on first action
+	std::stringstream m_description;
+	int64_t m_nowUs = 0;
+
+public:
+	const uint64_t Id;
+
+	ProxyConnection(EventLoop& loop, uint64_t id, FileDescriptor downstream, const SocketAddress& upstream,
+		const ProxyOptions& options, Utils::LatencyHistogram(&forwardingDelayUs)[2], std::function<void(ProxyConnection&)> onClose)
+		: m_loop(loop)
+		, m_options(options)
+		, m_forwardingDelayUs(forwardingDelayUs)
+		, m_onClose(std::move(onClose))
+		, m_sockets{ Connect(upstream), std::move(downstream) }
+		, m_raw{ { std::format("{:x}_S2C_Raw", id), {}, WarnToStderr }, { std::format("{:x}_C2S_Raw", id), {}, WarnToStderr } }
+		, m_processed{ { std::format("{:x}_S2C_Processed", id), {}, WarnToStderr }, { std::format("{:x}_C2S_Processed", id), {}, WarnToStderr } }
+		, Id(id) {
+		m_manglers[Upstream] = [this](XivMessage* pMessage, bool& modified) { return HandleIncoming(pMessage, modified); };
+		m_manglers[Downstream] = [this](XivMessage* pMessage, bool&) { return HandleOutgoing(pMessage); };
+		for (const auto side : { Upstream, Downstream }) {
+			m_handlers[side] = [this, side](uint32_t events) { OnEvent(side, events); };
+			m_loop.Add(m_sockets[side], m_handlers[side]);
+		}
+	}
+
+	void Report(std::ostream& out) const {
+		out << std::format("Connection {:x}: S2C {} passed/{} re-encoded, C2S {} passed/{} re-encoded\n", Id,
+			m_raw[Upstream].PassedThroughBundleCount(), m_raw[Upstream].ReencodedBundleCount(),
+			m_raw[Downstream].PassedThroughBundleCount(), m_raw[Downstream].ReencodedBundleCount());
+		for (size_t i = 0; i < 2; ++i) {
+			if (m_addedLatencyUs[i]) {
+				out << std::format("\t{} actions {}: added latency {}\n",
+					m_addedLatencyUs[i]->Count(), i ? "with mitigation" : "without mitigation", DescribePercentiles(*m_addedLatencyUs[i]));
+			}
+		}
+	}
+
+private:
+	void OnEvent(size_t side, uint32_t events) {
+		if (m_closed)
+			return;
+
+		if (events & EPOLLERR) {
+			const auto err = GetSocketError(m_sockets[side]);
+			return Close(std::format("{}: {}", side == Upstream ? "upstream" : "downstream", strerror(err)));
+		}
+
+		if (side == Upstream && !m_connected) {
+			if (!(events & (EPOLLOUT | EPOLLHUP)))
+				return;
+			if (const auto err = GetSocketError(m_sockets[Upstream]))
+				return Close(std::format("connect: {}", strerror(err)));
+			m_connected = true;
+		}
+
+		if (events & EPOLLOUT) {
+			FlushTo(side);
+			if (m_closed)
+				return;
+			if (m_readPaused[1 - side] && m_processed[1 - side].Available() < MaxPendingBytes / 2)
+				ReadFrom(1 - side);
+		}
+
+		if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))
+			ReadFrom(side);
+	}
+
+	void ReadFrom(size_t side) {
+		if (m_closed || m_readEnded[side])
+			return;
+
+		auto& raw = m_raw[side];
+		auto& processed = m_processed[side];
+		m_readPaused[side] = false;
+		while (true) {
+			if (processed.Available() >= MaxPendingBytes) {
+				FlushTo(1 - side);
+				if (m_closed)
+					return;
+				if (processed.Available() >= MaxPendingBytes) {
+					m_readPaused[side] = true;
+					return;
+				}
+			}
+
+			auto writer = raw.Write();
+			const auto buf = writer.Allocate<uint8_t>(65536);
+			const auto length = recv(m_sockets[side], buf.data(), buf.size(), 0);
+			if (length == 0)
+				m_readEnded[side] = true;
+			else if (length > 0)
+				writer.Write(static_cast<size_t>(length));
+			else if (errno == EINTR)
+				continue;
+			else if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			else
+				return Close(std::format("recv: {}", strerror(errno)));
+
+			Tunnel(side);
+			if (m_readEnded[side]) {
+				// Whatever is left is not a complete bundle, and will never become one.
+				for (auto data = raw.Peek(); !data.empty(); data = raw.Peek()) {
+					processed.Write(data);
+					raw.Consume(data.size());
+				}
+				m_processedBytes[side] = m_sentBytes[side] + processed.Available();
+				break;
+			}
+		}
+		FlushTo(1 - side);
+	}
+
+	void Tunnel(size_t side) {
+		auto& raw = m_raw[side];
+		auto& processed = m_processed[side];
+		m_nowUs = Utils::QpcUs();
+
+		const auto bundlesBefore = raw.PassedThroughBundleCount() + raw.ReencodedBundleCount();
+		const auto availableBefore = processed.Available();
+		raw.TunnelXivStream(processed, m_manglers[side]);
+		m_processedBytes[side] += processed.Available() - availableBefore;
+		if (const auto bundleCount = raw.PassedThroughBundleCount() + raw.ReencodedBundleCount() - bundlesBefore)
+			m_receivedBatches[side].emplace_back(ReceivedBatch{ m_processedBytes[side], m_nowUs, bundleCount });
+	}
+
+	void FlushTo(size_t target) {
+		const auto source = 1 - target;
+		if (m_closed || (target == Upstream && !m_connected))
+			return;
+
+		auto& processed = m_processed[source];
+		while (processed.Available()) {
+			const auto data = processed.Peek();
+			const auto length = send(m_sockets[target], data.data(), data.size(), MSG_NOSIGNAL);
+			if (length > 0) {
+				processed.Consume(static_cast<size_t>(length));
+				m_sentBytes[source] += static_cast<size_t>(length);
+			} else if (errno == EINTR)
+				continue;
+			else if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			else
+				return Close(std::format("send: {}", strerror(errno)));
+		}
+
+		if (auto& batches = m_receivedBatches[source]; !batches.empty()) {
+			const auto nowUs = Utils::QpcUs();
+			for (; !batches.empty() && batches.front().EndOffset <= m_sentBytes[source]; batches.pop_front()) {
+				for (auto i = batches.front().BundleCount; i > 0; --i)
+					m_forwardingDelayUs[source].Record(nowUs - batches.front().ReceivedUs);
+			}
+		}
+
+		if (m_readEnded[source] && !processed.Available() && !m_writeShutdown[target]) {
+			shutdown(m_sockets[target], SHUT_WR);
+			m_writeShutdown[target] = true;
+			if (m_writeShutdown[source])
+				Close({});
+		}
+	}
+
+	void Close(const std::string& reason) {
+		if (m_closed)
+			return;
+		m_closed = true;
+		if (!reason.empty())
+			WarnToStderr(std::format("Connection {:x}: {}", Id, reason));
+		m_sockets[Upstream].Close();
+		m_sockets[Downstream].Close();
+		m_onClose(*this);
+	}
+
+	bool HandleOutgoing(XivMessage* pMessage) {
+		if (pMessage->Type != MessageType::Ipc || pMessage->Data.Ipc.Type != IpcType::InterestedType)
+			return true;
+
+		if (std::ranges::find(m_options.ActionRequestOpcodes, pMessage->Data.Ipc.SubType) != m_options.ActionRequestOpcodes.end()) {
+			const auto& actionRequest = pMessage->Data.Ipc.Data.C2S_ActionRequest;
+			m_tracker.OnActionRequest(actionRequest.ActionId, actionRequest.Sequence, m_nowUs);
+		}
+		return true;
+	}
+
+	bool HandleIncoming(XivMessage* pMessage, bool& modified) {
+		// Only interested in messages intended for the current player
+		if (pMessage->Type != MessageType::Ipc || pMessage->Data.Ipc.Type != IpcType::InterestedType || pMessage->CurrentActor != pMessage->SourceActor)
+			return true;
+
+		const auto subType = pMessage->Data.Ipc.SubType;
+		if (std::ranges::find(m_options.ActionEffectOpcodes, subType) != m_options.ActionEffectOpcodes.end()) {
+			auto& actionEffect = pMessage->Data.Ipc.Data.S2C_ActionEffect;
+			m_description.str({});
+			const auto result = m_tracker.OnActionEffect(
+				actionEffect.ActionId, actionEffect.SourceSequence, actionEffect.AnimationLockDurationUs(), m_nowUs,
+				m_options.Tracker,
+				[this](int64_t rttUs) { return MeasureLatency(rttUs); },
+				m_description);
+			if (result.Rewrite) {
+				actionEffect.AnimationLockDurationUs(result.WaitUs);
+				modified = true;
+			}
+
+			if (const auto& request = m_tracker.LatestSuccessfulRequest(); request && request->Sequence == actionEffect.SourceSequence) {
+				if (!m_addedLatencyUs[0]) {
+					m_addedLatencyUs[0] = std::make_unique<Utils::LatencyHistogram>(true);
+					m_addedLatencyUs[1] = std::make_unique<Utils::LatencyHistogram>(true);
+				}
+				const auto idealUs = request->RequestUs + result.OriginalWaitUs;
+				m_addedLatencyUs[0]->Record(m_nowUs + result.OriginalWaitUs - idealUs);
+				m_addedLatencyUs[1]->Record(m_nowUs + result.WaitUs - idealUs);
+			}
+
+		} else if (subType == m_options.ActorControlSelfOpcode) {
+			const auto& actorControlSelf = pMessage->Data.Ipc.Data.S2C_ActorControlSelf;
+			if (actorControlSelf.Category == S2C_ActorControlSelfCategory::ActionRejected)
+				m_tracker.OnActionRejected(actorControlSelf.Rollback.ActionId, actorControlSelf.Rollback.SourceSequence);
+
+		} else if (m_options.ActorControlOpcode && subType == m_options.ActorControlOpcode) {
+			const auto& actorControl = pMessage->Data.Ipc.Data.S2C_ActorControl;
+			if (actorControl.Category == S2C_ActorControlCategory::CancelCast)
+				m_tracker.OnCancelCast(actorControl.CancelCast.ActionId);
+
+		} else if (m_options.ActorCastOpcode && subType == m_options.ActorCastOpcode) {
+			m_tracker.OnCast(pMessage->Data.Ipc.Data.S2C_ActorCast.CastTimeUs());
+		}
+		return true;
+	}
+
+	AnimationLockTracker::LatencyInfo MeasureLatency(int64_t rttUs) {
+		m_applicationLatencyUs.AddValue(rttUs);
+
+		auto latencyUs = INT64_MAX;
+		if (m_options.UseSocketLatency) {
+			tcp_info info{};
+			socklen_t length = sizeof info;
+			if (!getsockopt(m_sockets[Upstream], IPPROTO_TCP, TCP_INFO, &info, &length))
+				latencyUs = std::max<int64_t>(static_cast<int64_t>(info.tcpi_rtt) - 20000, 1);  // Socket latency can be any higher value up to 40ms.
+		}
+
+		const auto [rttMeanUs, rttDeviationUs] = m_applicationLatencyUs.MeanAndDeviation();
+		return {
+			.LatencyUs = latencyUs,
+			.RttMinUs = m_applicationLatencyUs.Min(),
+			.RttMeanUs = rttMeanUs,
+			.RttDeviationUs = rttDeviationUs,
+		};
+	}
+};
+
+// A socket of the synthetic server or client. Sends whole bundles, and passes every received message to OnMessage.
+class SyntheticPeer {
+	EventLoop& m_loop;
+	FileDescriptor m_socket;
+	EventLoop::Handler m_handler;
+	BundleStream::MessageMangler m_mangler;
+	BundleStream m_received{ "Received", {}, WarnToStderr };
+	BundleStream m_sink{ "Sink", {}, WarnToStderr };
+	BundleStream m_outbox{ "Outbox", {}, WarnToStderr };
+	bool m_connected;
+	bool m_closed = false;
+
+public:
+	const uint64_t Id;
+	std::mt19937 Rng;
+	Utils::ZlibReusableDeflater Deflater;
+	std::function<void(const XivMessage&)> OnMessage;
+	std::function<void()> OnConnect;
+	std::function<void()> OnClose;
+
+	SyntheticPeer(EventLoop& loop, uint64_t id, FileDescriptor socket, bool connected)
+		: m_loop(loop)
+		, m_socket(std::move(socket))
+		, m_connected(connected)
+		, Id(id)
+		, Rng(static_cast<uint32_t>(id)) {
+		m_mangler = [this](XivMessage* pMessage, bool&) {
+			if (OnMessage)
+				OnMessage(*pMessage);
+			return true;
+		};
+		m_handler = [this](uint32_t events) { OnEvent(events); };
+		m_loop.Add(m_socket, m_handler);
+	}
+
+	[[nodiscard]] bool Closed() const {
+		return m_closed;
+	}
+
+	void Send(std::span<const uint8_t> data) {
+		if (m_closed)
+			return;
+		m_outbox.Write(data);
+		Flush();
+	}
+
+	template<typename T>
+	void SendIpc(uint16_t subType, const T& data) {
+		Send(SyntheticTraffic::MakeSingleIpcBundle(Deflater, EpochMs(), subType, data));
+	}
+
+	void SendNoise() {
+		Send(SyntheticTraffic::MakeBundle(Rng, Deflater, EpochMs()));
+	}
+
+private:
+	static int64_t EpochMs() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	void OnEvent(uint32_t events) {
+		if (m_closed)
+			return;
+
+		if (!m_connected) {
+			if (!(events & (EPOLLOUT | EPOLLHUP | EPOLLERR)))
+				return;
+			if (const auto err = GetSocketError(m_socket))
+				return Close(std::format("connect: {}", strerror(err)));
+			m_connected = true;
+			if (OnConnect)
+				OnConnect();
+		}
+
+		if (events & EPOLLOUT)
+			Flush();
+
+		if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+			while (!m_closed) {
+				auto writer = m_received.Write();
+				const auto buf = writer.Allocate<uint8_t>(65536);
+				const auto length = recv(m_socket, buf.data(), buf.size(), 0);
+				if (length == 0 || (length < 0 && errno == ECONNRESET))
+					return Close({});
+				if (length < 0) {
+					if (errno == EINTR)
+						continue;
+					if (errno == EAGAIN || errno == EWOULDBLOCK)
+						break;
+					return Close(std::format("recv: {}", strerror(errno)));
+				}
+				writer.Write(static_cast<size_t>(length));
+				m_received.TunnelXivStream(m_sink, m_mangler);
+				m_sink.Consume(m_sink.Available());
+			}
+		}
+	}
+
+	void Flush() {
+		while (!m_closed && m_connected && m_outbox.Available()) {
+			const auto data = m_outbox.Peek();
+			const auto length = send(m_socket, data.data(), data.size(), MSG_NOSIGNAL);
+			if (length > 0)
+				m_outbox.Consume(static_cast<size_t>(length));
+			else if (errno == EINTR)
+				continue;
+			else if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			else
+				return Close(std::format("send: {}", strerror(errno)));
+		}
+	}
+
+	void Close(const std::string& reason) {
+		m_closed = true;
+		if (!reason.empty())
+			WarnToStderr(std::format("Connection {:x}: {}", Id, reason));
+		m_socket.Close();
+		if (OnClose)
+			OnClose();
+	}
+};
+
+static std::vector<uint16_t> ParseOpcodes(const std::string& s) {
+	std::vector<uint16_t> opcodes;
+	std::stringstream ss(s);
+	for (std::string item; std::getline(ss, item, ',');)
+		opcodes.emplace_back(static_cast<uint16_t>(std::stoul(item, nullptr, 16)));
+	return opcodes;
+}
+
+static int64_t DeadlineAfterSeconds(double seconds) {
+	return seconds > 0 ? Utils::QpcUs() + static_cast<int64_t>(seconds * 1000000) : INT64_MAX;
+}
+
+static int Usage() {
+	std::cout << "Usage:\n"
+		"\tproxy <listen host:port> <upstream host:port> [options]\n"
+		"\t\t--latency socket|estimate        (default: socket; use estimate against a local stand-in server)\n"
+		"\t\t--mode subtract|rtt|normalized   (default: normalized)\n"
+		"\t\t--expected-lock-us <us>          (default: 75000)\n"
+		"\t\t--action-request <hex>[,<hex>...]\n"
+		"\t\t--action-effect <hex>[,<hex>...]\n"
+		"\t\t--actor-control-self <hex>\n"
+		"\t\t--actor-control <hex>\n"
+		"\t\t--actor-cast <hex>               (opcodes default to the synthetic ones)\n"
+		"\t\t--duration <seconds>             (default: until interrupted)\n"
+		"\tserver <listen host:port> [options]\n"
+		"\t\t--rtt-ms <ms>                    (default: 100)\n"
+		"\t\t--jitter-ms <ms>                 (default: 20)\n"
+		"\t\t--reject-every <n>               (default: 16; 0 to accept every action)\n"
+		"\t\t--duration <seconds>             (default: until interrupted)\n"
+		"\tclient <host:port> [options]\n"
+		"\t\t--connections <count>            (default: 4)\n"
+		"\t\t--seconds <seconds>              (default: 30)\n";
+	return -1;
+}
+
+static int RunProxy(const std::vector<std::string>& args) {
+	if (args.size() < 2)
+		return Usage();
+
+	const auto listenAddress = SocketAddress::Resolve(args[0]);
+	const auto upstreamAddress = SocketAddress::Resolve(args[1]);
+	ProxyOptions options;
+	double durationSeconds = 0;
+	for (size_t i = 2; i < args.size(); ++i) {
+		if (i + 1 == args.size())
+			return Usage();
+
+		const auto& name = args[i];
+		const auto& value = args[++i];
+		if (name == "--latency") {
+			if (value != "socket" && value != "estimate")
+				return Usage();
+			options.UseSocketLatency = value == "socket";
+		} else if (name == "--mode") {
+			if (value == "subtract")
+				options.Tracker.Mode = AnimationLockTracker::MitigationMode::SubtractLatency;
+			else if (value == "rtt")
+				options.Tracker.Mode = AnimationLockTracker::MitigationMode::SimulateRtt;
+			else if (value == "normalized")
+				options.Tracker.Mode = AnimationLockTracker::MitigationMode::SimulateNormalizedRttAndLatency;
+			else
+				return Usage();
+		} else if (name == "--expected-lock-us")
+			options.Tracker.ExpectedAnimationLockDurationUs = std::stoll(value);
+		else if (name == "--action-request")
+			options.ActionRequestOpcodes = ParseOpcodes(value);
+		else if (name == "--action-effect")
+			options.ActionEffectOpcodes = ParseOpcodes(value);
+		else if (name == "--actor-control-self")
+			options.ActorControlSelfOpcode = static_cast<uint16_t>(std::stoul(value, nullptr, 16));
+		else if (name == "--actor-control")
+			options.ActorControlOpcode = static_cast<uint16_t>(std::stoul(value, nullptr, 16));
+		else if (name == "--actor-cast")
+			options.ActorCastOpcode = static_cast<uint16_t>(std::stoul(value, nullptr, 16));
+		else if (name == "--duration")
+			durationSeconds = std::stod(value);
+		else
+			return Usage();
+	}
+
+	EventLoop loop;
+	const auto listener = Listen(listenAddress);
+	Utils::LatencyHistogram forwardingDelayUs[2];
+	std::map<uint64_t, std::unique_ptr<ProxyConnection>> connections;
+	uint64_t nextId = 1;
+
+	EventLoop::Handler onAccept = [&](uint32_t) {
+		for (auto fd = Accept(listener); fd != -1; fd = Accept(listener)) {
+			const auto id = nextId++;
+			try {
+				connections.emplace(id, std::make_unique<ProxyConnection>(loop, id, std::move(fd), upstreamAddress, options, forwardingDelayUs,
+					[&, id](ProxyConnection& conn) {
+						conn.Report(std::cout);
+						loop.Defer([&connections, id]() { connections.erase(id); });
+					}));
+			} catch (const std::exception& e) {
+				WarnToStderr(std::format("Connection {:x}: {}", id, e.what()));
+			}
+		}
+	};
+	loop.Add(listener, onAccept, EPOLLIN | EPOLLET);
+	std::cout << std::format("Relaying {} to {}\n", args[0], args[1]);
+
+	loop.Run(DeadlineAfterSeconds(durationSeconds));
+
+	for (const auto& conn : connections | std::views::values)
+		conn->Report(std::cout);
+	std::cout << std::format("Forwarding delay of {} S2C bundles: {}\n", forwardingDelayUs[0].Count(), DescribePercentiles(forwardingDelayUs[0]));
+	std::cout << std::format("Forwarding delay of {} C2S bundles: {}\n", forwardingDelayUs[1].Count(), DescribePercentiles(forwardingDelayUs[1]));
+	return 0;
+}
+
+// Answers action requests after a round trip time, and sends some other bundles in between.
+static int RunServer(const std::vector<std::string>& args) {
+	if (args.empty())
+		return Usage();
+
+	const auto listenAddress = SocketAddress::Resolve(args[0]);
+	int64_t rttUs = 100000, jitterUs = 20000;
+	uint32_t rejectEvery = 16;
+	double durationSeconds = 0;
+	for (size_t i = 1; i < args.size(); ++i) {
+		if (i + 1 == args.size())
+			return Usage();
+
+		const auto& name = args[i];
+		const auto& value = args[++i];
+		if (name == "--rtt-ms")
+			rttUs = std::stoll(value) * 1000;
+		else if (name == "--jitter-ms")
+			jitterUs = std::stoll(value) * 1000;
+		else if (name == "--reject-every")
+			rejectEvery = std::stoul(value);
+		else if (name == "--duration")
+			durationSeconds = std::stod(value);
+		else
+			return Usage();
+	}
+
+	EventLoop loop;
+	const auto listener = Listen(listenAddress);
+	std::map<uint64_t, std::unique_ptr<SyntheticPeer>> peers;
+	uint64_t nextId = 1;
+
+	std::function<void(uint64_t)> scheduleNoise = [&](uint64_t id) {
+		const auto& peer = peers.at(id);
+		loop.At(Utils::QpcUs() + peer->Rng() % 40000, [&, id]() {
+			if (const auto it = peers.find(id); it != peers.end() && !it->second->Closed()) {
+				it->second->SendNoise();
+				scheduleNoise(id);
+			}
+		});
+	};
+
+	EventLoop::Handler onAccept = [&](uint32_t) {
+		for (auto fd = Accept(listener); fd != -1; fd = Accept(listener)) {
+			const auto id = nextId++;
+			auto& peer = *peers.emplace(id, std::make_unique<SyntheticPeer>(loop, id, std::move(fd), true)).first->second;
+			peer.OnClose = [&, id]() { loop.Defer([&peers, id]() { peers.erase(id); }); };
+			peer.OnMessage = [&, id](const XivMessage& message) {
+				if (message.Type != MessageType::Ipc || message.Data.Ipc.SubType != SyntheticTraffic::ActionRequestOpcode)
+					return;
+
+				const auto request = message.Data.Ipc.Data.C2S_ActionRequest;
+				auto& p = *peers.at(id);
+				loop.At(Utils::QpcUs() + rttUs + (jitterUs ? p.Rng() % jitterUs : 0), [&, id, request]() {
+					const auto it = peers.find(id);
+					if (it == peers.end() || it->second->Closed())
+						return;
+
+					if (rejectEvery && request.Sequence % rejectEvery == 0) {
+						XivIpcs::S2C_ActorControlSelf rejection{};
+						rejection.Rollback.Category = S2C_ActorControlSelfCategory::ActionRejected;
+						rejection.Rollback.ActionId = request.ActionId;
+						rejection.Rollback.SourceSequence = request.Sequence;
+						it->second->SendIpc(SyntheticTraffic::ActorControlSelfOpcode, rejection);
+					} else {
+						XivIpcs::S2C_ActionEffect effect{};
+						effect.ActionId = request.ActionId;
+						effect.SourceSequence = request.Sequence;
+						effect.AnimationLockDurationUs(SyntheticTraffic::AnimationLockUs);
+						it->second->SendIpc(SyntheticTraffic::ActionEffectOpcode, effect);
+					}
+				});
+			};
+			scheduleNoise(id);
+		}
+	};
+	loop.Add(listener, onAccept, EPOLLIN | EPOLLET);
+	std::cout << std::format("Serving synthetic traffic at {}\n", args[0]);
+
+	loop.Run(DeadlineAfterSeconds(durationSeconds));
+	return 0;
+}
+
+// Uses an action whenever the previous one stops locking, and reports how much later than with zero latency that was.
+static int RunClient(const std::vector<std::string>& args) {
+	if (args.empty())
+		return Usage();
+
+	const auto address = SocketAddress::Resolve(args[0]);
+	uint32_t connectionCount = 4;
+	double seconds = 30;
+	for (size_t i = 1; i < args.size(); ++i) {
+		if (i + 1 == args.size())
+			return Usage();
+
+		const auto& name = args[i];
+		const auto& value = args[++i];
+		if (name == "--connections")
+			connectionCount = std::stoul(value);
+		else if (name == "--seconds")
+			seconds = std::stod(value);
+		else
+			return Usage();
+	}
+
+	struct ClientState {
+		std::unique_ptr<SyntheticPeer> Peer;
+		uint16_t Sequence = 0;
+		int64_t RequestUs = 0;
+		uint64_t RejectedCount = 0;
+		Utils::LatencyHistogram AddedLatencyUs{ true };
+	};
+
+	EventLoop loop;
+	std::vector<std::unique_ptr<ClientState>> clients;
+
+	const auto sendRequest = [&](ClientState& client) {
+		if (client.Peer->Closed())
+			return;
+		XivIpcs::C2S_ActionRequest request{};
+		request.ActionId = 0x1000 + client.Peer->Rng() % 0x100;
+		request.Sequence = ++client.Sequence;
+		client.RequestUs = Utils::QpcUs();
+		client.Peer->SendIpc(SyntheticTraffic::ActionRequestOpcode, request);
+	};
+
+	std::function<void(ClientState&)> scheduleNoise = [&](ClientState& client) {
+		loop.At(Utils::QpcUs() + client.Peer->Rng() % 400000, [&]() {
+			if (!client.Peer->Closed()) {
+				client.Peer->SendNoise();
+				scheduleNoise(client);
+			}
+		});
+	};
+
+	for (uint32_t i = 0; i < connectionCount; ++i) {
+		auto& client = *clients.emplace_back(std::make_unique<ClientState>());
+		client.Peer = std::make_unique<SyntheticPeer>(loop, i + 1, Connect(address), false);
+		client.Peer->OnConnect = [&]() {
+			sendRequest(client);
+			scheduleNoise(client);
+		};
+		client.Peer->OnMessage = [&](const XivMessage& message) {
+			if (message.Type != MessageType::Ipc)
+				return;
+
+			const auto nowUs = Utils::QpcUs();
+			if (message.Data.Ipc.SubType == SyntheticTraffic::ActionEffectOpcode) {
+				const auto& effect = message.Data.Ipc.Data.S2C_ActionEffect;
+				if (effect.SourceSequence != client.Sequence)
+					return;
+				const auto usableUs = nowUs + effect.AnimationLockDurationUs();
+				client.AddedLatencyUs.Record(usableUs - (client.RequestUs + SyntheticTraffic::AnimationLockUs));
+				loop.At(usableUs, [&]() { sendRequest(client); });
+
+			} else if (message.Data.Ipc.SubType == SyntheticTraffic::ActorControlSelfOpcode) {
+				const auto& rollback = message.Data.Ipc.Data.S2C_ActorControlSelf.Rollback;
+				if (rollback.Category != S2C_ActorControlSelfCategory::ActionRejected || rollback.SourceSequence != client.Sequence)
+					return;
+				client.RejectedCount++;
+				sendRequest(client);
+			}
+		};
+	}
+
+	loop.Run(DeadlineAfterSeconds(seconds));
+
+	for (const auto& client : clients) {
+		std::cout << std::format("Connection {:x}: {} actions ({:.2f}/s), {} rejected; added latency {}\n",
+			client->Peer->Id, client->AddedLatencyUs.Count(), static_cast<double>(client->AddedLatencyUs.Count()) / seconds,
+			client->RejectedCount, DescribePercentiles(client->AddedLatencyUs));
+	}
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	const auto args = std::vector<std::string>(argv + 1, argv + argc);
+	if (args.empty())
+		return Usage();
+
+	std::signal(SIGINT, [](int) { s_stopRequested = 1; });
+	std::signal(SIGTERM, [](int) { s_stopRequested = 1; });
+	std::signal(SIGPIPE, SIG_IGN);
+
+	try {
+		const auto rest = std::vector<std::string>(args.begin() + 1, args.end());
+		if (args[0] == "proxy")
+			return RunProxy(rest);
+		if (args[0] == "server")
+			return RunServer(rest);
+		if (args[0] == "client")
+			return RunClient(rest);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return -1;
+	}
+	return Usage();
+}
@@ -0,0 +1,308 @@
+#include "pch.h"
+
+#include <chrono>
+#include <map>
+#include <random>
+#include <thread>
+
+#include <XivAlexanderCommon/Sqex/Network/AnimationLockTracker.h>
+#include <XivAlexanderCommon/Sqex/Network/BundleStream.h>
+#include <XivAlexanderCommon/Sqex/Network/Capture.h>
+#include <XivAlexanderCommon/Sqex/Network/Structure.h>
+#include <XivAlexanderCommon/Utils/NumericStatisticsTracker.h>
+#include <XivAlexanderCommon/Utils/ZlibWrapper.h>
+
+#include "SyntheticTraffic.h"
+
+using namespace Sqex::Network;
+using namespace Sqex::Network::Structure;
+
+// Usage:
+// Replay generate <output.xacap> [connections=4] [seconds=60]
+// Replay replay <input.xacap> [paced] [modify-every=0]
+//
+// Builds as a part of ScratchProject on Windows, or with CMakeLists.txt in this directory elsewhere.
+//
+// Captures can also be recorded from the game by setting RecordNetworkCapture in runtime config.
+// Generated captures contain action request/effect pairs using the opcodes in SyntheticTraffic.h, with the simulated
+// round trip time growing with connection ID; replay runs them through AnimationLockTracker and reports how much later
+// than with zero latency the next action would have become usable.
+
+// Counts heap allocations, to check that steady state stream processing does not allocate per bundle.
+static size_t s_allocations = 0;
+
+void* operator new(size_t size) {
+	++s_allocations;
+	if (const auto p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
+
+static int Generate(const std::filesystem::path& path, uint32_t connectionCount, uint32_t seconds) {
+	struct PendingChunk {
+		uint64_t TimestampUs;
+		uint32_t ConnectionId;
+		Capture::Direction Direction;
+		std::vector<uint8_t> Data;
+	};
+	std::vector<PendingChunk> chunks;
+
+	struct TimedBundle {
+		uint64_t TimestampUs;
+		std::vector<uint8_t> Data;
+		bool Urgent;  // Sent as soon as possible instead of possibly waiting for the next bundle
+	};
+
+	std::mt19937 rng(0);
+	Utils::ZlibReusableDeflater deflater;
+	for (uint32_t connectionId = 1; connectionId <= connectionCount; ++connectionId) {
+		std::vector<TimedBundle> bundles[2];
+
+		// Action usage: a request whenever the previous animation lock would have ended, answered after the round trip
+		const auto rttUs = 30000ULL * connectionId;
+		uint16_t sequence = 0;
+		for (uint64_t requestUs = 1000000; requestUs < seconds * 1000000ULL; requestUs += SyntheticTraffic::AnimationLockUs + rng() % 200000) {
+			XivIpcs::C2S_ActionRequest request{};
+			request.ActionId = 0x1000 + rng() % 0x100;
+			request.Sequence = ++sequence;
+			bundles[static_cast<size_t>(Capture::Direction::Send)].emplace_back(TimedBundle{ requestUs,
+				SyntheticTraffic::MakeSingleIpcBundle(deflater, static_cast<int64_t>(requestUs / 1000), SyntheticTraffic::ActionRequestOpcode, request), true });
+
+			// Server processing delay and jitter
+			const auto responseUs = requestUs + rttUs + rng() % 20000;
+			XivIpcs::S2C_ActionEffect effect{};
+			effect.ActionId = request.ActionId;
+			effect.SourceSequence = request.Sequence;
+			effect.AnimationLockDurationUs(SyntheticTraffic::AnimationLockUs);
+			bundles[static_cast<size_t>(Capture::Direction::Recv)].emplace_back(TimedBundle{ responseUs,
+				SyntheticTraffic::MakeSingleIpcBundle(deflater, static_cast<int64_t>(responseUs / 1000), SyntheticTraffic::ActionEffectOpcode, effect), true });
+		}
+
+		for (const auto direction : { Capture::Direction::Recv, Capture::Direction::Send }) {
+			auto& directionBundles = bundles[static_cast<size_t>(direction)];
+
+			// Servers send far more than clients do
+			const auto averageIntervalUs = direction == Capture::Direction::Recv ? 20000 : 200000;
+			for (uint64_t timestampUs = rng() % averageIntervalUs; timestampUs < seconds * 1000000ULL; timestampUs += 1 + rng() % (2 * averageIntervalUs))
+				directionBundles.emplace_back(TimedBundle{ timestampUs, SyntheticTraffic::MakeBundle(rng, deflater, static_cast<int64_t>(timestampUs / 1000)), false });
+			std::ranges::stable_sort(directionBundles, {}, &TimedBundle::TimestampUs);
+
+			std::vector<uint8_t> pending;
+			for (const auto& bundle : directionBundles) {
+				pending.insert(pending.end(), bundle.Data.begin(), bundle.Data.end());
+
+				// Split into TCP segment sized pieces, sometimes leaving part of a bundle for later
+				while (!pending.empty()) {
+					const auto length = std::min<size_t>(pending.size(), rng() % 4 ? 1460 : 1 + rng() % 1460);
+					if (!bundle.Urgent && length < pending.size() && rng() % 8 == 0)
+						break;
+					chunks.emplace_back(PendingChunk{ bundle.TimestampUs, connectionId, direction, { pending.begin(), pending.begin() + length } });
+					pending.erase(pending.begin(), pending.begin() + length);
+				}
+			}
+			if (!pending.empty())
+				chunks.emplace_back(PendingChunk{ seconds * 1000000ULL, connectionId, direction, std::move(pending) });
+		}
+	}
+
+	std::ranges::stable_sort(chunks, {}, &PendingChunk::TimestampUs);
+
+	Capture::Writer writer(path);
+	uint64_t totalBytes = 0;
+	for (const auto& chunk : chunks) {
+		writer.Add(chunk.TimestampUs, chunk.ConnectionId, chunk.Direction, chunk.Data);
+		totalBytes += chunk.Data.size();
+	}
+	std::cout << std::format("Wrote {} chunks ({} bytes) to {}\n", chunks.size(), totalBytes, path.string());
+	return 0;
+}
+
+static int Replay(const std::filesystem::path& path, bool paced, uint32_t modifyEvery) {
+	const Capture::Reader reader(path);
+	const auto warn = [](const std::string& s) { std::cout << s << std::endl; };
+
+	struct Connection {
+		BundleStream Raw[2];
+		BundleStream Processed[2];
+		uint64_t Hash[2]{ 0xcbf29ce484222325ULL, 0xcbf29ce484222325ULL };
+
+		AnimationLockTracker Tracker{};
+		Utils::NumericStatisticsTracker ApplicationLatencyUs{ 10, 0 };
+		std::vector<int64_t> AddedLatencyUs[2]{};  // Without and with mitigation
+	};
+	std::map<uint32_t, std::unique_ptr<Connection>> connections;
+
+	const Capture::Chunk* pCurrentChunk = nullptr;
+	Connection* pCurrentConnection = nullptr;
+	const auto trackerOptions = AnimationLockTracker::Options{};
+	std::stringstream description;
+
+	uint64_t messageCounter = 0;
+	const auto handleMessage = [&](XivMessage* pMessage, bool& modified) {
+		if (pMessage->Type == MessageType::Ipc && pMessage->Data.Ipc.Type == IpcType::InterestedType) {
+			auto& conn = *pCurrentConnection;
+			const auto nowUs = static_cast<int64_t>(pCurrentChunk->TimestampUs);
+
+			if (pMessage->Data.Ipc.SubType == SyntheticTraffic::ActionRequestOpcode && pCurrentChunk->Direction == Capture::Direction::Send) {
+				const auto& request = pMessage->Data.Ipc.Data.C2S_ActionRequest;
+				conn.Tracker.OnActionRequest(request.ActionId, request.Sequence, nowUs);
+
+			} else if (pMessage->Data.Ipc.SubType == SyntheticTraffic::ActionEffectOpcode && pCurrentChunk->Direction == Capture::Direction::Recv) {
+				auto& effect = pMessage->Data.Ipc.Data.S2C_ActionEffect;
+				description.str({});
+				const auto result = conn.Tracker.OnActionEffect(effect.ActionId, effect.SourceSequence, effect.AnimationLockDurationUs(), nowUs,
+					trackerOptions,
+					[&conn](int64_t rttUs) {
+						// No socket or ping measurements offline, so the tracker falls back to estimating from response times.
+						conn.ApplicationLatencyUs.AddValue(rttUs);
+						const auto [rttMeanUs, rttDeviationUs] = conn.ApplicationLatencyUs.MeanAndDeviation();
+						return AnimationLockTracker::LatencyInfo{
+							.RttMinUs = conn.ApplicationLatencyUs.Min(),
+							.RttMeanUs = rttMeanUs,
+							.RttDeviationUs = rttDeviationUs,
+						};
+					},
+					description);
+				if (result.Rewrite) {
+					effect.AnimationLockDurationUs(result.WaitUs);
+					modified = true;
+				}
+
+				if (const auto& request = conn.Tracker.LatestSuccessfulRequest(); request && request->Sequence == effect.SourceSequence) {
+					const auto idealUs = request->RequestUs + result.OriginalWaitUs;
+					conn.AddedLatencyUs[0].push_back(nowUs + result.OriginalWaitUs - idealUs);
+					conn.AddedLatencyUs[1].push_back(nowUs + result.WaitUs - idealUs);
+				}
+			}
+		}
+
+		// Touching a message forces the bundle to be encoded again.
+		if (modifyEvery && pMessage->Type == MessageType::Ipc && ++messageCounter % modifyEvery == 0)
+			modified = true;
+	};
+
+	// Allocations made while handling messages are not a part of stream processing.
+	size_t handlerAllocations = 0;
+	const BundleStream::MessageMangler mangler = [&](XivMessage* pMessage, bool& modified) {
+		const auto allocationsBefore = s_allocations;
+		handleMessage(pMessage, modified);
+		handlerAllocations += s_allocations - allocationsBefore;
+		return true;
+	};
+
+	std::vector<double> latenciesUs;
+	std::vector<uint8_t> drain;
+	uint64_t totalBytes = 0;
+
+	// Connections are set up and buffers grow to their working sizes in the first chunks; only count what comes after.
+	const auto warmUpChunkCount = reader.Chunks().size() / 10;
+	size_t chunkIndex = 0, steadyBundleCount = 0, steadyAllocations = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (const auto& chunk : reader.Chunks()) {
+		if (paced)
+			std::this_thread::sleep_until(start + std::chrono::microseconds(chunk.TimestampUs));
+
+		auto& conn = connections[chunk.ConnectionId];
+		if (!conn) {
+			const auto name = std::format("{:x}", chunk.ConnectionId);
+			conn.reset(new Connection{
+				.Raw = { { name + "_S2C_Raw", {}, warn }, { name + "_C2S_Raw", {}, warn } },
+				.Processed = { { name + "_S2C_Processed", {}, warn }, { name + "_C2S_Processed", {}, warn } },
+				.Tracker = AnimationLockTracker(),
+				.AddedLatencyUs = {},
+			});
+		}
+
+		const auto dir = static_cast<size_t>(chunk.Direction);
+		auto& raw = conn->Raw[dir];
+		auto& processed = conn->Processed[dir];
+		const auto bundlesBefore = raw.PassedThroughBundleCount() + raw.ReencodedBundleCount();
+		pCurrentChunk = &chunk;
+		pCurrentConnection = conn.get();
+
+		const auto allocationsBefore = s_allocations;
+		const auto handlerAllocationsBefore = handlerAllocations;
+		const auto chunkStart = std::chrono::steady_clock::now();
+		raw.Write(chunk.Data.data(), chunk.Data.size());
+		raw.TunnelXivStream(processed, mangler);
+		const auto latencyUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - chunkStart).count();
+		if (chunkIndex++ >= warmUpChunkCount) {
+			steadyAllocations += s_allocations - allocationsBefore - (handlerAllocations - handlerAllocationsBefore);
+			steadyBundleCount += raw.PassedThroughBundleCount() + raw.ReencodedBundleCount() - bundlesBefore;
+		}
+
+		// Every bundle completed by this chunk waited for the whole tunneling call
+		for (auto i = raw.PassedThroughBundleCount() + raw.ReencodedBundleCount(); i > bundlesBefore; --i)
+			latenciesUs.push_back(latencyUs);
+
+		drain.resize(processed.Available());
+		processed.Read(drain.data(), drain.size());
+		for (const auto b : drain)
+			conn->Hash[dir] = (conn->Hash[dir] ^ b) * 0x100000001b3ULL;
+
+		totalBytes += chunk.Data.size();
+	}
+	const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	const auto percentile = []<typename T>(const std::vector<T>& sorted, double p) {
+		return sorted.empty() ? T{} : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+	};
+	std::ranges::sort(latenciesUs);
+
+	std::cout << std::format("{} chunks, {} bytes, {} bundles in {:.3f}s: {:.2f}MB/s\n",
+		reader.Chunks().size(), totalBytes, latenciesUs.size(), elapsed, totalBytes / 1048576. / elapsed);
+	std::cout << std::format("Per-bundle latency: p50 {:.2f}us, p90 {:.2f}us, p99 {:.2f}us, p99.9 {:.2f}us, max {:.2f}us\n",
+		percentile(latenciesUs, 0.5), percentile(latenciesUs, 0.9), percentile(latenciesUs, 0.99), percentile(latenciesUs, 0.999),
+		latenciesUs.empty() ? 0. : latenciesUs.back());
+	std::cout << std::format("Heap allocations after warm-up, excluding message handling: {} over {} bundles ({:.4f} per bundle)\n",
+		steadyAllocations, steadyBundleCount, steadyBundleCount ? static_cast<double>(steadyAllocations) / steadyBundleCount : 0.);
+	for (const auto& [id, conn] : connections) {
+		std::cout << std::format("Connection {:x}: S2C {} passed/{} re-encoded, hash {:016x}; C2S {} passed/{} re-encoded, hash {:016x}\n",
+			id,
+			conn->Raw[0].PassedThroughBundleCount(), conn->Raw[0].ReencodedBundleCount(), conn->Hash[0],
+			conn->Raw[1].PassedThroughBundleCount(), conn->Raw[1].ReencodedBundleCount(), conn->Hash[1]);
+
+		for (size_t i = 0; i < 2; ++i) {
+			auto& added = conn->AddedLatencyUs[i];
+			if (added.empty())
+				continue;
+			std::ranges::sort(added);
+			std::cout << std::format("\t{} actions {}: added latency p50 {}us, p90 {}us, p99 {}us, max {}us\n",
+				added.size(), i ? "with mitigation" : "without mitigation",
+				percentile(added, 0.5), percentile(added, 0.9), percentile(added, 0.99), added.back());
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	const auto args = std::vector<std::string>(argv + 1, argv + argc);
+	try {
+		if (args.size() >= 2 && args[0] == "generate")
+			return Generate(args[1],
+				args.size() >= 3 ? std::stoul(args[2]) : 4,
+				args.size() >= 4 ? std::stoul(args[3]) : 60);
+
+		if (args.size() >= 2 && args[0] == "replay")
+			return Replay(args[1],
+				args.size() >= 3 && args[2] == "paced",
+				args.size() >= 4 ? std::stoul(args[3]) : 0);
+	} catch (const std::exception& e) {
+		std::cout << e.what() << std::endl;
+		return -1;
+	}
+
+	std::cout << "Usage:\n"
+		"\tgenerate <output.xacap> [connections=4] [seconds=60]\n"
+		"\treplay <input.xacap> [paced|fast] [modify-every=0]\n";
+	return -1;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstring>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <XivAlexanderCommon/Sqex/Network/Structure.h>
+#include <XivAlexanderCommon/Utils/ZlibWrapper.h>
+
+// Game-like traffic for tools in this directory. Opcodes change with every game patch, so made up ones are used.
+namespace SyntheticTraffic {
+	using namespace Sqex::Network::Structure;
+
+	constexpr uint16_t ActionRequestOpcode = 0x0010;
+	constexpr uint16_t ActionEffectOpcode = 0x0011;
+	constexpr uint16_t ActorControlSelfOpcode = 0x0012;
+	constexpr int64_t AnimationLockUs = 600000;
+
+	inline std::vector<uint8_t> EncodeBundle(Utils::ZlibReusableDeflater& deflater, int64_t timestampMs, std::span<const uint8_t> body, uint16_t messageCount) {
+		const auto encoded = deflater(body);
+		XivBundleHeader header{};
+		memcpy(header.Magic, XivBundle::MagicConstant1, sizeof header.Magic);
+		header.Timestamp = timestampMs;
+		header.TotalLength = static_cast<uint32_t>(sizeof header + encoded.size());
+		header.MessageCount = messageCount;
+		header.CompressionType = CompressionType::Deflate;
+		header.DecodedBodyLength = static_cast<uint32_t>(body.size());
+
+		std::vector<uint8_t> bundle(header.TotalLength);
+		memcpy(&bundle[0], &header, sizeof header);
+		memcpy(&bundle[sizeof header], encoded.data(), encoded.size());
+		return bundle;
+	}
+
+	template<typename T>
+	std::vector<uint8_t> MakeSingleIpcBundle(Utils::ZlibReusableDeflater& deflater, int64_t timestampMs, uint16_t subType, const T& data) {
+		const auto length = static_cast<uint32_t>(sizeof(XivMessageHeader) + sizeof(XivIpcHeader) + sizeof data);
+		std::vector<uint8_t> body(length);
+		auto& message = *reinterpret_cast<XivMessage*>(&body[0]);
+		message.Length = length;
+		message.SourceActor = message.CurrentActor = 1;
+		message.Type = MessageType::Ipc;
+		message.Data.Ipc.Type = IpcType::InterestedType;
+		message.Data.Ipc.SubType = subType;
+		memcpy(&body[sizeof(XivMessageHeader) + sizeof(XivIpcHeader)], &data, sizeof data);
+		return EncodeBundle(deflater, timestampMs, body, 1);
+	}
+
+	inline std::vector<uint8_t> MakeBundle(std::mt19937& rng, Utils::ZlibReusableDeflater& deflater, int64_t timestampMs) {
+		std::vector<uint8_t> body;
+		const auto messageCount = static_cast<uint16_t>(1 + rng() % 8);
+		for (uint16_t i = 0; i < messageCount; ++i) {
+			// Mostly small messages, sometimes large ones like inventory or party lists
+			const auto payloadLength = rng() % 16 ? 8 * (rng() % 16) : 8 * (64 + rng() % 256);
+			const auto length = static_cast<uint32_t>(sizeof(XivMessageHeader) + sizeof(XivIpcHeader) + payloadLength);
+			const auto offset = body.size();
+			body.resize(offset + length);
+			auto& message = *reinterpret_cast<XivMessage*>(&body[offset]);
+			message.Length = length;
+			message.Type = rng() % 32 ? MessageType::Ipc : MessageType::ServerKeepAlive;
+			message.Data.Ipc.Type = IpcType::InterestedType;
+			message.Data.Ipc.SubType = static_cast<uint16_t>(0x100 + rng() % 0x300);
+			for (auto j = offset + sizeof(XivMessageHeader) + sizeof(XivIpcHeader); j < body.size(); ++j)
+				body[j] = static_cast<uint8_t>(rng() % 3 ? 0 : rng());
+		}
+
+		return EncodeBundle(deflater, timestampMs, body, messageCount);
+	}
+}
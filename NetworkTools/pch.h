@@ -0,0 +1,34 @@
+// pch.h: Common header for the tools in this directory, which build with CMake and without Windows SDK.
+// XivAlexanderCommon sources compiled here include this file instead of XivAlexanderCommon/pch.h.
+
+#pragma once
+
+#ifndef PCH_H
+#define PCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <ranges>
+#include <set>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define ZLIB_CONST
+#include <zlib.h>
+#include <nlohmann/json.hpp>
+
+#ifndef _WIN32
+#define __stdcall
+#endif
+
+#endif //PCH_H
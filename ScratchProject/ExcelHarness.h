@@ -0,0 +1,125 @@
+#pragma once
+
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <XivAlexanderCommon/Sqex.h>
+#include <XivAlexanderCommon/Sqex/Excel/Generator.h>
+#include <XivAlexanderCommon/Sqex/Sqpack.h>
+#include <XivAlexanderCommon/Utils/Utils.h>
+
+// Command line handling and generated sheets shared by the harnesses that read excel data from the game.
+namespace ExcelHarness {
+	constexpr auto DefaultGamePath = LR"(C:\Program Files (x86)\SquareEnix\FINAL FANTASY XIV - A Realm Reborn\game)";
+
+	using CompiledFiles = std::map<Sqex::Sqpack::EntryPathSpec, std::vector<char>, Sqex::Sqpack::EntryPathSpec::FullPathComparator>;
+
+	struct Option {
+		std::string Name;
+		std::string Description;
+	};
+
+	struct Arguments {
+		std::filesystem::path GamePath = DefaultGamePath;
+		std::vector<std::pair<std::string, std::string>> Values;  // In the order given, except for --game
+		std::string UsageText;
+
+		// Last value given for name, if any.
+		[[nodiscard]] std::optional<std::string> Find(const std::string& name) const {
+			for (auto it = Values.rbegin(); it != Values.rend(); ++it)
+				if (it->first == name)
+					return it->second;
+			return std::nullopt;
+		}
+
+		int Usage() const {
+			std::cout << UsageText;
+			return -1;
+		}
+	};
+
+	// Takes "--name value" pairs; --game is always accepted. Prints usage and returns nothing on anything else.
+	inline std::optional<Arguments> ParseArguments(int argc, char** argv, std::vector<Option> options) {
+		Arguments result;
+		result.UsageText = "Usage: [options]\n\t--game <path to game directory>\n";
+		for (const auto& option : options)
+			result.UsageText += std::format("\t{} {}\n", option.Name, option.Description);
+
+		const auto args = std::vector<std::string>(argv + 1, argv + argc);
+		for (size_t i = 0; i < args.size(); ++i) {
+			if (i + 1 == args.size()) {
+				result.Usage();
+				return std::nullopt;
+			}
+
+			const auto& name = args[i];
+			const auto& value = args[++i];
+			if (name == "--game")
+				result.GamePath = value;
+			else if (std::ranges::find(options, name, &Option::Name) != options.end())
+				result.Values.emplace_back(name, value);
+			else {
+				result.Usage();
+				return std::nullopt;
+			}
+		}
+		return result;
+	}
+
+	// Parses "<count>x<count>", as in "20x20000".
+	inline std::optional<std::pair<size_t, uint32_t>> ParseDimensions(const std::string& value) {
+		const auto split = Utils::StringSplit<std::string>(value, "x", 1);
+		if (split.size() != 2)
+			return std::nullopt;
+		return std::make_pair(static_cast<size_t>(std::stoul(split[0])), static_cast<uint32_t>(std::stoul(split[1])));
+	}
+
+	inline std::shared_ptr<Sqex::MemoryRandomAccessStream> OpenCompiled(const CompiledFiles& files, const Sqex::Sqpack::EntryPathSpec& pathSpec) {
+		const auto& data = files.at(pathSpec);
+		return std::make_shared<Sqex::MemoryRandomAccessStream>(std::vector<uint8_t>(data.begin(), data.end()));
+	}
+
+	// Every 6th column is a string, empty 1 time out of 4, and every 7th a packed bool; the rest are numbers.
+	// Rows are always in the first language, and missing from each other language 1 time out of 8.
+	inline CompiledFiles CreateSyntheticSheet(const std::string& name, size_t columnCount, uint32_t rowCount, std::span<const Sqex::Language> languages, std::mt19937& rng) {
+		static constexpr Sqex::Excel::Exh::ColumnDataType NumberTypes[]{ Sqex::Excel::Exh::UInt32, Sqex::Excel::Exh::Int16, Sqex::Excel::Exh::UInt8, Sqex::Excel::Exh::Float32 };
+
+		std::vector<Sqex::Excel::Exh::Column> columns(columnCount);
+		for (size_t i = 0; i < columns.size(); ++i) {
+			columns[i].Type = i % 6 == 0 ? Sqex::Excel::Exh::String : i % 7 == 0 ? Sqex::Excel::Exh::PackedBool0 : NumberTypes[i % 4];
+			columns[i].Offset = static_cast<uint16_t>(i * 4);
+		}
+
+		Sqex::Excel::Depth2ExhExdCreator creator(name, columns, Sqex::Excel::Exh::ExhFlag{});
+		for (const auto language : languages)
+			creator.AddLanguage(language);
+		std::vector<Sqex::Excel::ExdColumn> row(columns.size());
+		std::string text;
+		for (uint32_t id = 0; id < rowCount; ++id) {
+			for (const auto language : languages) {
+				if (language != languages.front() && rng() % 8 == 0)
+					continue;
+				for (size_t i = 0; i < columns.size(); ++i) {
+					row[i] = { .Type = columns[i].Type };
+					if (columns[i].Type == Sqex::Excel::Exh::String) {
+						text.resize(rng() % 4 ? 8 + rng() % 32 : 0);
+						for (auto& c : text)
+							c = static_cast<char>('a' + rng() % 26);
+						row[i].String = text;
+					} else {
+						row[i].ValidSize = 4;
+						row[i].uint32 = rng() % 1000;
+					}
+				}
+				creator.SetRow(id, language, row);
+			}
+		}
+		return creator.Compile();
+	}
+}
@@ -0,0 +1,68 @@
+#include "pch.h"
+
+#include <chrono>
+
+#include <XivAlexanderCommon/Sqex/Sqpack/BinaryEntryProvider.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/CompressionPolicy.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/EntryRawStream.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/ModelEntryProvider.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/RandomAccessStreamAsEntryProviderView.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/TextureEntryProvider.h>
+#include <XivAlexanderCommon/Sqex/ThirdParty/TexTools.h>
+
+// Usage: ScratchProject.exe <directory containing TTMPL.mpl and TTMPD.mpd>
+int wmain(int argc, wchar_t** argv) {
+	const auto ttmpDir = std::filesystem::path(argc >= 2 ? argv[1] : LR"(C:\Users\SP\AppData\Roaming\XivAlexander\TexToolsMods\Testing)");
+	const auto ttmpl = Sqex::ThirdParty::TexTools::TTMPL::FromStream(Sqex::FileRandomAccessStream(ttmpDir / "TTMPL.mpl"));
+	const auto ttmpd = std::make_shared<Sqex::FileRandomAccessStream>(ttmpDir / "TTMPD.mpd");
+
+	std::vector<std::tuple<Sqex::Sqpack::EntryPathSpec, Sqex::Sqpack::SqData::FileEntryType, std::shared_ptr<Sqex::MemoryRandomAccessStream>>> entries;
+	uint64_t rawTotal = 0;
+	ttmpl.ForEachEntry([&](const Sqex::ThirdParty::TexTools::ModEntry& entry) {
+		const auto provider = std::make_shared<Sqex::Sqpack::RandomAccessStreamAsEntryProviderView>(entry.FullPath, ttmpd, entry.ModOffset, entry.ModSize);
+		const auto rawStream = Sqex::Sqpack::EntryRawStream(provider);
+		const auto type = rawStream.EntryType();
+		if (type != Sqex::Sqpack::SqData::FileEntryType::Binary
+			&& type != Sqex::Sqpack::SqData::FileEntryType::Model
+			&& type != Sqex::Sqpack::SqData::FileEntryType::Texture)
+			return;
+		entries.emplace_back(entry.FullPath, type, std::make_shared<Sqex::MemoryRandomAccessStream>(rawStream.ReadStreamIntoVector<uint8_t>(0)));
+		rawTotal += std::get<2>(entries.back())->StreamSize();
+	});
+	std::cout << std::format("{} entries, {} bytes decoded\n", entries.size(), rawTotal);
+
+	for (const auto policy : {
+			Sqex::Sqpack::CompressionPolicy::None,
+			Sqex::Sqpack::CompressionPolicy::Fastest,
+			Sqex::Sqpack::CompressionPolicy::Balanced,
+			Sqex::Sqpack::CompressionPolicy::Maximum,
+		}) {
+		nlohmann::json policyName;
+		to_json(policyName, policy);
+
+		uint64_t outTotal = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (const auto& [pathSpec, type, raw] : entries) {
+			const auto level = Sqex::Sqpack::GetCompressionLevel(policy, type, raw->StreamSize());
+			std::unique_ptr<Sqex::Sqpack::EntryProvider> provider;
+			switch (type) {
+				case Sqex::Sqpack::SqData::FileEntryType::Model:
+					provider = std::make_unique<Sqex::Sqpack::MemoryModelEntryProvider>(pathSpec, raw, level);
+					break;
+				case Sqex::Sqpack::SqData::FileEntryType::Texture:
+					provider = std::make_unique<Sqex::Sqpack::MemoryTextureEntryProvider>(pathSpec, raw, level);
+					break;
+				default:
+					provider = std::make_unique<Sqex::Sqpack::MemoryBinaryEntryProvider>(pathSpec, raw, level);
+			}
+			outTotal += provider->ReadStreamIntoVector<uint8_t>(0).size();
+		}
+		const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << std::format("{:<10} {:>8.3f}s {:>14} bytes ({:>6.2f}%) {:>8.2f}MB/s\n",
+			policyName.get<std::string>(), elapsed, outTotal,
+			rawTotal ? outTotal * 100. / rawTotal : 0.,
+			elapsed > 0 ? rawTotal / 1048576. / elapsed : 0.);
+	}
+	return 0;
+}
@@ -0,0 +1,159 @@
+#include "pch.h"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <Psapi.h>
+#include <XivAlexanderCommon/Sqex/Excel/Generator.h>
+#include <XivAlexanderCommon/Sqex/Excel/Reader.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/EntryRawStream.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/Reader.h>
+#include "ExcelHarness.h"
+
+// Bytes currently allocated through operator new, so that the footprint of each representation can be told apart.
+static std::atomic<size_t> s_allocatedBytes;
+static std::atomic<size_t> s_allocationCount;
+
+void* operator new(size_t size) {
+	const auto p = static_cast<size_t*>(std::malloc(size + 16));
+	if (!p)
+		throw std::bad_alloc();
+	*p = size;
+	s_allocatedBytes += size;
+	s_allocationCount++;
+	return reinterpret_cast<char*>(p) + 16;
+}
+
+void operator delete(void* ptr) noexcept {
+	if (!ptr)
+		return;
+	const auto p = reinterpret_cast<size_t*>(static_cast<char*>(ptr) - 16);
+	s_allocatedBytes -= *p;
+	std::free(p);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	operator delete(ptr);
+}
+
+static size_t PrivateBytes() {
+	PROCESS_MEMORY_COUNTERS_EX pmc{ sizeof pmc };
+	GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&pmc), sizeof pmc);
+	return pmc.PrivateUsage;
+}
+
+struct Measurement {
+	size_t Bytes = s_allocatedBytes;
+	size_t Allocations = s_allocationCount;
+	size_t Private = PrivateBytes();
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+
+	void Report(const char* name) const {
+		const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+		std::cout << std::format("{:<24} {:>9.2f}ms, {:>9.2f}MB live in {:>9} allocations, private bytes {:>+9.2f}MB\n",
+			name, seconds * 1000,
+			(static_cast<double>(s_allocatedBytes) - static_cast<double>(Bytes)) / 1048576,
+			s_allocationCount - Allocations,
+			(static_cast<double>(PrivateBytes()) - static_cast<double>(Private)) / 1048576);
+	}
+};
+
+int main(int argc, char** argv) {
+	const auto args = ExcelHarness::ParseArguments(argc, argv, {
+		{ "--sheet", "<name>                     (default: Quest)" },
+		{ "--synthetic", "<columns>x<rows>       (generate a sheet instead of reading one from the game, e.g. 100x30000)" },
+	});
+	if (!args)
+		return -1;
+	const auto synthetic = ExcelHarness::ParseDimensions(args->Find("--synthetic").value_or("0x0"));
+	if (!synthetic)
+		return args->Usage();
+	const auto [syntheticColumnCount, syntheticRowCount] = *synthetic;
+	const auto sheetName = syntheticColumnCount ? std::string("Synthetic") : args->Find("--sheet").value_or("Quest");
+
+	std::unique_ptr<Sqex::Sqpack::Reader> reader;
+	std::unique_ptr<Sqex::Excel::ExhReader> exhPtr;
+	std::vector<std::pair<Sqex::Language, std::unique_ptr<Sqex::Excel::ExdReader>>> pages;
+	size_t rowCount = 0;
+	if (syntheticColumnCount) {
+		static constexpr Sqex::Language Languages[]{ Sqex::Language::English };
+		std::mt19937 rng(1);
+		const auto files = ExcelHarness::CreateSyntheticSheet(sheetName, syntheticColumnCount, syntheticRowCount, Languages, rng);
+		exhPtr = std::make_unique<Sqex::Excel::ExhReader>(sheetName, *ExcelHarness::OpenCompiled(files, std::format("exd/{}.exh", sheetName)));
+		for (const auto language : exhPtr->Languages) {
+			for (const auto& page : exhPtr->Pages) {
+				pages.emplace_back(language, std::make_unique<Sqex::Excel::ExdReader>(*exhPtr, ExcelHarness::OpenCompiled(files, exhPtr->GetDataPathSpec(page, language))));
+				rowCount += pages.back().second->Header.IndexSize / sizeof(Sqex::Excel::Exd::RowLocator);
+			}
+		}
+	} else {
+		reader = std::make_unique<Sqex::Sqpack::Reader>(args->GamePath / "sqpack" / "ffxiv" / "0a0000.win32.index");
+		exhPtr = std::make_unique<Sqex::Excel::ExhReader>(sheetName, Sqex::Sqpack::EntryRawStream(reader->GetEntryProvider(std::format("exd/{}.exh", sheetName))));
+		if (exhPtr->Header.Depth != Sqex::Excel::Exh::Level2) {
+			std::cout << "Not a 2nd depth sheet\n";
+			return -1;
+		}
+		for (const auto language : exhPtr->Languages) {
+			for (const auto& page : exhPtr->Pages) {
+				pages.emplace_back(language, std::make_unique<Sqex::Excel::ExdReader>(*exhPtr, (*reader)[exhPtr->GetDataPathSpec(page, language)]));
+				rowCount += pages.back().second->Header.IndexSize / sizeof(Sqex::Excel::Exd::RowLocator);
+			}
+		}
+	}
+	const auto& exh = *exhPtr;
+
+	std::cout << std::format("{}: {} columns, {} rows in {} languages\n", sheetName, exh.Columns->size(), rowCount, exh.Languages.size());
+	std::cout << std::format("sizeof(ExdColumn) = {}, sizeof(ExdCell) = {}\n", sizeof(Sqex::Excel::ExdColumn), sizeof(Sqex::Excel::ExdCell));
+
+	using ColumnRow = std::tuple<uint32_t, Sqex::Language, std::vector<Sqex::Excel::ExdColumn>>;
+	using CellRow = std::tuple<uint32_t, Sqex::Language, std::vector<Sqex::Excel::ExdCell>>;
+
+	// ExdCell goes first, so that private bytes used by ExdColumn are not hidden by reused heap.
+	ExcelHarness::CompiledFiles columnsCompiled, cellsCompiled;
+	{
+		const Measurement m{};
+		Sqex::Excel::ExdStringArena strings;
+		std::vector<CellRow> rows;
+		rows.reserve(rowCount);
+		for (const auto& [language, exd] : pages)
+			for (const auto& [id, row] : exd->Depth2Rows())
+				rows.emplace_back(id, language, row.Columns(strings));
+		m.Report("read as ExdCell");
+
+		const Measurement m2{};
+		Sqex::Excel::Depth2ExhExdCreator creator(sheetName, *exh.Columns, exh.Header.Flags);
+		for (const auto language : exh.Languages)
+			creator.AddLanguage(language);
+		for (const auto& [id, language, row] : rows)
+			creator.SetRow(id, language, row, strings);
+		m2.Report("fill from ExdCell");
+
+		const Measurement m3{};
+		cellsCompiled = creator.Compile();
+		m3.Report("compile");
+	}
+	{
+		const Measurement m{};
+		std::vector<ColumnRow> rows;
+		rows.reserve(rowCount);
+		for (const auto& [language, exd] : pages)
+			for (const auto& [id, row] : exd->Depth2Rows())
+				rows.emplace_back(id, language, row.Columns());
+		m.Report("read as ExdColumn");
+
+		const Measurement m2{};
+		Sqex::Excel::Depth2ExhExdCreator creator(sheetName, *exh.Columns, exh.Header.Flags);
+		for (const auto language : exh.Languages)
+			creator.AddLanguage(language);
+		for (const auto& [id, language, row] : rows)
+			creator.SetRow(id, language, row);
+		m2.Report("fill from ExdColumn");
+
+		const Measurement m3{};
+		columnsCompiled = creator.Compile();
+		m3.Report("compile");
+	}
+
+	std::cout << std::format("Compiled files {}\n", columnsCompiled == cellsCompiled ? "match" : "DIFFER");
+	return 0;
+}
@@ -0,0 +1,309 @@
+#include "pch.h"
+
+#include <chrono>
+#include <random>
+#include <XivAlexanderCommon/Sqex/Excel.h>
+#include <XivAlexanderCommon/Sqex/Excel/Generator.h>
+#include <XivAlexanderCommon/Sqex/Excel/Reader.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/EntryRawStream.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/Reader.h>
+#include <XivAlexanderCommon/Utils/Utils.h>
+#include "ExcelHarness.h"
+
+static const Sqex::Language TargetLanguages[]{
+	Sqex::Language::Japanese,
+	Sqex::Language::English,
+	Sqex::Language::German,
+	Sqex::Language::French,
+	Sqex::Language::ChineseSimplified,
+	Sqex::Language::Korean,
+};
+
+// Previous representation: a vector of ExdColumn per row per language, and a vector per row while compiling.
+class LegacyDepth2ExhExdCreator {
+public:
+	const std::vector<Sqex::Excel::Exh::Column> Columns;
+	const Sqex::Excel::Exh::ExhFlag Flags;
+	const uint32_t FixedDataSize;
+	std::map<uint32_t, std::map<Sqex::Language, std::vector<Sqex::Excel::ExdColumn>>> Data;
+	std::vector<Sqex::Language> Languages;
+	std::vector<Sqex::Language> FillMissingLanguageFrom;
+
+	LegacyDepth2ExhExdCreator(const Sqex::Excel::Depth2ExhExdCreator& reference)
+		: Columns(reference.Columns)
+		, Flags(reference.Flags)
+		, FixedDataSize(reference.FixedDataSize) {
+	}
+
+	void SetRow(uint32_t id, Sqex::Language language, std::vector<Sqex::Excel::ExdColumn> row) {
+		Data[id][language] = std::move(row);
+	}
+
+	std::vector<std::vector<char>> Compile() {
+		using namespace Sqex::Excel;
+
+		std::vector<std::vector<char>> result;
+		for (const auto language : Languages) {
+			std::map<uint32_t, std::vector<char>> rows;
+			for (auto& [id, rowSet] : Data) {
+				std::vector<char> row(sizeof(Exd::RowHeader) + FixedDataSize);
+				const auto fixedDataOffset = sizeof(Exd::RowHeader);
+				const auto variableDataOffset = fixedDataOffset + FixedDataSize;
+
+				const auto it = rowSet.find(language);
+				if (it == rowSet.end())
+					continue;
+				auto& columns = it->second;
+				for (size_t i = 0; i < columns.size(); ++i) {
+					auto& column = columns[i];
+					const auto& columnDefinition = Columns[i];
+					switch (columnDefinition.Type) {
+						case Exh::String: {
+							const auto stringOffset = Utils::BE(static_cast<uint32_t>(row.size() - variableDataOffset));
+							std::copy_n(reinterpret_cast<const char*>(&stringOffset), 4, &row[fixedDataOffset + columnDefinition.Offset]);
+							row.insert(row.end(), column.String.Escaped().begin(), column.String.Escaped().end());
+							row.push_back(0);
+							column.ValidSize = 0;
+							break;
+						}
+
+						case Exh::PackedBool0:
+						case Exh::PackedBool1:
+						case Exh::PackedBool2:
+						case Exh::PackedBool3:
+						case Exh::PackedBool4:
+						case Exh::PackedBool5:
+						case Exh::PackedBool6:
+						case Exh::PackedBool7:
+							column.ValidSize = 0;
+							if (column.boolean)
+								row[fixedDataOffset + columnDefinition.Offset] |= (1 << (static_cast<int>(column.Type) - static_cast<int>(Exh::PackedBool0)));
+							break;
+					}
+					if (column.ValidSize) {
+						const auto target = std::span(row).subspan(fixedDataOffset + columnDefinition.Offset, column.ValidSize);
+						std::copy_n(&column.Buffer[0], column.ValidSize, &target[0]);
+						std::reverse(target.begin(), target.end());
+					}
+				}
+				row.resize(Sqex::Align<size_t>(row.size(), 4));
+
+				auto& rowHeader = *reinterpret_cast<Exd::RowHeader*>(&row[0]);
+				rowHeader.DataSize = static_cast<uint32_t>(row.size() - sizeof rowHeader);
+				rowHeader.SubRowCount = 1;
+				rows.emplace(id, std::move(row));
+			}
+
+			std::vector<char> exdFile;
+			for (const auto& row : rows | std::views::values)
+				exdFile.insert(exdFile.end(), row.begin(), row.end());
+			result.emplace_back(std::move(exdFile));
+		}
+		return result;
+	}
+};
+
+struct Timings {
+	std::chrono::steady_clock::duration Load{};
+	std::chrono::steady_clock::duration Transform{};
+	std::chrono::steady_clock::duration Compile{};
+
+	void Print(const char* name) const {
+		const auto ms = [](std::chrono::steady_clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+		std::cout << std::format("{:<10} load {:>9.1f}ms, transform {:>9.1f}ms, compile {:>9.1f}ms, total {:>9.1f}ms\n",
+			name, ms(Load), ms(Transform), ms(Compile), ms(Load + Transform + Compile));
+	}
+};
+
+template<typename Fn>
+static void Measure(std::chrono::steady_clock::duration& target, const Fn& fn) {
+	const auto start = std::chrono::steady_clock::now();
+	fn();
+	target += std::chrono::steady_clock::now() - start;
+}
+
+struct Results {
+	Timings Legacy, Columnar;
+	size_t SheetCount = 0, MismatchCount = 0;
+	size_t StringArenaBytes = 0, CompiledBytes = 0, DeduplicatedBytes = 0;
+};
+
+static void CompareSheet(const std::string& name, const Sqex::Excel::ExhReader& exh, const std::vector<std::pair<Sqex::Language, std::shared_ptr<Sqex::MemoryRandomAccessStream>>>& pages, Results& results) {
+	Sqex::Excel::Depth2ExhExdCreator columnar(name, *exh.Columns, exh.Header.Flags.Value());
+	columnar.FillMissingLanguageFrom = { Sqex::Language::English, Sqex::Language::Japanese };
+	for (const auto language : TargetLanguages)
+		columnar.AddLanguage(language);
+
+	LegacyDepth2ExhExdCreator legacy(columnar);
+	legacy.Languages = columnar.Languages;
+	legacy.FillMissingLanguageFrom = columnar.FillMissingLanguageFrom;
+
+	Measure(results.Legacy.Load, [&]() {
+		for (const auto& [language, stream] : pages) {
+			const auto exd = Sqex::Excel::ExdReader(exh, stream);
+			for (const auto& [id, row] : exd.Depth2Rows())
+				legacy.SetRow(id, language, row.Columns());
+		}
+	});
+	Measure(results.Columnar.Load, [&]() {
+		for (const auto& [language, stream] : pages) {
+			const auto exd = Sqex::Excel::ExdReader(exh, stream);
+			for (const auto& [id, row] : exd.Depth2Rows())
+				columnar.SetRow(id, language, row);
+		}
+	});
+
+	// Same shape as the fill pass of SetUpMergedExd: create missing languages, then fill empty strings from the reference language.
+	Measure(results.Legacy.Transform, [&]() {
+		for (auto& rowSet : legacy.Data | std::views::values) {
+			const auto referenceIt = std::ranges::find_if(legacy.FillMissingLanguageFrom, [&](auto l) { return rowSet.contains(l); });
+			if (referenceIt == legacy.FillMissingLanguageFrom.end())
+				continue;
+			const auto& reference = rowSet.at(*referenceIt);
+			for (const auto language : legacy.Languages) {
+				auto& row = rowSet[language];
+				if (row.empty()) {
+					row = reference;
+					continue;
+				}
+				for (size_t i = 0; i < row.size(); ++i)
+					if (row[i].Type == Sqex::Excel::Exh::String && row[i].String.Empty())
+						row[i].String = reference[i].String;
+			}
+		}
+	});
+	Measure(results.Columnar.Transform, [&]() {
+		auto& sheet = columnar.Sheet;
+		for (size_t rowIndex = 0; rowIndex < sheet.RowCount(); ++rowIndex) {
+			const auto referenceIt = std::ranges::find_if(columnar.FillMissingLanguageFrom, [&](auto l) { return sheet.HasRow(rowIndex, l); });
+			if (referenceIt == columnar.FillMissingLanguageFrom.end())
+				continue;
+			for (const auto language : columnar.Languages) {
+				if (!sheet.HasRow(rowIndex, language)) {
+					sheet.CopyRow(rowIndex, *referenceIt, language);
+					continue;
+				}
+				for (size_t i = 0; i < sheet.Columns.size(); ++i)
+					if (sheet.Columns[i].Type == Sqex::Excel::Exh::String && sheet.EscapedString(rowIndex, language, i).empty())
+						sheet.CopyCell(rowIndex, *referenceIt, language, i);
+			}
+		}
+	});
+
+	std::vector<std::vector<char>> legacyCompiled;
+	ExcelHarness::CompiledFiles columnarCompiled;
+	Measure(results.Legacy.Compile, [&]() { legacyCompiled = legacy.Compile(); });
+	Measure(results.Columnar.Compile, [&]() { columnarCompiled = columnar.Compile(); });
+
+	results.StringArenaBytes += columnar.Sheet.StringBytes();
+	for (const auto& data : columnarCompiled | std::views::values)
+		results.CompiledBytes += data.size();
+	columnar.DeduplicateStrings = true;
+	for (const auto& data : columnar.Compile() | std::views::values)
+		results.DeduplicatedBytes += data.size();
+	columnar.DeduplicateStrings = false;
+
+	// Row data of each language should match byte by byte.
+	if (!columnarCompiled.empty()) {
+		const auto compiledExh = Sqex::Excel::ExhReader(name, *ExcelHarness::OpenCompiled(columnarCompiled, std::format("exd/{}.exh", name)));
+		for (size_t i = 0; i < columnar.Languages.size(); ++i) {
+			const auto it = columnarCompiled.find(compiledExh.GetDataPathSpec(compiledExh.Pages.front(), columnar.Languages[i]));
+			if (it == columnarCompiled.end())
+				continue;
+			const auto& header = *reinterpret_cast<const Sqex::Excel::Exd::Header*>(&it->second[0]);
+			const auto rows = std::span(it->second).subspan(sizeof header + header.IndexSize);
+			if (!std::ranges::equal(rows, legacyCompiled[i])) {
+				std::cout << std::format("Mismatch: {} ({})\n", name, static_cast<int>(columnar.Languages[i]));
+				results.MismatchCount++;
+			}
+		}
+	}
+	results.SheetCount++;
+}
+
+// A row that exists only in a fallback language should be compiled into every language using the fallback's data.
+static bool CheckFillMissingLanguage() {
+	std::vector<Sqex::Excel::Exh::Column> columns(1);
+	columns[0].Type = Sqex::Excel::Exh::UInt32;
+	columns[0].Offset = 0;
+
+	Sqex::Excel::Depth2ExhExdCreator creator("FillTest", columns, Sqex::Excel::Exh::ExhFlag{});
+	creator.AddLanguage(Sqex::Language::Japanese);
+	creator.AddLanguage(Sqex::Language::English);
+	creator.FillMissingLanguageFrom = { Sqex::Language::English, Sqex::Language::Japanese };
+
+	std::vector<Sqex::Excel::ExdColumn> row(1);
+	row[0] = { .Type = Sqex::Excel::Exh::UInt32, .ValidSize = 4 };
+	row[0].uint32 = 1001;
+	creator.SetRow(1, Sqex::Language::English, row);
+	row[0].uint32 = 2002;
+	creator.SetRow(2, Sqex::Language::Japanese, row);
+
+	const auto files = creator.Compile();
+	const auto exh = Sqex::Excel::ExhReader("FillTest", *ExcelHarness::OpenCompiled(files, "exd/FillTest.exh"));
+	for (const auto language : { Sqex::Language::Japanese, Sqex::Language::English }) {
+		const auto exd = Sqex::Excel::ExdReader(exh, ExcelHarness::OpenCompiled(files, exh.GetDataPathSpec(exh.Pages.front(), language)));
+		std::map<uint32_t, uint32_t> values;
+		for (const auto& [id, r] : exd.Depth2Rows())
+			values.emplace(id, r.Columns()[0].uint32);
+		if (values != std::map<uint32_t, uint32_t>{ { 1, 1001 }, { 2, 2002 } }) {
+			std::cout << std::format("Fill from other languages: language {} has {} rows, expected rows 1 and 2\n", static_cast<int>(language), values.size());
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	const auto args = ExcelHarness::ParseArguments(argc, argv, {
+		{ "--synthetic", "<sheets>x<rows>       (generate sheets instead of reading every sheet from the game, e.g. 20x20000)" },
+	});
+	if (!args)
+		return -1;
+	const auto synthetic = ExcelHarness::ParseDimensions(args->Find("--synthetic").value_or("0x0"));
+	if (!synthetic)
+		return args->Usage();
+
+	if (!CheckFillMissingLanguage())
+		return -1;
+
+	Results results;
+	if (const auto [syntheticSheetCount, syntheticRowCount] = *synthetic; syntheticSheetCount) {
+		static constexpr Sqex::Language SourceLanguages[]{ Sqex::Language::English, Sqex::Language::Japanese, Sqex::Language::German, Sqex::Language::French };
+		std::mt19937 rng(1);
+		for (size_t i = 0; i < syntheticSheetCount; ++i) {
+			const auto name = std::format("Synthetic{}", i);
+			const auto files = ExcelHarness::CreateSyntheticSheet(name, 24, syntheticRowCount, SourceLanguages, rng);
+			const auto exh = Sqex::Excel::ExhReader(name, *ExcelHarness::OpenCompiled(files, std::format("exd/{}.exh", name)));
+
+			std::vector<std::pair<Sqex::Language, std::shared_ptr<Sqex::MemoryRandomAccessStream>>> pages;
+			for (const auto language : exh.Languages)
+				for (const auto& page : exh.Pages)
+					pages.emplace_back(language, ExcelHarness::OpenCompiled(files, exh.GetDataPathSpec(page, language)));
+			CompareSheet(name, exh, pages, results);
+		}
+	} else {
+		system("chcp 65001");
+		const Sqex::Sqpack::Reader reader(args->GamePath / "sqpack" / "ffxiv" / "0a0000.win32.index");
+		const auto exl = Sqex::Excel::ExlReader(Sqex::Sqpack::EntryRawStream(reader.GetEntryProvider("exd/root.exl")));
+		for (const auto& x : exl | std::views::keys) {
+			const auto exh = Sqex::Excel::ExhReader(x, Sqex::Sqpack::EntryRawStream(reader.GetEntryProvider(std::format("exd/{}.exh", x))));
+			if (exh.Header.Depth != Sqex::Excel::Exh::Depth::Level2)
+				continue;
+			if (std::ranges::find(exh.Languages, Sqex::Language::Unspecified) != exh.Languages.end())
+				continue;
+
+			std::vector<std::pair<Sqex::Language, std::shared_ptr<Sqex::MemoryRandomAccessStream>>> pages;
+			for (const auto language : exh.Languages)
+				for (const auto& page : exh.Pages)
+					pages.emplace_back(language, std::make_shared<Sqex::MemoryRandomAccessStream>(*reader[exh.GetDataPathSpec(page, language)]));
+			CompareSheet(x, exh, pages, results);
+		}
+	}
+
+	std::cout << std::format("{} sheets, {} mismatches\n", results.SheetCount, results.MismatchCount);
+	std::cout << std::format("interned strings: {} bytes; compiled: {} bytes, {} bytes with deduplicated strings\n", results.StringArenaBytes, results.CompiledBytes, results.DeduplicatedBytes);
+	results.Legacy.Print("legacy");
+	results.Columnar.Print("columnar");
+	return results.MismatchCount ? -1 : 0;
+}
@@ -0,0 +1,87 @@
+#include "pch.h"
+
+#include <chrono>
+#include <fstream>
+#include <XivAlexanderCommon/Sqex/Excel/Query.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/Reader.h>
+#include <XivAlexanderCommon/Utils/Utils.h>
+#include "ExcelHarness.h"
+
+static std::vector<size_t> ParseColumns(const std::string& s) {
+	std::vector<size_t> columns;
+	for (const auto& column : Utils::StringSplit<std::string>(s, ","))
+		columns.emplace_back(std::stoul(column));
+	return columns;
+}
+
+int main(int argc, char** argv) {
+	const auto args = ExcelHarness::ParseArguments(argc, argv, {
+		{ "--sheet", "<regex matching whole sheet names>        (default: every sheet)" },
+		{ "--language", "<name>                                 (repeatable; default: every language)" },
+		{ "--where", "<column>=<regex>                          (repeatable)" },
+		{ "--where-not", "<column>=<regex>                      (repeatable)" },
+		{ "--select", "<column>[,<column>...]                   (default: every column)" },
+		{ "--join", "<column>:<sheet>[:<column>[,<column>...]]  (repeatable)" },
+		{ "--format", "csv|jsonl                                (default: jsonl)" },
+		{ "--output", "<path>                                   (default: stdout)" },
+		{ "--cache-pages", "<count>                             (default: 256)" },
+	});
+	if (!args)
+		return -1;
+
+	std::filesystem::path outputPath;
+	auto format = Sqex::Excel::Query::OutputFormat::JsonLines;
+	size_t cachePages = 256;
+
+	Sqex::Excel::Query query;
+	query.SheetPattern = srell::u8cregex(".*");
+	try {
+		for (const auto& [name, value] : args->Values) {
+			if (name == "--sheet")
+				query.SheetPattern = srell::u8cregex(value, srell::regex_constants::ECMAScript | srell::regex_constants::icase);
+			else if (name == "--language")
+				query.Languages.emplace_back(nlohmann::json(value).get<Sqex::Language>());
+			else if (name == "--where" || name == "--where-not") {
+				const auto split = Utils::StringSplit<std::string>(value, "=", 1);
+				if (split.size() != 2)
+					return args->Usage();
+				query.Conditions.emplace_back(Sqex::Excel::Query::Condition{ std::stoul(split[0]), srell::u8cregex(split[1]), name == "--where-not" });
+			} else if (name == "--select")
+				query.Columns = ParseColumns(value);
+			else if (name == "--join") {
+				const auto split = Utils::StringSplit<std::string>(value, ":", 2);
+				if (split.size() < 2)
+					return args->Usage();
+				query.Joins.emplace_back(Sqex::Excel::Query::Join{ std::stoul(split[0]), split[1], split.size() == 3 ? ParseColumns(split[2]) : std::vector<size_t>() });
+			} else if (name == "--format") {
+				if (value == "csv")
+					format = Sqex::Excel::Query::OutputFormat::Csv;
+				else if (value == "jsonl")
+					format = Sqex::Excel::Query::OutputFormat::JsonLines;
+				else
+					return args->Usage();
+			} else if (name == "--output")
+				outputPath = value;
+			else if (name == "--cache-pages")
+				cachePages = std::stoul(value);
+		}
+
+		const Sqex::Sqpack::GameReader game(args->GamePath);
+		const Sqex::Excel::SheetCache cache(game, cachePages);
+
+		std::ofstream file;
+		if (!outputPath.empty()) {
+			file.open(outputPath, std::ios::binary);
+			if (!file)
+				throw std::runtime_error(std::format("Failed to open {}", outputPath.string()));
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		const auto rowCount = query.Run(cache, outputPath.empty() ? std::cout : file, format);
+		std::cerr << std::format("{} rows in {:.2f}s\n", rowCount, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return -1;
+	}
+	return 0;
+}
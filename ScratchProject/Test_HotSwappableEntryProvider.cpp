@@ -0,0 +1,113 @@
+#include "pch.h"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+#include <XivAlexanderCommon/Sqex/Sqpack/HotSwappableEntryProvider.h>
+
+// Entry whose every byte is derived from its seed and offset, so that a reader can tell which entry a read came from.
+class PatternEntryProvider : public Sqex::Sqpack::EntryProvider {
+	const uint32_t m_seed;
+	const uint64_t m_size;
+
+public:
+	PatternEntryProvider(uint32_t seed, uint64_t size)
+		: EntryProvider(std::format("test/{}.bin", seed))
+		, m_seed(seed)
+		, m_size(size) {
+	}
+
+	[[nodiscard]] static uint8_t At(uint32_t seed, uint64_t offset) {
+		return static_cast<uint8_t>((offset * 2654435761ULL + seed * 40503ULL) >> 7);
+	}
+
+	[[nodiscard]] uint32_t Seed() const { return m_seed; }
+
+	[[nodiscard]] uint64_t StreamSize() const override { return m_size; }
+
+	uint64_t ReadStreamPartial(uint64_t offset, void* buf, uint64_t length) const override {
+		if (offset >= m_size)
+			return 0;
+		length = std::min(length, m_size - offset);
+		for (uint64_t i = 0; i < length; ++i)
+			static_cast<uint8_t*>(buf)[i] = At(m_seed, offset + i);
+		return length;
+	}
+
+	[[nodiscard]] Sqex::Sqpack::SqData::FileEntryType EntryType() const override { return Sqex::Sqpack::SqData::FileEntryType::Binary; }
+};
+
+// Usage: ScratchProject.exe [readers=8] [seconds=10]
+int main(int argc, char** argv) {
+	const auto readerCount = argc >= 2 ? std::stoul(argv[1]) : 8;
+	const auto duration = std::chrono::seconds(argc >= 3 ? std::stoul(argv[2]) : 10);
+	constexpr uint32_t ReservedSize = 65536;
+
+	// Index 0 is the base stream, which is what readers see while no override is set.
+	std::vector<std::shared_ptr<const PatternEntryProvider>> pool;
+	for (uint32_t i = 0; i < 8; ++i)
+		pool.emplace_back(std::make_shared<PatternEntryProvider>(i, i == 0 ? ReservedSize : 4096 * (i * 2 + 1) - i * 37));
+
+	Sqex::Sqpack::HotSwappableEntryProvider provider("test/hotswap.bin", ReservedSize, pool[0]);
+
+	std::atomic_bool stop = false;
+	std::atomic<size_t> readCount = 0, mismatchCount = 0, swapCount = 0;
+	std::vector<std::weak_ptr<const PatternEntryProvider>> released;
+
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < readerCount; ++t) {
+		threads.emplace_back([&, t]() {
+			std::mt19937_64 rng(t);
+			std::vector<uint8_t> buf;
+			while (!stop) {
+				const auto offset = rng() % ReservedSize;
+				const auto length = 1 + rng() % std::min<uint64_t>(8192, ReservedSize - offset);
+				buf.resize(length);
+				provider.ReadStream(offset, std::span(buf));
+
+				// Every byte of a single read must come from the same stream, including the zero fill past its end.
+				const auto fromSameStream = std::ranges::any_of(pool, [&](const auto& candidate) {
+					for (size_t i = 0; i < length; ++i) {
+						const auto expected = offset + i < candidate->StreamSize() ? PatternEntryProvider::At(candidate->Seed(), offset + i) : 0;
+						if (buf[i] != expected)
+							return false;
+					}
+					return true;
+				});
+				if (!fromSameStream)
+					mismatchCount++;
+				readCount++;
+			}
+		});
+	}
+
+	threads.emplace_back([&]() {
+		std::mt19937 rng(12345);
+		while (!stop) {
+			const auto index = rng() % pool.size();
+			if (index == 0)
+				provider.SwapStream(nullptr);
+			else if (swapCount % 64 == 0) {
+				// A fresh copy nobody else holds; it should be gone once the readers let go of it.
+				auto copy = std::make_shared<const PatternEntryProvider>(pool[index]->Seed(), pool[index]->StreamSize());
+				released.emplace_back(copy);
+				provider.SwapStream(std::move(copy));
+			} else
+				provider.SwapStream(pool[index]);
+			swapCount++;
+		}
+		provider.SwapStream(nullptr);
+	});
+
+	std::this_thread::sleep_for(duration);
+	stop = true;
+	for (auto& thread : threads)
+		thread.join();
+
+	const auto leaked = std::ranges::count_if(released, [](const auto& p) { return !p.expired(); });
+	std::cout << std::format("{} readers, {} reads, {} swaps, {} mismatches, {}/{} swapped out streams still alive\n",
+		readerCount, readCount.load(), swapCount.load(), mismatchCount.load(), leaked, released.size());
+	return mismatchCount || leaked ? -1 : 0;
+}
@@ -0,0 +1,170 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include <XivAlexanderCommon/Utils/NumericStatisticsTracker.h>
+
+// Previous implementation: a deque behind a mutex, copied and scanned (and sorted for median) on every query.
+class LegacyNumericStatisticsTracker {
+	const size_t m_trackCount;
+	const int64_t m_emptyValue;
+
+	struct Entry {
+		int64_t Value;
+		int64_t TimestampUs;
+	};
+
+	mutable std::mutex m_mtx;
+	std::deque<Entry> m_values;
+
+	std::deque<Entry> Values() const {
+		const auto lock = std::lock_guard(m_mtx);
+		return m_values;
+	}
+
+public:
+	LegacyNumericStatisticsTracker(size_t trackCount, int64_t emptyValue)
+		: m_trackCount(trackCount)
+		, m_emptyValue(emptyValue) {
+	}
+
+	void AddValue(int64_t v) {
+		const auto lock = std::lock_guard(m_mtx);
+		m_values.emplace_back(Entry{ v, Utils::QpcUs() });
+		while (m_values.size() > m_trackCount)
+			m_values.pop_front();
+	}
+
+	int64_t Min() const {
+		const auto vals = Values();
+		if (vals.empty())
+			return m_emptyValue;
+		return std::ranges::min_element(vals, {}, &Entry::Value)->Value;
+	}
+
+	int64_t Max() const {
+		const auto vals = Values();
+		if (vals.empty())
+			return m_emptyValue;
+		return std::ranges::max_element(vals, {}, &Entry::Value)->Value;
+	}
+
+	int64_t Median() const {
+		const auto vals = Values();
+		std::vector<int64_t> sorted;
+		sorted.reserve(vals.size());
+		for (const auto& v : vals)
+			sorted.emplace_back(v.Value);
+		if (sorted.empty())
+			return m_emptyValue;
+		std::ranges::sort(sorted);
+		if (sorted.size() % 2 == 0)
+			return (sorted[sorted.size() / 2] + sorted[sorted.size() / 2 - 1]) / 2;
+		return sorted[sorted.size() / 2];
+	}
+
+	std::pair<int64_t, int64_t> MeanAndDeviation(int64_t sinceUs = 0) const {
+		const auto vals = Values();
+		int64_t count = 0, acc = 0;
+		for (const auto& v : std::ranges::reverse_view(vals)) {
+			if (v.TimestampUs < sinceUs)
+				break;
+			acc += v.Value;
+			++count;
+		}
+		if (count == 0)
+			return { m_emptyValue, 0 };
+		if (count == 1)
+			return { acc, 0 };
+		const auto mean = acc / count;
+		int64_t diffSquaredSum = 0;
+		for (const auto& v : std::ranges::reverse_view(vals)) {
+			if (v.TimestampUs < sinceUs)
+				break;
+			diffSquaredSum += (v.Value - mean) * (v.Value - mean);
+		}
+		return { mean, static_cast<int64_t>(std::sqrt(diffSquaredSum / count)) };
+	}
+};
+
+// Feeds both implementations the same values, with plenty of duplicates, and compares whole window statistics after every value.
+static size_t Compare(size_t trackCount) {
+	LegacyNumericStatisticsTracker legacy(trackCount, 0);
+	Utils::NumericStatisticsTracker current(trackCount, 0);
+	std::mt19937 rng(1);
+	size_t mismatches = 0;
+	for (size_t i = 0; i < trackCount * 20; ++i) {
+		const auto v = static_cast<int64_t>(rng() % 64) - 16;
+		legacy.AddValue(v);
+		current.AddValue(v);
+		if (legacy.Min() != current.Min()
+			|| legacy.Max() != current.Max()
+			|| legacy.Median() != current.Median()
+			|| legacy.MeanAndDeviation() != current.MeanAndDeviation())
+			mismatches++;
+	}
+	return mismatches;
+}
+
+template<typename T>
+static void Benchmark(size_t trackCount) {
+	constexpr size_t Iterations = 200000;
+
+	T tracker(trackCount, 0);
+	std::mt19937 rng(0);
+	int64_t sink = 0;
+
+	const auto measure = [&](const char* name, const auto& fn) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < Iterations; ++i)
+			fn(i);
+		const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		std::cout << std::format("\t{:<24} {:>10.1f}ns/op\n", name, elapsed / Iterations);
+	};
+
+	measure("AddValue", [&](size_t) { tracker.AddValue(10000 + rng() % 5000); });
+	measure("Median", [&](size_t) { sink += tracker.Median(); });
+	measure("MeanAndDeviation", [&](size_t) { sink += tracker.MeanAndDeviation().second; });
+	measure("MeanAndDeviation(since)", [&](size_t) { sink += tracker.MeanAndDeviation(Utils::QpcUs() - 1000).second; });
+	measure("AddValue+MeanAndDeviation", [&](size_t) {
+		tracker.AddValue(10000 + rng() % 5000);
+		sink += tracker.MeanAndDeviation().first;
+	});
+
+	// Queries while another thread keeps adding values, like UI refreshes during network activity.
+	std::atomic_bool stop = false;
+	std::thread writer([&] {
+		while (!stop)
+			tracker.AddValue(10000 + rng() % 5000);
+	});
+	measure("Median (contended)", [&](size_t) { sink += tracker.Median(); });
+	measure("MeanAndDev (contended)", [&](size_t) { sink += tracker.MeanAndDeviation().second; });
+	stop = true;
+	writer.join();
+
+	if (sink == 42)
+		std::cout << "";
+}
+
+int main() {
+	for (const auto trackCount : { 1, 2, 9, 10, 127, 128, 1024 }) {
+		if (const auto mismatches = Compare(trackCount)) {
+			std::cout << std::format("trackCount={}: {} mismatches\n", trackCount, mismatches);
+			return -1;
+		}
+	}
+
+	for (const auto trackCount : { 10, 128, 1024 }) {
+		std::cout << std::format("trackCount={}, legacy:\n", trackCount);
+		Benchmark<LegacyNumericStatisticsTracker>(trackCount);
+		std::cout << std::format("trackCount={}, current:\n", trackCount);
+		Benchmark<Utils::NumericStatisticsTracker>(trackCount);
+	}
+	return 0;
+}
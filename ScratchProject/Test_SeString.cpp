@@ -0,0 +1,170 @@
+#include "pch.h"
+
+#include <chrono>
+#include <random>
+#include <XivAlexanderCommon/Sqex/Excel/Reader.h>
+#include <XivAlexanderCommon/Sqex/SeString.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/EntryRawStream.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/Reader.h>
+#include "ExcelHarness.h"
+
+static const char* const TargetSheets[]{
+	"Quest",
+	"Item",
+	"Action",
+	"Addon",
+	"Completion",
+};
+
+// Previous implementation of SeString::Parse: byte by byte, with every payload copied into its own string.
+static std::pair<std::string, std::vector<Sqex::SePayload>> LegacyParse(std::string_view remaining) {
+	std::string parsed;
+	std::vector<Sqex::SePayload> payloads;
+	parsed.reserve(remaining.size());
+	while (!remaining.empty()) {
+		if (remaining[0] == '\x02') {
+			if (remaining.size() < 3)
+				throw std::invalid_argument("STX occurred but there are less than 3 remaining bytes");
+			remaining = remaining.substr(1);
+
+			const auto payloadTypeLength = Sqex::SeExpressionUint32::ExpressionLength(remaining[0]);
+			if (payloadTypeLength == 0 || remaining.size() < payloadTypeLength)
+				throw std::invalid_argument("bad payload type");
+			const auto payloadType = Sqex::SeExpressionUint32(remaining);
+			remaining = remaining.substr(payloadTypeLength);
+
+			const auto lengthLength = Sqex::SeExpressionUint32::ExpressionLength(remaining[0]);
+			if (lengthLength == 0 || remaining.size() < lengthLength)
+				throw std::invalid_argument("bad payload length");
+			const auto payloadLength = Sqex::SeExpressionUint32(remaining);
+			remaining = remaining.substr(lengthLength);
+
+			if (remaining.size() < payloadLength)
+				throw std::invalid_argument("payload is incomplete");
+			auto payload = Sqex::SePayload(payloadType, remaining.substr(0, payloadLength));
+			remaining = remaining.substr(payloadLength);
+
+			if (remaining.empty() || remaining[0] != '\x03')
+				throw std::invalid_argument("ETX not found");
+			remaining = remaining.substr(1);
+
+			parsed.push_back('\x02');
+			payloads.emplace_back(std::move(payload));
+		} else {
+			parsed.push_back(remaining.front());
+			remaining = remaining.substr(1);
+		}
+	}
+	return { std::move(parsed), std::move(payloads) };
+}
+
+// Mostly plain text like names and descriptions; 1 in 4 strings also has a few short payloads, like line breaks and colors.
+static std::vector<std::string> CreateSyntheticStrings(size_t count) {
+	static constexpr const char* Words[]{ "the", "Warrior", "of", "Light", "crystal", "Ul'dah", "potion", "of", "strength", "光の戦士", "クリスタル", "ウルダハ", ".", "," };
+
+	std::mt19937 rng(1);
+	std::vector<std::string> strings;
+	strings.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		std::string s;
+		const auto hasPayloads = rng() % 4 == 0;
+		for (size_t j = 0, wordCount = 1 + rng() % 16; j < wordCount; ++j) {
+			if (j)
+				s += ' ';
+			s += Words[rng() % std::size(Words)];
+			if (hasPayloads && rng() % 4 == 0) {
+				const auto length = rng() % 8;
+				s += '\x02';
+				s += static_cast<char>(0x10 + rng() % 0x40);  // type, as a single byte SeExpressionUint32
+				s += static_cast<char>(length + 1);  // length, as a single byte SeExpressionUint32
+				for (size_t k = 0; k < length; ++k)
+					s += static_cast<char>(1 + rng() % 0xCF);
+				s += '\x03';
+			}
+		}
+		strings.emplace_back(std::move(s));
+	}
+	return strings;
+}
+
+template<typename Fn>
+static void Measure(const char* name, size_t count, size_t bytes, const Fn& fn) {
+	const auto start = std::chrono::steady_clock::now();
+	const auto checksum = fn();
+	const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << std::format("{:<12} {:>9.2f}ms, {:>8.1f}MB/s, {:>12.0f} strings/s (checksum {})\n",
+		name, seconds * 1000, static_cast<double>(bytes) / seconds / 1048576, static_cast<double>(count) / seconds, checksum);
+}
+
+int main(int argc, char** argv) {
+	const auto args = ExcelHarness::ParseArguments(argc, argv, {
+		{ "--synthetic", "<strings>              (generate strings instead of reading them from the game, e.g. 1000000)" },
+	});
+	if (!args)
+		return -1;
+	const auto syntheticStringCount = std::stoul(args->Find("--synthetic").value_or("0"));
+
+	std::vector<std::string> strings;
+	if (syntheticStringCount)
+		strings = CreateSyntheticStrings(syntheticStringCount);
+	else {
+		system("chcp 65001");
+		const Sqex::Sqpack::Reader reader(args->GamePath / "sqpack" / "ffxiv" / "0a0000.win32.index");
+		for (const auto sheetName : TargetSheets) {
+			const auto exh = Sqex::Excel::ExhReader(sheetName, Sqex::Sqpack::EntryRawStream(reader.GetEntryProvider(std::format("exd/{}.exh", sheetName))));
+			for (const auto language : exh.Languages) {
+				for (const auto& page : exh.Pages) {
+					const auto exd = Sqex::Excel::ExdReader(exh, reader[exh.GetDataPathSpec(page, language)]);
+					for (const auto& row : exd.Depth2Rows() | std::views::values) {
+						for (size_t i = 0; i < row.Size(); ++i) {
+							if (row.Type(i) == Sqex::Excel::Exh::String)
+								strings.emplace_back(row.EscapedString(i));
+						}
+					}
+				}
+			}
+		}
+	}
+
+	size_t totalBytes = 0;
+	for (const auto& s : strings)
+		totalBytes += s.size();
+	std::cout << std::format("{} strings, {} bytes\n", strings.size(), totalBytes);
+
+	size_t mismatchCount = 0;
+	for (const auto& s : strings) {
+		const auto [legacyParsed, legacyPayloads] = LegacyParse(s);
+		const auto current = Sqex::SeString(std::string(s));
+		if (legacyParsed != current.Parsed()
+			|| !std::ranges::equal(legacyPayloads, current.Payloads(), [](const auto& l, const auto& r) { return l.Type() == r.Type() && l.Data() == r.Data(); }))
+			mismatchCount++;
+	}
+	std::cout << std::format("{} mismatches\n", mismatchCount);
+
+	Measure("legacy", strings.size(), totalBytes, [&]() {
+		size_t checksum = 0;
+		for (const auto& s : strings) {
+			const auto [parsed, payloads] = LegacyParse(s);
+			checksum += parsed.size() + payloads.size();
+		}
+		return checksum;
+	});
+	Measure("SeString", strings.size(), totalBytes, [&]() {
+		size_t checksum = 0;
+		for (const auto& s : strings) {
+			const auto parsed = Sqex::SeString(std::string(s));
+			checksum += parsed.Parsed().size() + parsed.Payloads().size();
+		}
+		return checksum;
+	});
+	Measure("tokenizer", strings.size(), totalBytes, [&]() {
+		size_t checksum = 0;
+		Sqex::SeStringToken token;
+		for (const auto& s : strings) {
+			for (Sqex::SeStringTokenizer tokenizer(s); tokenizer.Next(token);)
+				checksum += token.IsPayload ? 2 : token.Escaped.size();  // Same as the others: the sentinel, and the payload itself
+		}
+		return checksum;
+	});
+	return 0;
+}
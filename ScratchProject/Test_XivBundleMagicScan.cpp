@@ -0,0 +1,93 @@
+#include "pch.h"
+
+#include <chrono>
+#include <random>
+
+#include <XivAlexanderCommon/Sqex/Network/Structure.h>
+
+using namespace Sqex::Network::Structure;
+
+static size_t LegacyExtractFrontTrash(std::span<const uint8_t> buf) {
+	const auto searchLength = std::min(sizeof XivBundleHeader::Magic, buf.size());
+	return static_cast<size_t>(std::min(
+		std::search(buf.begin(), buf.end(), XivBundle::MagicConstant1, XivBundle::MagicConstant1 + searchLength),
+		std::search(buf.begin(), buf.end(), XivBundle::MagicConstant2, XivBundle::MagicConstant2 + searchLength)
+	) - buf.begin());
+}
+
+// Bundles separated by runs of trash; trash mostly consists of small integers, as in game data.
+static std::vector<uint8_t> MakeBuffer(std::mt19937& rng, size_t size, size_t averageTrashLength) {
+	std::vector<uint8_t> buf;
+	buf.reserve(size + 65536);
+	while (buf.size() < size) {
+		const auto trashLength = averageTrashLength ? rng() % (2 * averageTrashLength) : 0;
+		for (size_t i = 0; i < trashLength; ++i)
+			buf.push_back(static_cast<uint8_t>(rng() % 3 ? rng() % 16 : rng()));
+
+		const auto bundleLength = sizeof XivBundleHeader + rng() % 1024;
+		const auto offset = buf.size();
+		buf.resize(offset + bundleLength);
+		memcpy(&buf[offset], XivBundle::MagicConstant1, sizeof XivBundleHeader::Magic);
+		for (auto i = offset + sizeof XivBundleHeader::Magic; i < buf.size(); ++i)
+			buf[i] = static_cast<uint8_t>(rng() % 16);
+	}
+	return buf;
+}
+
+// Finds every magic the way TunnelXivStream does, skipping over the following 40 bytes each time.
+template<typename Fn>
+static std::pair<double, size_t> Run(const std::vector<uint8_t>& buf, Fn&& find) {
+	size_t found = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (auto remaining = std::span(buf); !remaining.empty();) {
+		const auto trashLength = find(remaining);
+		const auto skip = std::min(remaining.size(), trashLength + sizeof XivBundleHeader);
+		remaining = remaining.subspan(skip);
+		found += trashLength < skip;
+	}
+	return { std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), found };
+}
+
+int main() {
+	std::mt19937 rng(0);
+	for (const auto averageTrashLength : { 0, 64, 4096, 1048576 }) {
+		const auto buf = MakeBuffer(rng, 256 * 1048576, averageTrashLength);
+
+		const auto [legacyTime, legacyFound] = Run(buf, LegacyExtractFrontTrash);
+
+		XivBundleMagicScanner scanner;
+		const auto [scannerTime, scannerFound] = Run(buf, [&scanner](std::span<const uint8_t> remaining) {
+			const auto result = scanner.Find(remaining);
+			scanner.Consume(std::min(remaining.size(), result + sizeof XivBundleHeader));
+			return result;
+		});
+
+		std::cout << std::format("trash {:>7}: legacy {:>8.2f}MB/s ({} found), scanner {:>8.2f}MB/s ({} found)\n",
+			averageTrashLength,
+			buf.size() / 1048576. / legacyTime, legacyFound,
+			buf.size() / 1048576. / scannerTime, scannerFound);
+	}
+
+	// Data arriving in small pieces with no magic in it, scanned again after every arrival.
+	{
+		const auto buf = MakeBuffer(rng, 16 * 1048576, 16 * 1048576);
+		constexpr size_t ChunkSize = 1460;
+
+		auto start = std::chrono::steady_clock::now();
+		size_t legacyResult = 0;
+		for (size_t available = ChunkSize; available < 1048576; available += ChunkSize)
+			legacyResult = LegacyExtractFrontTrash(std::span(buf).subspan(0, available));
+		const auto legacyTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		XivBundleMagicScanner scanner;
+		size_t scannerResult = 0;
+		for (size_t available = ChunkSize; available < 1048576; available += ChunkSize)
+			scannerResult = scanner.Find(std::span(buf).subspan(0, available));
+		const auto scannerTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << std::format("incremental: legacy {:.3f}ms ({}), scanner {:.3f}ms ({})\n",
+			legacyTime * 1000, legacyResult, scannerTime * 1000, scannerResult);
+	}
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include "pch.h"
+
+#include <chrono>
+#include <random>
+
+#include <XivAlexanderCommon/Sqex/Network/Structure.h>
+#include <XivAlexanderCommon/Utils/ZlibWrapper.h>
+
+using namespace Sqex::Network::Structure;
+
+static size_t s_allocations = 0;
+
+void* operator new(size_t size) {
+	++s_allocations;
+	if (const auto p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
+
+static std::vector<uint8_t> MakeBody(std::mt19937& rng, uint16_t& messageCount) {
+	std::vector<uint8_t> body;
+	messageCount = static_cast<uint16_t>(1 + rng() % 16);
+	for (uint16_t i = 0; i < messageCount; ++i) {
+		const auto length = static_cast<uint32_t>(sizeof XivMessageHeader + sizeof XivIpcHeader + 8 * (rng() % 64));
+		const auto offset = body.size();
+		body.resize(offset + length);
+		auto& message = *reinterpret_cast<XivMessage*>(&body[offset]);
+		message.Length = length;
+		message.Type = MessageType::Ipc;
+		message.Data.Ipc.Type = IpcType::InterestedType;
+		message.Data.Ipc.SubType = static_cast<uint16_t>(rng() % 8);
+		for (auto j = sizeof XivMessageHeader + sizeof XivIpcHeader; j < length; ++j)
+			body[offset + j] = static_cast<uint8_t>(rng());
+	}
+	return body;
+}
+
+int main() {
+	constexpr size_t BundleCount = 100000;
+
+	std::mt19937 rng(0);
+	Utils::ZlibReusableDeflater deflater;
+	std::vector<std::vector<uint8_t>> bundles;
+	for (size_t i = 0; i < BundleCount; ++i) {
+		XivBundleHeader header{};
+		const auto body = MakeBody(rng, header.MessageCount);
+		const auto encoded = deflater(body);
+		header.CompressionType = CompressionType::Deflate;
+		header.DecodedBodyLength = static_cast<uint32_t>(body.size());
+		header.TotalLength = static_cast<uint32_t>(sizeof header + encoded.size());
+
+		auto& bundle = bundles.emplace_back(header.TotalLength);
+		memcpy(&bundle[0], &header, sizeof header);
+		memcpy(&bundle[sizeof header], encoded.data(), encoded.size());
+	}
+
+	Utils::ZlibReusableInflater inflater;
+	Utils::ZlibReusableDeflater reencoder;
+	Utils::Oodler oodler(Utils::OodleNetworkFunctions{});
+	XivMessageList messages;
+	uint64_t outputBytes = 0;
+
+	// warm up reusable buffers
+	reinterpret_cast<const XivBundle*>(bundles.front().data())->GetMessages(inflater, oodler, messages);
+	reencoder(messages.Compact());
+
+	s_allocations = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (const auto& bundle : bundles) {
+		reinterpret_cast<const XivBundle*>(bundle.data())->GetMessages(inflater, oodler, messages);
+		for (size_t i = 0; i < messages.Count(); ++i) {
+			if (messages[i].Data.Ipc.SubType == 0)
+				messages.Delete(i);
+		}
+		outputBytes += reencoder(messages.Compact()).size();
+	}
+	const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << std::format("{} bundles: {:.3f}us/bundle, {:.3f} allocations/bundle, {} bytes out\n",
+		BundleCount, elapsed / BundleCount, static_cast<double>(s_allocations) / BundleCount, outputBytes);
+	return 0;
+}
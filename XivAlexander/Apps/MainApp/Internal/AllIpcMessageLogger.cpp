@@ -19,7 +19,7 @@ struct XivAlexander::Apps::MainApp::Internal::AllIpcMessageLogger::Implementatio
 			: Impl(impl)
 			, Conn(conn) {
 
-			conn.AddIncomingFFXIVMessageHandler(this, [&](auto pMessage) {
+			conn.AddIncomingFFXIVMessageHandler(this, [&](auto pMessage, bool& modified) {
 				if (pMessage->Type == MessageType::Ipc && pMessage->Data.Ipc.Type == IpcType::InterestedType) {
 					const char* pszPossibleMessageType;
 					switch (pMessage->Length) {
@@ -55,8 +55,8 @@ struct XivAlexander::Apps::MainApp::Internal::AllIpcMessageLogger::Implementatio
 						pszPossibleMessageType ? pszPossibleMessageType : "");
 				}
 				return true;
-				});
-			conn.AddOutgoingFFXIVMessageHandler(this, [&](auto pMessage) {
+				}, { {MessageType::Ipc, IpcType::InterestedType} });
+			conn.AddOutgoingFFXIVMessageHandler(this, [&](auto pMessage, bool& modified) {
 				if (pMessage->Type == MessageType::Ipc && pMessage->Data.Ipc.Type == IpcType::InterestedType) {
 					const char* pszPossibleMessageType;
 					switch (pMessage->Length) {
@@ -76,7 +76,7 @@ struct XivAlexander::Apps::MainApp::Internal::AllIpcMessageLogger::Implementatio
 						pszPossibleMessageType ? pszPossibleMessageType : "");
 				}
 				return true;
-				});
+				}, { {MessageType::Ipc, IpcType::InterestedType} });
 		}
 
 		~SingleConnectionHandler() {
@@ -371,7 +371,10 @@ struct XivAlexander::Apps::MainApp::Internal::GameResourceOverrider::Implementat
 				s = s + 2;
 				static const auto SeStringTester = [](const char8_t* ptr) {
 					try {
-						void(Sqex::SeString(reinterpret_cast<const char*>(ptr)).Parsed());
+						Sqex::SeStringToken token;
+						for (Sqex::SeStringTokenizer tokenizer(reinterpret_cast<const char*>(ptr)); tokenizer.Next(token);) {
+							// pass
+						}
 						return true;
 					} catch (...) {
 						return false;
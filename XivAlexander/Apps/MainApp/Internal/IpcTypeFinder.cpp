@@ -19,7 +19,7 @@ struct XivAlexander::Apps::MainApp::Internal::IpcTypeFinder::Implementation {
 			: Impl(pImpl)
 			, Conn(conn) {
 
-			conn.AddIncomingFFXIVMessageHandler(this, [&](auto pMessage) {
+			conn.AddIncomingFFXIVMessageHandler(this, [&](auto pMessage, bool& modified) {
 				if (pMessage->Type == MessageType::Ipc && pMessage->Data.Ipc.Type == IpcType::InterestedType) {
 					if (pMessage->CurrentActor == pMessage->SourceActor) {
 						if (pMessage->Length == 0x9c ||
@@ -116,8 +116,8 @@ struct XivAlexander::Apps::MainApp::Internal::IpcTypeFinder::Implementation {
 					}
 				}
 				return true;
-			});
-			conn.AddOutgoingFFXIVMessageHandler(this, [&](auto pMessage) {
+			}, { {MessageType::Ipc, IpcType::InterestedType} });
+			conn.AddOutgoingFFXIVMessageHandler(this, [&](auto pMessage, bool& modified) {
 				if (pMessage->Type == MessageType::Ipc && pMessage->Data.Ipc.Type == IpcType::InterestedType) {
 					if (pMessage->Length == 0x40) {
 						// Test ActionRequest
@@ -132,7 +132,7 @@ struct XivAlexander::Apps::MainApp::Internal::IpcTypeFinder::Implementation {
 					}
 				}
 				return true;
-			});
+			}, { {MessageType::Ipc, IpcType::InterestedType} });
 		}
 
 		~SingleConnectionHandler() {
@@ -1,8 +1,17 @@
 #include "pch.h"
 #include "SocketHook.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <list>
+#include <unordered_map>
+
+#include <XivAlexanderCommon/Sqex/Network/BundleStream.h>
+#include <XivAlexanderCommon/Sqex/Network/Capture.h>
 #include <XivAlexanderCommon/Sqex/Network/Structure.h>
 #include <XivAlexanderCommon/Utils/ZlibWrapper.h>
+#include <XivAlexanderCommon/Utils/Win32/ThreadPool.h>
 
 #include "Apps/MainApp/App.h"
 #include "Config.h"
@@ -14,189 +23,101 @@ using namespace Sqex::Network::Structure;
 
 static Utils::OodleNetworkFunctions s_oodle{};
 
-class XivAlexander::Apps::MainApp::Internal::SingleConnection::SingleStream {
-	Misc::Logger& m_logger;
-	const std::string m_name;
-	Utils::ZlibReusableDeflater m_deflater;
-	Utils::ZlibReusableInflater m_inflater;
-	Utils::Oodler m_oodler, m_unoodler;
-
-	std::vector<uint8_t> m_buffer{};
-	size_t m_pointer = 0;
-
+class XivAlexander::Apps::MainApp::Internal::SingleConnection::SingleStream : public Sqex::Network::BundleStream {
 public:
-	class SingleStreamWriter {
-		SingleStream& m_stream;
-		const size_t m_offset;
-		size_t m_commitLength = 0;
-
-	public:
-		SingleStreamWriter(SingleStream& stream)
-			: m_stream(stream)
-			, m_offset(stream.m_buffer.size()) {
-		}
-
-		template<typename T>
-		T* Allocate(size_t length) {
-			m_stream.m_buffer.resize(m_offset + m_commitLength + length);
-			return reinterpret_cast<T*>(&m_stream.m_buffer[m_offset + m_commitLength]);
-		}
-
-		size_t Write(size_t length) {
-			m_commitLength += length;
-			return length;
-		}
-
-		~SingleStreamWriter() {  // NOLINT(bugprone-exception-escape)
-			m_stream.m_buffer.resize(m_offset + m_commitLength);
-		}
-	};
-
 	SingleStream(Misc::Logger& logger, std::string name)
-		: m_logger(logger)
-		, m_name(name)
-		, m_unoodler(s_oodle)
-		, m_oodler(s_oodle) {
+		: BundleStream(std::move(name), s_oodle, [&logger](const std::string& message) {
+			logger.Log(LogCategory::SocketHook, message, LogLevel::Warning);
+		}) {
 	}
+};
 
-	SingleStreamWriter Write() {
-		return { *this };
-	}
+// Immutable once built; modifications build a new table, so that it can be read without locking.
+class XivAlexander::Apps::MainApp::Internal::SingleConnection::MessageHandlerTable {
+public:
+	struct Registration {
+		size_t Token;
+		MessageMangler Mangler;
+		std::vector<MessageInterest> Interests;
+	};
 
-	void Write(const void* buf, size_t length) {
-		const auto uint8buf = static_cast<const uint8_t*>(buf);
-		m_buffer.insert(m_buffer.end(), uint8buf, uint8buf + length);
-	}
+private:
+	const std::vector<Registration> m_registrations;
 
-	template<typename T, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
-	void Write(const T& data) {
-		Write(&data, sizeof data);
-	}
+	std::vector<const MessageMangler*> m_any;
+	std::unordered_map<uint16_t, std::vector<const MessageMangler*>> m_byType;
+	std::unordered_map<uint32_t, std::vector<const MessageMangler*>> m_byIpcType;
+	std::unordered_map<uint64_t, std::vector<const MessageMangler*>> m_bySubType;
 
-	template<typename T = uint8_t, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
-	void Write(const std::span<T>& data) {
-		Write(data.data(), data.size_bytes());
+	static uint32_t MakeKey(MessageType type, IpcType ipcType) {
+		return (static_cast<uint32_t>(type) << 16) | static_cast<uint32_t>(ipcType);
 	}
 
-	template<typename T = uint8_t, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
-	[[nodiscard]] std::span<const T> Peek(size_t count = SIZE_MAX) const {
-		if (m_buffer.empty())
-			return {};
-		return {
-			reinterpret_cast<const T*>(&m_buffer[m_pointer]),
-			count == SIZE_MAX ? (m_buffer.size() - m_pointer) / sizeof(T) : count
-		};
+	static uint64_t MakeKey(MessageType type, IpcType ipcType, uint16_t subType) {
+		return (static_cast<uint64_t>(MakeKey(type, ipcType)) << 16) | subType;
 	}
 
-	template<typename T = uint8_t, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
-	void Consume(size_t count) {
-		m_pointer += count * sizeof(T);
-		if (m_pointer == m_buffer.size()) {
-			m_buffer.clear();
-			m_pointer = 0;
-		} else if (m_pointer > m_buffer.size()) {
-			m_buffer.clear();
-			m_pointer = 0;
-			m_logger.Log(LogCategory::SocketHook, "SingleStream: overconsuming", LogLevel::Warning);
-		}
+	static bool Matches(const MessageInterest& interest, std::optional<MessageType> type, std::optional<IpcType> ipcType, std::optional<uint16_t> subType) {
+		if (!interest.Type)
+			return true;
+		if (!type || *interest.Type != *type)
+			return false;
+		if (!interest.IpcType)
+			return true;
+		if (!ipcType || *interest.IpcType != *ipcType)
+			return false;
+		if (!interest.SubType)
+			return true;
+		return subType && *interest.SubType == *subType;
 	}
 
-	template<typename T, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
-	size_t Read(T* buf, size_t count) {
-		count = std::min(count, (m_buffer.size() - m_pointer) / sizeof(T));
-		memcpy(buf, &m_buffer[m_pointer], count * sizeof(T));
-		Consume<T>(count);
-		return count;
-	}
-
-	template<typename T = uint8_t, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
-	[[nodiscard]] size_t Available() const {
-		return (m_buffer.size() - m_pointer) / sizeof(T);
+	std::vector<const MessageMangler*> Collect(std::optional<MessageType> type, std::optional<IpcType> ipcType, std::optional<uint16_t> subType) const {
+		std::vector<const MessageMangler*> result;
+		for (const auto& registration : m_registrations) {
+			if (std::ranges::any_of(registration.Interests, [&](const auto& interest) { return Matches(interest, type, ipcType, subType); }))
+				result.push_back(&registration.Mangler);
+		}
+		return result;
 	}
 
-	void TunnelXivStream(SingleStream& target, const XivAlexander::Apps::MainApp::Internal::SingleConnection::MessageMangler& messageMangler) {
-		while (true) {
-			auto buf = Peek();
-			if (buf.empty())
-				break;
-
-			if (const auto trash = XivBundle::ExtractFrontTrash(buf); !trash.empty()) {
-				target.Write(trash);
-				Consume(trash.size_bytes());
-				buf = buf.subspan(trash.size_bytes());
-			}
-
-			// Incomplete header
-			if (buf.size_bytes() < sizeof XivBundleHeader)
-				break;
+public:
+	MessageHandlerTable(std::vector<Registration> registrations = {})
+		: m_registrations(std::move(registrations)) {
+		m_any = Collect(std::nullopt, std::nullopt, std::nullopt);
+		for (const auto& registration : m_registrations) {
+			for (const auto& interest : registration.Interests) {
+				if (!interest.Type)
+					continue;
+				if (!m_byType.contains(static_cast<uint16_t>(*interest.Type)))
+					m_byType.emplace(static_cast<uint16_t>(*interest.Type), Collect(interest.Type, std::nullopt, std::nullopt));
 
-			const auto* pGamePacket = reinterpret_cast<const XivBundle*>(buf.data());
+				if (!interest.IpcType)
+					continue;
+				if (const auto key = MakeKey(*interest.Type, *interest.IpcType); !m_byIpcType.contains(key))
+					m_byIpcType.emplace(key, Collect(interest.Type, interest.IpcType, std::nullopt));
 
-			// Invalid TotalLength
-			if (pGamePacket->TotalLength == 0) {
-				target.Write(buf.subspan(0, 1));
-				Consume(1);
-				continue;
+				if (!interest.SubType)
+					continue;
+				if (const auto key = MakeKey(*interest.Type, *interest.IpcType, *interest.SubType); !m_bySubType.contains(key))
+					m_bySubType.emplace(key, Collect(interest.Type, interest.IpcType, interest.SubType));
 			}
+		}
+	}
 
-			// Incomplete data
-			if (buf.size_bytes() < pGamePacket->TotalLength)
-				break;
-
-			try {
-				auto messages = pGamePacket->GetMessages(m_inflater, m_unoodler);
-				auto header = *pGamePacket;
-				header.TotalLength = static_cast<uint32_t>(sizeof XivBundleHeader);
-				header.MessageCount = 0;
-				header.CompressionType = pGamePacket->CompressionType;
-				header.DecodedBodyLength = 0;
-
-				for (auto& message : messages) {
-					const auto pMessage = reinterpret_cast<XivMessage*>(&message[0]);
-
-					if (!messageMangler(pMessage))
-						pMessage->Length = 0;
-
-					if (!pMessage->Length)
-						continue;
-
-					header.DecodedBodyLength += pMessage->Length;
-					header.MessageCount += 1;
-				}
-
-				std::vector<uint8_t> body;
-				body.reserve(header.DecodedBodyLength);
-				for (const auto& message : messages) {
-					if (!reinterpret_cast<const XivMessage*>(&message[0])->Length)
-						continue;
-					body.insert(body.end(), message.begin(), message.end());
-				}
-
-				std::span<uint8_t> encoded;
-				switch (header.CompressionType) {
-					case CompressionType::None:
-						encoded = { body };
-						break;
-					case CompressionType::Deflate:
-						encoded = m_deflater(body);
-						break;
-					case CompressionType::Oodle:
-						encoded = m_oodler.encode(body);
-						break;
-					default:
-						throw std::runtime_error("Unsupported compression method");
-				}
-
-				header.TotalLength += static_cast<uint32_t>(encoded.size());
-				target.Write(&header, sizeof XivBundleHeader);
-				target.Write(encoded);
-			} catch (const std::exception& e) {
-				m_logger.Format<XivAlexander::LogLevel::Warning>(XivAlexander::LogCategory::SocketHook, "{}: Error: {}\n{}", m_name, e.what(), pGamePacket->Represent());
-				target.Write(pGamePacket, pGamePacket->TotalLength);
-			}
+	[[nodiscard]] const std::vector<Registration>& Registrations() const {
+		return m_registrations;
+	}
 
-			Consume(pGamePacket->TotalLength);
+	[[nodiscard]] const std::vector<const MessageMangler*>& Find(const XivMessage& message) const {
+		if (message.Type == MessageType::Ipc) {
+			if (const auto it = m_bySubType.find(MakeKey(message.Type, message.Data.Ipc.Type, message.Data.Ipc.SubType)); it != m_bySubType.end())
+				return it->second;
+			if (const auto it = m_byIpcType.find(MakeKey(message.Type, message.Data.Ipc.Type)); it != m_byIpcType.end())
+				return it->second;
 		}
+		if (const auto it = m_byType.find(static_cast<uint16_t>(message.Type)); it != m_byType.end())
+			return it->second;
+		return m_any;
 	}
 };
 
@@ -205,8 +126,14 @@ struct XivAlexander::Apps::MainApp::Internal::SingleConnection::Implementation {
 	Internal::SocketHook& SocketHook;
 	bool Detaching = false;
 
-	std::map<size_t, std::vector<MessageMangler>> IncomingHandlers{};
-	std::map<size_t, std::vector<MessageMangler>> OutgoingHandlers{};
+	std::mutex HandlersMtx;
+	std::atomic<std::shared_ptr<const MessageHandlerTable>> IncomingHandlers{ std::make_shared<const MessageHandlerTable>() };
+	std::atomic<std::shared_ptr<const MessageHandlerTable>> OutgoingHandlers{ std::make_shared<const MessageHandlerTable>() };
+
+	// Tables that dispatches are calling handlers from right now, and the threads doing so; guarded by DispatchMtx.
+	std::mutex DispatchMtx;
+	std::condition_variable DispatchCv;
+	std::list<std::pair<const MessageHandlerTable*, DWORD>> ActiveDispatches;
 
 	std::deque<uint64_t> KeepAliveRequestTimestampsUs{};
 	std::deque<uint64_t> ObservedServerResponseList{};
@@ -252,28 +179,118 @@ struct XivAlexander::Apps::MainApp::Internal::SingleConnection::Implementation {
 
 	void ResolveAddresses();
 
-	void AttemptReceive() {
-		if (auto write = RecvRaw.Write();
-			!write.Write(std::max(0, SocketHook.recv.bridge(SingleConnection.m_socket, write.Allocate<char>(65536), 65536, 0))))
-			return;
+	void UpdateHandlers(std::atomic<std::shared_ptr<const MessageHandlerTable>>& table, const std::function<void(std::vector<MessageHandlerTable::Registration>&)>& modify) {
+		const auto lock = std::lock_guard(HandlersMtx);
+		auto registrations = table.load(std::memory_order_acquire)->Registrations();
+		modify(registrations);
+		table.store(std::make_shared<const MessageHandlerTable>(std::move(registrations)), std::memory_order_release);
+	}
 
-		ProcessRecvData();
+	std::pair<std::shared_ptr<const MessageHandlerTable>, Utils::CallOnDestruction> BeginDispatch(const std::atomic<std::shared_ptr<const MessageHandlerTable>>& table) {
+		const auto lock = std::lock_guard(DispatchMtx);
+		auto handlers = table.load(std::memory_order_acquire);
+		const auto it = ActiveDispatches.emplace(ActiveDispatches.end(), handlers.get(), GetCurrentThreadId());
+		return { std::move(handlers), Utils::CallOnDestruction([this, it]() {
+			{
+				const auto lock = std::lock_guard(DispatchMtx);
+				ActiveDispatches.erase(it);
+			}
+			DispatchCv.notify_all();
+		}) };
 	}
 
-	void AttemptSend() {
-		const auto data = SendProcessed.Peek<char>();
-		if (data.empty())
-			return;
+	// Waits until no dispatch is calling handlers from a table that has since been replaced.
+	void WaitForRetiredHandlers() {
+		auto lock = std::unique_lock(DispatchMtx);
 
-		const auto sent = SocketHook.send.bridge(SingleConnection.m_socket, data.data(), static_cast<int>(data.size_bytes()), 0);
-		if (sent == SOCKET_ERROR)
+		// Called from a handler; waiting would never end, and the change applies from the next dispatch on.
+		if (std::ranges::any_of(ActiveDispatches, [threadId = GetCurrentThreadId()](const auto& dispatch) { return dispatch.second == threadId; }))
 			return;
 
-		SendProcessed.Consume(sent);
+		DispatchCv.wait(lock, [this]() {
+			const auto incoming = IncomingHandlers.load(std::memory_order_acquire);
+			const auto outgoing = OutgoingHandlers.load(std::memory_order_acquire);
+			return std::ranges::all_of(ActiveDispatches, [&](const auto& dispatch) {
+				return dispatch.first == incoming.get() || dispatch.first == outgoing.get();
+				});
+			});
+	}
+
+	static void InsertHandler(std::vector<MessageHandlerTable::Registration>& registrations, size_t token, MessageMangler cb, std::vector<MessageInterest> interests) {
+		if (interests.empty())
+			interests.emplace_back();
+
+		// Keep handlers grouped by token, in the order of registration.
+		const auto it = std::ranges::upper_bound(registrations, token, {}, &MessageHandlerTable::Registration::Token);
+		registrations.insert(it, MessageHandlerTable::Registration{ token, std::move(cb), std::move(interests) });
+	}
+
+	void AddHandler(std::atomic<std::shared_ptr<const MessageHandlerTable>>& table, size_t token, MessageMangler cb, std::vector<MessageInterest> interests) {
+		UpdateHandlers(table, [&](auto& registrations) {
+			InsertHandler(registrations, token, std::move(cb), std::move(interests));
+			});
+	}
+
+	void ReplaceHandlers(size_t token, MessageMangler incoming, std::vector<MessageInterest> incomingInterests, MessageMangler outgoing, std::vector<MessageInterest> outgoingInterests) {
+		const auto build = [token](const std::atomic<std::shared_ptr<const MessageHandlerTable>>& table, MessageMangler cb, std::vector<MessageInterest> interests) {
+			auto registrations = table.load(std::memory_order_acquire)->Registrations();
+			std::erase_if(registrations, [token](const auto& r) { return r.Token == token; });
+			if (cb)
+				InsertHandler(registrations, token, std::move(cb), std::move(interests));
+			return std::make_shared<const MessageHandlerTable>(std::move(registrations));
+		};
+
+		const auto lock = std::lock_guard(HandlersMtx);
+		auto incomingTable = build(IncomingHandlers, std::move(incoming), std::move(incomingInterests));
+		auto outgoingTable = build(OutgoingHandlers, std::move(outgoing), std::move(outgoingInterests));
+
+		// Both are built before either is published; each direction goes straight from the old handlers to the new ones.
+		IncomingHandlers.store(std::move(incomingTable), std::memory_order_release);
+		OutgoingHandlers.store(std::move(outgoingTable), std::memory_order_release);
+	}
+
+	void RecordCapture(Sqex::Network::Capture::Direction direction, std::span<const uint8_t> data);
+
+	void AttemptReceive() {
+		auto write = RecvRaw.Write();
+		size_t receivedTotal = 0;
+
+		// Free space may come in two pieces when it wraps around the end of the ring buffer; keep going until
+		// the socket has nothing more (WSAEWOULDBLOCK, or a short read), the connection ends, or the buffer is full.
+		for (auto space = write.Allocate<uint8_t>(65536); !space.empty(); space = write.AllocateAvailable<uint8_t>(65536)) {
+			const auto received = SocketHook.recv.bridge(SingleConnection.m_socket, reinterpret_cast<char*>(space.data()), static_cast<int>(space.size()), 0);
+			if (received == SOCKET_ERROR || received == 0)
+				break;
+
+			RecordCapture(Sqex::Network::Capture::Direction::Recv, space.subspan(0, received));
+			write.Write(received);
+			receivedTotal += received;
+			if (static_cast<size_t>(received) < space.size())
+				break;
+		}
+
+		if (receivedTotal)
+			ProcessRecvData();
+	}
+
+	void AttemptSend() {
+		// Pending data may come in two pieces when it wraps around the end of the ring buffer; keep going until
+		// everything is sent or the socket stops taking more.
+		for (auto data = SendProcessed.Peek<char>(); !data.empty(); data = SendProcessed.Peek<char>()) {
+			const auto sent = SocketHook.send.bridge(SingleConnection.m_socket, data.data(), static_cast<int>(data.size_bytes()), 0);
+			if (sent == SOCKET_ERROR)
+				return;
+
+			SendProcessed.Consume(sent);
+			if (static_cast<size_t>(sent) < data.size_bytes())
+				return;
+		}
 	}
 
 	void ProcessRecvData() {
-		RecvRaw.TunnelXivStream(RecvProcessed, [&](auto* pMessage) {
+		const auto dispatch = BeginDispatch(IncomingHandlers);
+		const auto& handlers = dispatch.first;
+		RecvRaw.TunnelXivStream(RecvProcessed, [&](auto* pMessage, bool& modified) {
 			auto use = true;
 
 			switch (pMessage->Type) {
@@ -287,17 +304,15 @@ struct XivAlexander::Apps::MainApp::Internal::SingleConnection::Implementation {
 
 						// Add statistics sample
 						SingleConnection.ApplicationLatencyUs.AddValue(delayUs);
+						SingleConnection.LatencyHistograms.ApplicationLatencyUs.Record(delayUs);
 						if (const auto latency = SingleConnection.FetchSocketLatencyUs())
 							SingleConnection.SocketLatencyUs.AddValue(*latency);
 					}
 					break;
 
 				case MessageType::Ipc:
-					for (const auto& cbs : IncomingHandlers) {
-						for (const auto& cb : cbs.second) {
-							use &= cb(pMessage);
-						}
-					}
+					for (const auto cb : handlers->Find(*pMessage))
+						use &= (*cb)(pMessage, modified);
 			}
 
 			return use;
@@ -305,7 +320,9 @@ struct XivAlexander::Apps::MainApp::Internal::SingleConnection::Implementation {
 	}
 
 	void ProcessSendData() {
-		SendRaw.TunnelXivStream(SendProcessed, [&](auto* pMessage) {
+		const auto dispatch = BeginDispatch(OutgoingHandlers);
+		const auto& handlers = dispatch.first;
+		SendRaw.TunnelXivStream(SendProcessed, [&](auto* pMessage, bool& modified) {
 			auto use = true;
 
 			switch (pMessage->Type) {
@@ -314,11 +331,8 @@ struct XivAlexander::Apps::MainApp::Internal::SingleConnection::Implementation {
 					break;
 
 				case MessageType::Ipc:
-					for (const auto& cbs : OutgoingHandlers) {
-						for (const auto& cb : cbs.second) {
-							use &= cb(pMessage);
-						}
-					}
+					for (const auto cb : handlers->Find(*pMessage))
+						use &= (*cb)(pMessage, modified);
 			}
 
 			return use;
@@ -342,6 +356,21 @@ struct XivAlexander::Apps::MainApp::Internal::SocketHook::Implementation {
 	std::vector<std::pair<uint32_t, uint32_t>> AllowedPortRange;
 	Utils::CallOnDestruction::Multiple Cleanup;
 
+	int64_t NextLatencyHistogramSnapshotUs = 0;
+
+	// Latency histograms are only copied on the game main thread; serializing and writing them happens here.
+	// Work runs one at a time, and touches nothing declared after LatencyHistogramSnapshotStream.
+	std::ofstream LatencyHistogramSnapshotStream;
+	Utils::Win32::TpEnvironment LatencyHistogramWriter{ L"SocketHook/LatencyHistogramWriter", 1, THREAD_PRIORITY_LOWEST };
+
+	bool CaptureRequested = false;  // Accessed only from the game main thread.
+	std::atomic<bool> CaptureFailed = false;
+
+	// Capture chunks are only copied on the game main thread; opening the file and writing them happens here.
+	// Work runs one at a time in the order submitted, and touches nothing declared after CaptureWriter.
+	std::unique_ptr<Sqex::Network::Capture::Writer> CaptureWriter;
+	Utils::Win32::TpEnvironment CaptureWriterPool{ L"SocketHook/CaptureWriter", 1, THREAD_PRIORITY_LOWEST };
+
 	Implementation(Internal::SocketHook& socketHook, Apps::MainApp::App& app)
 		: Config(XivAlexander::Config::Acquire())
 		, SocketHook(socketHook)
@@ -425,6 +454,175 @@ struct XivAlexander::Apps::MainApp::Internal::SocketHook::Implementation {
 		return TestRemoteAddressResult::TakeOver;
 	}
 
+	// Only called from the game main thread.
+	void RecordCapture(SOCKET s, Sqex::Network::Capture::Direction direction, std::span<const uint8_t> data) {
+		if (!Config->Runtime.RecordNetworkCapture) {
+			if (CaptureRequested) {
+				CaptureRequested = false;
+				SubmitCaptureWork([this]() {
+					CaptureWriter.reset();
+					CaptureFailed = false;
+				});
+			}
+			return;
+		}
+		if (CaptureFailed || data.empty())
+			return;
+
+		CaptureRequested = true;
+		SubmitCaptureWork([this, timestampUs = Utils::QpcUs(), connectionId = static_cast<uint32_t>(s), direction, chunk = std::vector(data.begin(), data.end())]() {
+			AppendCaptureChunk(timestampUs, connectionId, direction, chunk);
+		});
+	}
+
+	void SubmitCaptureWork(std::function<void()> fn) {
+		try {
+			CaptureWriterPool.SubmitWork(std::move(fn));
+		} catch (const std::exception& e) {
+			SocketHook.m_logger->Format<LogLevel::Warning>(LogCategory::SocketHook, "Failed to queue recording network capture: {}", e.what());
+			CaptureFailed = true;
+		}
+	}
+
+	// Only called from CaptureWriterPool.
+	void AppendCaptureChunk(uint64_t timestampUs, uint32_t connectionId, Sqex::Network::Capture::Direction direction, std::span<const uint8_t> data) {
+		if (CaptureFailed)
+			return;
+
+		try {
+			if (!CaptureWriter) {
+				const auto dir = Config->Init.ResolveConfigStorageDirectoryPath() / "NetworkCaptures";
+				create_directories(dir);
+
+				const auto path = dir / std::format("{}.xacap", FormatLocalTimestamp());
+				CaptureWriter = std::make_unique<Sqex::Network::Capture::Writer>(path);
+				SocketHook.m_logger->Format(LogCategory::SocketHook, L"Recording network capture to {}", path.wstring());
+			}
+			CaptureWriter->Add(timestampUs, connectionId, direction, data);
+		} catch (const std::exception& e) {
+			SocketHook.m_logger->Format<LogLevel::Warning>(LogCategory::SocketHook, "Failed to record network capture: {}", e.what());
+			CaptureWriter.reset();
+			CaptureFailed = true;
+		}
+	}
+
+	static std::string FormatLocalTimestamp() {
+		SYSTEMTIME st;
+		GetLocalTime(&st);
+		return std::format("{:04}{:02}{:02}_{:02}{:02}{:02}", st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+	}
+
+	template<typename Fn>
+	void ForEachLatencyHistogram(const Internal::SingleConnection& conn, const Fn& fn) const {
+		fn("socketRttUs", conn.LatencyHistograms.SocketRttUs);
+		fn("applicationLatencyUs", conn.LatencyHistograms.ApplicationLatencyUs);
+		fn("serverResponseUs", conn.LatencyHistograms.ServerResponseUs);
+		fn("animationLockDriftUs", conn.LatencyHistograms.AnimationLockDriftUs);
+	}
+
+	struct LatencyHistogramSnapshot {
+		struct Connection {
+			uint64_t Socket;
+			std::string Local;
+			std::string Remote;
+			std::vector<std::pair<const char*, Utils::LatencyHistogram::Snapshot>> Histograms;
+		};
+
+		std::string Timestamp;
+		std::vector<Connection> Connections;
+
+		[[nodiscard]] nlohmann::json ToJson() const {
+			auto connections = nlohmann::json::array();
+			for (const auto& conn : Connections) {
+				auto histograms = nlohmann::json::object();
+				for (const auto& [name, histogram] : conn.Histograms)
+					histograms[name] = histogram.ToJson();
+				connections.push_back(nlohmann::json::object({
+					{"socket", conn.Socket},
+					{"local", conn.Local},
+					{"remote", conn.Remote},
+					{"histograms", std::move(histograms)},
+				}));
+			}
+			return nlohmann::json::object({
+				{"timestamp", Timestamp},
+				{"connections", std::move(connections)},
+			});
+		}
+
+		void WriteCsv(std::ostream& out) const {
+			out << "socket,local,remote,histogram,low,high,count\n";
+			for (const auto& conn : Connections) {
+				for (const auto& [name, histogram] : conn.Histograms)
+					histogram.WriteCsv(out, std::format("{},{},{},{}", conn.Socket, conn.Local, conn.Remote, name));
+			}
+		}
+	};
+
+	// Only called from the game main thread. Copies counters, and nothing else.
+	[[nodiscard]] LatencyHistogramSnapshot TakeLatencyHistogramSnapshot() const {
+		LatencyHistogramSnapshot snapshot{ .Timestamp = FormatLocalTimestamp() };
+		for (const auto& [s, conn] : Sockets) {
+			auto& target = snapshot.Connections.emplace_back(LatencyHistogramSnapshot::Connection{
+				.Socket = static_cast<uint64_t>(s),
+				.Local = Utils::ToString(conn->m_pImpl->LocalAddress),
+				.Remote = Utils::ToString(conn->m_pImpl->RemoteAddress),
+			});
+			ForEachLatencyHistogram(*conn, [&](const char* name, const Utils::LatencyHistogram& histogram) {
+				target.Histograms.emplace_back(name, histogram.TakeSnapshot());
+			});
+		}
+		return snapshot;
+	}
+
+	// Only called from the game main thread.
+	void WriteLatencyHistogramSnapshotIfDue() {
+		const auto intervalSeconds = Config->Runtime.LatencyHistogramSnapshotIntervalSeconds.Value();
+		if (intervalSeconds <= 0) {
+			if (NextLatencyHistogramSnapshotUs) {
+				NextLatencyHistogramSnapshotUs = 0;
+				SubmitLatencyHistogramWork([this]() { LatencyHistogramSnapshotStream.close(); });
+			}
+			return;
+		}
+
+		const auto nowUs = Utils::QpcUs();
+		if (nowUs < NextLatencyHistogramSnapshotUs)
+			return;
+		NextLatencyHistogramSnapshotUs = nowUs + intervalSeconds * 1000000LL;
+
+		SubmitLatencyHistogramWork([this, snapshot = TakeLatencyHistogramSnapshot()]() { AppendLatencyHistogramSnapshot(snapshot); });
+	}
+
+	void SubmitLatencyHistogramWork(std::function<void()> fn) {
+		try {
+			LatencyHistogramWriter.SubmitWork(std::move(fn));
+		} catch (const std::exception& e) {
+			SocketHook.m_logger->Format<LogLevel::Warning>(LogCategory::SocketHook, "Failed to queue writing latency histograms: {}", e.what());
+		}
+	}
+
+	// Only called from LatencyHistogramWriter.
+	void AppendLatencyHistogramSnapshot(const LatencyHistogramSnapshot& snapshot) {
+		try {
+			if (!LatencyHistogramSnapshotStream.is_open()) {
+				const auto dir = Config->Init.ResolveConfigStorageDirectoryPath() / "LatencyHistograms";
+				create_directories(dir);
+
+				const auto path = dir / std::format("{}_snapshots.jsonl", FormatLocalTimestamp());
+				LatencyHistogramSnapshotStream.open(path, std::ios::binary | std::ios::app);
+				if (!LatencyHistogramSnapshotStream)
+					throw std::runtime_error(std::format("Failed to open {}", path.string()));
+				SocketHook.m_logger->Format(LogCategory::SocketHook, L"Writing latency histogram snapshots to {}", path.wstring());
+			}
+			LatencyHistogramSnapshotStream << snapshot.ToJson().dump() << '\n';
+			LatencyHistogramSnapshotStream.flush();
+		} catch (const std::exception& e) {
+			SocketHook.m_logger->Format<LogLevel::Warning>(LogCategory::SocketHook, "Failed to write latency histogram snapshot: {}", e.what());
+			LatencyHistogramSnapshotStream.close();
+		}
+	}
+
 	SingleConnection* FindOrCreateSingleConnection(SOCKET s, bool existingOnly = false) {
 		if (const auto found = Sockets.find(s); found != Sockets.end()) {
 			found->second->ResolveAddresses();
@@ -493,6 +691,10 @@ void XivAlexander::Apps::MainApp::Internal::SingleConnection::Implementation::Re
 		);
 }
 
+void XivAlexander::Apps::MainApp::Internal::SingleConnection::Implementation::RecordCapture(Sqex::Network::Capture::Direction direction, std::span<const uint8_t> data) {
+	SocketHook.m_pImpl->RecordCapture(SingleConnection.m_socket, direction, data);
+}
+
 XivAlexander::Apps::MainApp::Internal::SingleConnection::Implementation::Implementation(Internal::SingleConnection& singleConnection, Internal::SocketHook& socketHook)
 	: SingleConnection(singleConnection)
 	, SocketHook(socketHook)
@@ -511,17 +713,26 @@ XivAlexander::Apps::MainApp::Internal::SingleConnection::SingleConnection(Intern
 
 XivAlexander::Apps::MainApp::Internal::SingleConnection::~SingleConnection() = default;
 
-void XivAlexander::Apps::MainApp::Internal::SingleConnection::AddIncomingFFXIVMessageHandler(void* token, MessageMangler cb) {
-	m_pImpl->IncomingHandlers[reinterpret_cast<size_t>(token)].emplace_back(std::move(cb));
+void XivAlexander::Apps::MainApp::Internal::SingleConnection::AddIncomingFFXIVMessageHandler(void* token, MessageMangler cb, std::vector<MessageInterest> interests) {
+	m_pImpl->AddHandler(m_pImpl->IncomingHandlers, reinterpret_cast<size_t>(token), std::move(cb), std::move(interests));
 }
 
-void XivAlexander::Apps::MainApp::Internal::SingleConnection::AddOutgoingFFXIVMessageHandler(void* token, MessageMangler cb) {
-	m_pImpl->OutgoingHandlers[reinterpret_cast<size_t>(token)].emplace_back(std::move(cb));
+void XivAlexander::Apps::MainApp::Internal::SingleConnection::AddOutgoingFFXIVMessageHandler(void* token, MessageMangler cb, std::vector<MessageInterest> interests) {
+	m_pImpl->AddHandler(m_pImpl->OutgoingHandlers, reinterpret_cast<size_t>(token), std::move(cb), std::move(interests));
 }
 
 void XivAlexander::Apps::MainApp::Internal::SingleConnection::RemoveMessageHandlers(void* token) {
-	m_pImpl->IncomingHandlers.erase(reinterpret_cast<size_t>(token));
-	m_pImpl->OutgoingHandlers.erase(reinterpret_cast<size_t>(token));
+	for (auto* table : { &m_pImpl->IncomingHandlers, &m_pImpl->OutgoingHandlers }) {
+		m_pImpl->UpdateHandlers(*table, [token = reinterpret_cast<size_t>(token)](auto& registrations) {
+			std::erase_if(registrations, [token](const auto& r) { return r.Token == token; });
+			});
+	}
+	m_pImpl->WaitForRetiredHandlers();
+}
+
+void XivAlexander::Apps::MainApp::Internal::SingleConnection::ReplaceMessageHandlers(void* token, MessageMangler incoming, std::vector<MessageInterest> incomingInterests, MessageMangler outgoing, std::vector<MessageInterest> outgoingInterests) {
+	m_pImpl->ReplaceHandlers(reinterpret_cast<size_t>(token), std::move(incoming), std::move(incomingInterests), std::move(outgoing), std::move(outgoingInterests));
+	m_pImpl->WaitForRetiredHandlers();
 }
 
 void XivAlexander::Apps::MainApp::Internal::SingleConnection::ResolveAddresses() {
@@ -550,6 +761,7 @@ std::optional<int64_t> XivAlexander::Apps::MainApp::Internal::SingleConnection::
 	} else {
 		const auto latency = static_cast<int64_t>(info.RttUs);
 		SocketLatencyUs.AddValue(latency);
+		LatencyHistograms.SocketRttUs.Record(latency);
 		return std::make_optional(latency);
 	}
 };
@@ -694,6 +906,7 @@ XivAlexander::Apps::MainApp::Internal::SocketHook::SocketHook(Apps::MainApp::App
 							if (conn == nullptr)
 								return send.bridge(s, buf, len, flags);
 
+							m_pImpl->RecordCapture(s, Sqex::Network::Capture::Direction::Send, { reinterpret_cast<const uint8_t*>(buf), static_cast<size_t>(len) });
 							conn->m_pImpl->SendRaw.Write(buf, len);
 							conn->m_pImpl->ProcessSendData();
 							conn->m_pImpl->AttemptSend();
@@ -755,6 +968,8 @@ XivAlexander::Apps::MainApp::Internal::SocketHook::SocketHook(Apps::MainApp::App
 									++it;
 							}
 
+							m_pImpl->WriteLatencyHistogramSnapshotIfDue();
+
 							return static_cast<int>((readfds ? readfds->fd_count : 0) +
 								(writefds ? writefds->fd_count : 0) +
 								(exceptfds ? exceptfds->fd_count : 0));
@@ -791,6 +1006,10 @@ XivAlexander::Apps::MainApp::Internal::SocketHook::~SocketHook() {
 		Sleep(1);
 	}
 
+	// Let queued histogram snapshots, exports, and capture chunks reach the disk.
+	m_pImpl->LatencyHistogramWriter.WaitOutstanding();
+	m_pImpl->CaptureWriterPool.WaitOutstanding();
+
 	if (const auto hGameWnd = m_pImpl->App.GetGameWindowHandle(false)) {
 		// Let it process main message loop first to ensure that no socket operation is in progress
 		SendMessageW(hGameWnd, WM_NULL, 0, 0);
@@ -850,6 +1069,18 @@ std::wstring XivAlexander::Apps::MainApp::Internal::SocketHook::Describe() const
 				} else
 					result += m_pImpl->Config->Runtime.GetStringRes(IDS_SOCKETHOOK_SOCKET_DESCRIBE_PING_LATENCY_FAILURE);
 
+				result += m_pImpl->Config->Runtime.FormatStringRes(IDS_SOCKETHOOK_SOCKET_DESCRIBE_BUNDLES,
+					conn->m_pImpl->RecvRaw.PassedThroughBundleCount() + conn->m_pImpl->RecvRaw.ReencodedBundleCount(),
+					conn->m_pImpl->RecvRaw.PassedThroughBundleCount(),
+					conn->m_pImpl->SendRaw.PassedThroughBundleCount() + conn->m_pImpl->SendRaw.ReencodedBundleCount(),
+					conn->m_pImpl->SendRaw.PassedThroughBundleCount());
+
+				result += m_pImpl->Config->Runtime.FormatStringRes(IDS_SOCKETHOOK_SOCKET_DESCRIBE_BUFFERS,
+					conn->m_pImpl->RecvRaw.Available() + conn->m_pImpl->RecvProcessed.Available(),
+					conn->m_pImpl->RecvRaw.PeakBufferedBytes() + conn->m_pImpl->RecvProcessed.PeakBufferedBytes(),
+					conn->m_pImpl->SendRaw.Available() + conn->m_pImpl->SendProcessed.Available(),
+					conn->m_pImpl->SendRaw.PeakBufferedBytes() + conn->m_pImpl->SendProcessed.PeakBufferedBytes());
+
 				{
 					const auto [mean, dev] = conn->ApplicationLatencyUs.MeanAndDeviation();
 					result += m_pImpl->Config->Runtime.FormatStringRes(IDS_SOCKETHOOK_SOCKET_DESCRIBE_RESPONSE_DELAY,
@@ -862,3 +1093,30 @@ std::wstring XivAlexander::Apps::MainApp::Internal::SocketHook::Describe() const
 		}
 	}
 }
+
+std::filesystem::path XivAlexander::Apps::MainApp::Internal::SocketHook::ExportLatencyHistograms(const std::filesystem::path& directory) const {
+	if (!m_pImpl)
+		return {};
+
+	auto snapshot = m_pImpl->TakeLatencyHistogramSnapshot();
+	const auto basePath = directory / snapshot.Timestamp;
+	const auto jsonPath = std::filesystem::path(basePath).replace_extension(".json");
+	const auto csvPath = std::filesystem::path(basePath).replace_extension(".csv");
+
+	m_pImpl->SubmitLatencyHistogramWork([this, directory, jsonPath, csvPath, snapshot = std::move(snapshot)]() {
+		try {
+			create_directories(directory);
+			Utils::SaveJsonToFile(jsonPath, snapshot.ToJson());
+
+			std::ofstream csv(csvPath, std::ios::binary);
+			if (!csv)
+				throw std::runtime_error(std::format("Failed to open {}", csvPath.string()));
+			snapshot.WriteCsv(csv);
+
+			m_logger->Format(LogCategory::SocketHook, L"Exported latency histograms to {}", jsonPath.wstring());
+		} catch (const std::exception& e) {
+			m_logger->Format<LogLevel::Warning>(LogCategory::SocketHook, "Failed to export latency histograms: {}", e.what());
+		}
+	});
+	return jsonPath;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <XivAlexanderCommon/Utils/LatencyHistogram.h>
 #include <XivAlexanderCommon/Utils/ListenerManager.h>
 #include <XivAlexanderCommon/Utils/NumericStatisticsTracker.h>
 
@@ -17,6 +18,8 @@ namespace Sqex::Network {
 	namespace Structure {
 		struct XivBundle;
 		struct XivMessage;
+		enum class MessageType : uint16_t;
+		enum class IpcType : uint16_t;
 	}
 }
 
@@ -32,15 +35,29 @@ namespace XivAlexander::Apps::MainApp::Internal {
 		const std::unique_ptr<Implementation> m_pImpl;
 
 		class SingleStream;
+		class MessageHandlerTable;
 
 	public:
 		SingleConnection(SocketHook& hook, SOCKET s);
 		~SingleConnection();
 
-		typedef std::function<bool(Sqex::Network::Structure::XivMessage*)> MessageMangler;
-		void AddIncomingFFXIVMessageHandler(void* token, MessageMangler cb);
-		void AddOutgoingFFXIVMessageHandler(void* token, MessageMangler cb);
+		// Return false to drop the message. Set modified to true if the message has been changed in place.
+		typedef std::function<bool(Sqex::Network::Structure::XivMessage*, bool& modified)> MessageMangler;
+
+		// Unset fields match anything. IpcType is only looked at if Type is set, and SubType only if IpcType is set.
+		struct MessageInterest {
+			std::optional<Sqex::Network::Structure::MessageType> Type;
+			std::optional<Sqex::Network::Structure::IpcType> IpcType;
+			std::optional<uint16_t> SubType;
+		};
+
+		// Handlers are called only for messages matching any of interests, or for every message if interests is empty.
+		void AddIncomingFFXIVMessageHandler(void* token, MessageMangler cb, std::vector<MessageInterest> interests = {});
+		void AddOutgoingFFXIVMessageHandler(void* token, MessageMangler cb, std::vector<MessageInterest> interests = {});
+		// Returns after messages being dispatched to the removed handlers are done with, unless called from a handler.
 		void RemoveMessageHandlers(void* token);
+		// Replaces every handler registered with token without a moment where none of them are registered; a null mangler leaves that direction without one.
+		void ReplaceMessageHandlers(void* token, MessageMangler incoming, std::vector<MessageInterest> incomingInterests, MessageMangler outgoing, std::vector<MessageInterest> outgoingInterests);
 		void ResolveAddresses();
 
 		[[nodiscard]] auto Socket() const { return m_socket; }
@@ -50,6 +67,14 @@ namespace XivAlexander::Apps::MainApp::Internal {
 		Utils::NumericStatisticsTracker SocketLatencyUs{ 10, 0 };
 		Utils::NumericStatisticsTracker ApplicationLatencyUs{ 10, 0 };
 		const Utils::NumericStatisticsTracker* GetPingLatencyTrackerUs() const;
+
+		// Whole-session distributions, kept alongside the short windows above to show tail latency.
+		struct {
+			Utils::LatencyHistogram SocketRttUs;
+			Utils::LatencyHistogram ApplicationLatencyUs;  // Keepalive round trip
+			Utils::LatencyHistogram ServerResponseUs;  // Action request to action effect
+			Utils::LatencyHistogram AnimationLockDriftUs{ true };  // Next action request relative to the expected end of animation lock
+		} LatencyHistograms;
 	};
 
 	class SocketHook {
@@ -86,5 +111,9 @@ namespace XivAlexander::Apps::MainApp::Internal {
 		void ReleaseSockets();
 
 		[[nodiscard]] std::wstring Describe() const;
+
+		// Takes a snapshot of latency histograms of all connections, and returns the path to the JSON file it will be written to.
+		// Files are written in the background, as JSON and CSV in given directory. Call from the game main thread.
+		std::filesystem::path ExportLatencyHistograms(const std::filesystem::path& directory) const;
 	};
 }
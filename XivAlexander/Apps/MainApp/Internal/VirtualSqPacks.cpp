@@ -12,6 +12,7 @@
 #include <XivAlexanderCommon/Sqex/Sound/Reader.h>
 #include <XivAlexanderCommon/Sqex/Sound/Writer.h>
 #include <XivAlexanderCommon/Sqex/Sqpack/BinaryEntryProvider.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/CompressedEntryCache.h>
 #include <XivAlexanderCommon/Sqex/Sqpack/Creator.h>
 #include <XivAlexanderCommon/Sqex/Sqpack/EntryProvider.h>
 #include <XivAlexanderCommon/Sqex/Sqpack/EntryRawStream.h>
@@ -20,6 +21,7 @@
 #include <XivAlexanderCommon/Sqex/Sqpack/RandomAccessStreamAsEntryProviderView.h>
 #include <XivAlexanderCommon/Sqex/Sqpack/Reader.h>
 #include <XivAlexanderCommon/Sqex/Sqpack/TextureEntryProvider.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/TieredEntryDataStore.h>
 #include <XivAlexanderCommon/Sqex/ThirdParty/TexTools.h>
 #include <XivAlexanderCommon/Utils/Win32/Process.h>
 #include <XivAlexanderCommon/Utils/Win32/TaskDialogBuilder.h>
@@ -45,6 +47,8 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 	static constexpr int PathTypeIndex2 = -2;
 	static constexpr int PathTypeInvalid = -3;
 
+	static constexpr uint64_t CompressedEntryCacheMaxBytes = 4ULL * 1024 * 1024 * 1024;
+
 	const Misc::GameInstallationDetector::GameReleaseInfo GameReleaseInfo;
 
 	std::map<std::filesystem::path, Sqex::Sqpack::Creator::SqpackViews> SqpackViews;
@@ -71,6 +75,7 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 		const auto actCtx = Dll::ActivationContext().With();
 		Apps::MainApp::Window::ProgressPopupWindow progressWindow(Dll::FindGameMainWindow(false));
 		progressWindow.Show();
+		ApplyModdedFileMemoryBudget();
 		InitializeSqPacks(progressWindow);
 		ReflectUsedEntries(true);
 
@@ -78,12 +83,33 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 		Cleanup += Config->Runtime.MuteVoice_Cm.OnChange([this]() { ReflectUsedEntries(); });
 		Cleanup += Config->Runtime.MuteVoice_Emote.OnChange([this]() { ReflectUsedEntries(); });
 		Cleanup += Config->Runtime.MuteVoice_Line.OnChange([this]() { ReflectUsedEntries(); });
+		Cleanup += Config->Runtime.ModdedFileRawDataBudgetMb.OnChange([this]() { ApplyModdedFileMemoryBudget(); });
+		Cleanup += Config->Runtime.ModdedFileMemoryBudgetMb.OnChange([this]() { ApplyModdedFileMemoryBudget(); });
 	}
 
 	~Implementation() {
 		Cleanup.Clear();
 	}
 
+	void ApplyModdedFileMemoryBudget() const {
+		const auto rawMb = Config->Runtime.ModdedFileRawDataBudgetMb.Value();
+		const auto memoryMb = Config->Runtime.ModdedFileMemoryBudgetMb.Value();
+		Sqex::Sqpack::TieredEntryDataStore::Instance()->SetBudget(
+			rawMb ? rawMb * 1048576 : Sqex::Sqpack::TieredEntryDataStore::DefaultRawBudget,
+			memoryMb ? memoryMb * 1048576 : Sqex::Sqpack::TieredEntryDataStore::DefaultMemoryBudget);
+	}
+
+	void LogModdedFileMemoryUsage() const {
+		const auto stats = Sqex::Sqpack::TieredEntryDataStore::Instance()->GetStatistics();
+		Logger->Format(LogCategory::VirtualSqPacks,
+			"Modded file data: {:.2f}MB in total; {} raw ({:.2f}MB), {} compressed ({:.2f}MB), {} spilled ({:.2f}MB; file {:.2f}MB with {:.2f}MB free)",
+			static_cast<double>(stats.OriginalBytes) / 1048576,
+			stats.RawCount, static_cast<double>(stats.RawBytes) / 1048576,
+			stats.CompressedCount, static_cast<double>(stats.CompressedBytes) / 1048576,
+			stats.SpilledCount, static_cast<double>(stats.SpilledBytes) / 1048576,
+			static_cast<double>(stats.SpillFileBytes) / 1048576, static_cast<double>(stats.SpillFileFreeBytes) / 1048576);
+	}
+
 	std::shared_ptr<Sqex::RandomAccessStream> GetOriginalEntry(const Sqex::Sqpack::EntryPathSpec& pathSpec) const {
 		for (const auto& pack : SqpackViews | std::views::values) {
 			auto it = pack.HashOnlyEntries.find(pathSpec);
@@ -294,6 +320,7 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 				dataView->Flush();
 			}
 		}
+		LogModdedFileMemoryUsage();
 
 		if (!isCalledFromConstructor)
 			Sqpacks.OnTtmpSetsChanged();
@@ -501,8 +528,10 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 								for (size_t i = 0; i < 256; ++i) {
 									writer.SetSoundEntry(i, Sqex::Sound::ScdWriter::SoundEntry::EmptyEntry());
 								}
+								auto scd = writer.Export();
+								const auto compressionLevel = Config->Runtime.GetModdedFileCompressionLevel(Sqex::Sqpack::SqData::FileEntryType::Binary, scd.size());
 								EmptyScd = std::make_shared<Sqex::MemoryRandomAccessStream>(
-									Sqex::Sqpack::MemoryBinaryEntryProvider("dummy/dummy", std::make_shared<Sqex::MemoryRandomAccessStream>(writer.Export()), Config->Runtime.CompressModdedFiles ? Z_BEST_COMPRESSION : Z_NO_COMPRESSION)
+									Sqex::Sqpack::MemoryBinaryEntryProvider("dummy/dummy", std::make_shared<Sqex::MemoryRandomAccessStream>(std::move(scd)), compressionLevel)
 									.ReadStreamIntoVector<uint8_t>(0));
 								//EmptyScd = std::make_shared<Sqex::MemoryRandomAccessStream>(
 								//	Sqex::Sqpack::EmptyOrObfuscatedEntryProvider("dummy/dummy", std::make_shared<Sqex::MemoryRandomAccessStream>(writer.Export()))
@@ -704,19 +733,25 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 			const auto dataStream = std::make_shared<Sqex::FileRandomAccessStream>(Utils::Win32::Handle{ dataFile, false });
 
 			const auto extractedStateFile = ttmpDir / "compression";
-			bool currentlyCompressed = false, compressAgain = false;
+			auto currentPolicy = Sqex::Sqpack::CompressionPolicy::None;
+			bool compressAgain = false;
 			if (!exists(extractedStateFile)) {
 				compressAgain = true;
 			} else {
 				std::string s;
 				std::ifstream(extractedStateFile) >> s;
-				currentlyCompressed = s == "true";
 
-				compressAgain = currentlyCompressed != Config->Runtime.CompressModdedFiles;
+				// "true" and "false" are from before compression policies existed.
+				if (s == "true")
+					currentPolicy = Sqex::Sqpack::CompressionPolicy::Maximum;
+				else if (s != "false")
+					from_json(nlohmann::json(s), currentPolicy);
+
+				compressAgain = currentPolicy != Config->Runtime.GetModdedFileCompressionPolicy();
 			}
 
 			if (compressAgain) {
-				currentlyCompressed = Config->Runtime.CompressModdedFiles.Value();
+				currentPolicy = Config->Runtime.GetModdedFileCompressionPolicy();
 
 				uint64_t progressMax = 0, progressCurrent = 0;
 				list.ForEachEntry([&](const auto& entry) { progressMax += entry.ModSize; });
@@ -728,6 +763,8 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 					auto out = Utils::Win32::Handle::FromCreateFile(tempTtmpdPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS);
 					uint64_t outPtr = 0;
 
+					Sqex::Sqpack::CompressedEntryCache compressedEntryCache(Config->Init.ResolveConfigStorageDirectoryPath() / "Cached" / "CompressedEntries");
+
 					std::mutex writeMtx;
 					Utils::Win32::TpEnvironment pool(L"CompressTtmpEntry/pool");
 					list.ForEachEntry([&](Sqex::ThirdParty::TexTools::ModEntry& entry) {
@@ -740,31 +777,32 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 							const auto pathSpec = Sqex::Sqpack::EntryPathSpec(entry.FullPath);
 							std::shared_ptr<Sqex::Sqpack::EntryProvider> stream = std::make_shared<Sqex::Sqpack::RandomAccessStreamAsEntryProviderView>(pathSpec, dataStream, entry.ModOffset, entry.ModSize);
 							auto rawStream = std::make_shared<Sqex::Sqpack::EntryRawStream>(stream);
+							auto entryType = rawStream->EntryType();
 
-							switch (rawStream->EntryType()) {
-								case Sqex::Sqpack::SqData::FileEntryType::EmptyOrObfuscated:
-									if (const auto header = stream->ReadStream<Sqex::Sqpack::SqData::FileEntryHeader>(0);
-										header.DecompressedSize != header.BlockCountOrVersion || header.DecompressedSize == 0) {
-										break;
+							if (entryType == Sqex::Sqpack::SqData::FileEntryType::EmptyOrObfuscated) {
+								if (const auto header = stream->ReadStream<Sqex::Sqpack::SqData::FileEntryHeader>(0);
+									header.DecompressedSize == header.BlockCountOrVersion && header.DecompressedSize != 0) {
+									entryType = Sqex::Sqpack::SqData::FileEntryType::Binary;
+								}
+							}
+
+							if (entryType == Sqex::Sqpack::SqData::FileEntryType::Binary
+								|| entryType == Sqex::Sqpack::SqData::FileEntryType::Model
+								|| entryType == Sqex::Sqpack::SqData::FileEntryType::Texture) {
+								const auto raw = std::make_shared<Sqex::MemoryRandomAccessStream>(rawStream->ReadStreamIntoVector<uint8_t>(0));
+								rawStream = nullptr;
+
+								const auto compressionLevel = Sqex::Sqpack::GetCompressionLevel(currentPolicy, entryType, raw->StreamSize());
+								stream = compressedEntryCache.GetOrBuild(pathSpec, *raw, entryType, compressionLevel, [&]() -> std::shared_ptr<Sqex::Sqpack::EntryProvider> {
+									switch (entryType) {
+										case Sqex::Sqpack::SqData::FileEntryType::Model:
+											return std::make_shared<Sqex::Sqpack::MemoryModelEntryProvider>(pathSpec, raw, compressionLevel);
+										case Sqex::Sqpack::SqData::FileEntryType::Texture:
+											return std::make_shared<Sqex::Sqpack::MemoryTextureEntryProvider>(pathSpec, raw, compressionLevel);
+										default:
+											return std::make_shared<Sqex::Sqpack::MemoryBinaryEntryProvider>(pathSpec, raw, compressionLevel);
 									}
-									[[fallthrough]];
-
-								case Sqex::Sqpack::SqData::FileEntryType::Binary:
-									//if (currentlyCompressed)
-										stream = std::make_shared<Sqex::Sqpack::MemoryBinaryEntryProvider>(pathSpec, std::move(rawStream), currentlyCompressed ? Z_BEST_COMPRESSION : Z_NO_COMPRESSION);
-									//else
-									//	stream = std::make_shared<Sqex::Sqpack::EmptyOrObfuscatedEntryProvider>(pathSpec, rawStream);
-									break;
-
-								case Sqex::Sqpack::SqData::FileEntryType::Model:
-									stream = std::make_shared<Sqex::Sqpack::MemoryModelEntryProvider>(pathSpec, std::move(rawStream), currentlyCompressed ? Z_BEST_COMPRESSION : Z_NO_COMPRESSION);
-									// stream = std::make_shared<Sqex::Sqpack::EmptyOrObfuscatedEntryProvider>(pathSpec, rawStream);
-									break;
-
-								case Sqex::Sqpack::SqData::FileEntryType::Texture:
-									stream = std::make_shared<Sqex::Sqpack::MemoryTextureEntryProvider>(pathSpec, std::move(rawStream), currentlyCompressed ? Z_BEST_COMPRESSION : Z_NO_COMPRESSION);
-									// stream = std::make_shared<Sqex::Sqpack::EmptyOrObfuscatedEntryProvider>(pathSpec, rawStream);
-									break;
+									});
 							}
 
 							if (progressWindow.GetCancelEvent().Wait(0) == WAIT_OBJECT_0)
@@ -796,6 +834,10 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 
 					pool.WaitOutstanding();
 
+					Logger->Format(LogCategory::VirtualSqPacks, "Rewrote {}: {} entries reused from cache, {} entries compressed",
+						ttmplPath.wstring(), compressedEntryCache.Hits(), compressedEntryCache.Misses());
+					compressedEntryCache.Trim(CompressedEntryCacheMaxBytes);
+
 					nlohmann::json j;
 					to_json(j, list);
 					Utils::SaveJsonToFile(tempTtmplPath, j);
@@ -836,7 +878,9 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 					progressWindow.Show();
 				} while (WAIT_TIMEOUT == progressWindow.DoModalLoop(100, { workerThread }));
 
-				std::ofstream(extractedStateFile) << (currentlyCompressed ? "true" : "false");
+				nlohmann::json policyJson;
+				to_json(policyJson, currentPolicy);
+				std::ofstream(extractedStateFile) << policyJson.get<std::string>();
 				dataFile = Utils::Win32::Handle::FromCreateFile(ttmpdPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN);
 			}
 
@@ -951,7 +995,11 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 					exhTable.emplace(pair);
 
 				std::string currentCacheKeys("VERSION:4\n");
-				currentCacheKeys += Config->Runtime.CompressModdedFiles ? "compress:true\n" : "compress:false\n";
+				currentCacheKeys += std::format("compress:{}\n", static_cast<int>(Config->Runtime.GetModdedFileCompressionPolicy()));
+
+				// Per-sheet cache keys leave out game versions; locations of source EXH/D files in sqpack indices are used per sheet instead.
+				std::string sheetCacheKeys(std::format("VERSION:{}\n", Utils::Win32::FormatModuleVersionString(Dll::Module().PathOf()).first));
+				sheetCacheKeys += std::format("compress:{}\n", static_cast<int>(Config->Runtime.GetModdedFileCompressionPolicy()));
 				{
 					const auto gameRoot = indexFile.parent_path().parent_path().parent_path();
 					const auto versionFile = Utils::Win32::Handle::FromCreateFile(gameRoot / "ffxivgame.ver", GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0);
@@ -959,11 +1007,16 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 					currentCacheKeys += std::format("SQPACK:{}:{}\n", canonical(gameRoot).wstring(), std::string(versionContent.begin(), versionContent.end()));
 				}
 
-				currentCacheKeys += "LANG";
-				for (const auto& lang : fallbackLanguageList)
-					currentCacheKeys += std::format(":{}", static_cast<int>(lang));
-				currentCacheKeys += "\n";
+				{
+					std::string languageKey("LANG");
+					for (const auto& lang : fallbackLanguageList)
+						languageKey += std::format(":{}", static_cast<int>(lang));
+					languageKey += "\n";
+					currentCacheKeys += languageKey;
+					sheetCacheKeys += languageKey;
+				}
 
+				const auto gameReader = Sqex::Sqpack::Reader(indexFile);
 				std::vector<std::unique_ptr<Sqex::Sqpack::Reader>> readers;
 				for (const auto& additionalSqpackRootDirectory : additionalGameRootDirectories) {
 					const auto file = additionalSqpackRootDirectory / "sqpack" / indexFile.parent_path().filename() / indexFile.filename();
@@ -996,6 +1049,7 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 					encoder.Get(reinterpret_cast<byte*>(&buf[0]), buf.size());
 
 					currentCacheKeys += std::format("CONF:{}:{}\n", configFile.wstring(), buf);
+					sheetCacheKeys += std::format("CONF:{}\n", buf);
 				}
 
 				auto needRecreate = true;
@@ -1087,6 +1141,17 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 						const auto ttmpd = Utils::Win32::Handle::FromCreateFile(cachedDir / "TTMPD.mpd.tmp", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, 0);
 						uint64_t ttmplPtr = 0, ttmpdPtr = 0;
 						std::mutex writeMtx;
+						const auto appendEntry = [&](const std::string& fullPath, std::span<const char> data) {
+							const auto lock = std::lock_guard(writeMtx);
+							const auto entryLine = std::format("{}\n", nlohmann::json::object({
+								{"FullPath", fullPath},
+								{"ModOffset", ttmpdPtr},
+								{"ModSize", data.size()},
+								{"DatFile", "0a0000"},
+								}).dump());
+							ttmplPtr += ttmpl.Write(ttmplPtr, std::span(entryLine));
+							ttmpdPtr += ttmpd.Write(ttmpdPtr, data);
+						};
 
 						std::string errorMessage;
 						const auto compressThread = Utils::Win32::Thread(L"CompressThread", [&]() {
@@ -1108,6 +1173,9 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 
 										lastStep = "Load source EXH/D files";
 										const auto exhPath = Sqex::Sqpack::EntryPathSpec(std::format("exd/{}.exh", exhName));
+										const auto sheetCacheIndexPath = cachedDir / "Sheets" / std::format("{}.json", exhName);
+										const auto sheetCacheDataPath = cachedDir / "Sheets" / std::format("{}.bin", exhName);
+										std::string sheetCacheKey;
 										std::unique_ptr<Sqex::Excel::Depth2ExhExdCreator> exCreator;
 										{
 											const auto exhReaderSource = Sqex::Excel::ExhReader(exhName, *creator[exhPath]);
@@ -1121,6 +1189,68 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 												return;
 											}
 
+											lastStep = "Look up sheet cache";
+											// Patches append changed files to dat files instead of overwriting them, so an entry that keeps
+											// its place and allocated size in the index has the same content; nothing has to be read here.
+											CryptoPP::SHA1 sourceHash;
+											const auto addToSourceHash = [&sourceHash](const Sqex::Sqpack::Reader& reader, const Sqex::Sqpack::EntryPathSpec& pathSpec) {
+												uint32_t locator = UINT32_MAX;
+												uint64_t allocation = UINT64_MAX;
+												try {
+													locator = reader.GetLocator(pathSpec).Value;
+													allocation = reader.GetEntryProvider(pathSpec)->StreamSize();
+												} catch (const std::out_of_range&) {
+													// pass
+												}
+												sourceHash.Update(reinterpret_cast<const byte*>(&locator), sizeof locator);
+												sourceHash.Update(reinterpret_cast<const byte*>(&allocation), sizeof allocation);
+											};
+
+											sourceHash.Update(reinterpret_cast<const byte*>(sheetCacheKeys.data()), sheetCacheKeys.size());
+											sourceHash.Update(reinterpret_cast<const byte*>(exhName.c_str()), exhName.size() + 1);
+											addToSourceHash(gameReader, exhPath);
+											for (const auto language : exhReaderSource.Languages)
+												for (const auto& page : exhReaderSource.Pages)
+													addToSourceHash(gameReader, exhReaderSource.GetDataPathSpec(page, language));
+											for (const auto& reader : readers) {
+												addToSourceHash(*reader, exhPath);
+												try {
+													const auto exhReaderExternal = Sqex::Excel::ExhReader(exhName, *(*reader)[exhPath]);
+													for (const auto language : exhReaderExternal.Languages)
+														for (const auto& page : exhReaderExternal.Pages)
+															addToSourceHash(*reader, exhReaderExternal.GetDataPathSpec(page, language));
+												} catch (const std::exception&) {
+													// pass; merging step will report it
+												}
+											}
+
+											{
+												uint8_t hash[20]{};
+												sourceHash.Final(reinterpret_cast<byte*>(hash));
+												CryptoPP::HexEncoder encoder;
+												encoder.Put(hash, sizeof hash);
+												encoder.MessageEnd();
+												sheetCacheKey.resize(static_cast<size_t>(encoder.MaxRetrievable()));
+												encoder.Get(reinterpret_cast<byte*>(&sheetCacheKey[0]), sheetCacheKey.size());
+											}
+
+											try {
+												const auto cachedIndex = Utils::ParseJsonFromFile(sheetCacheIndexPath);
+												if (cachedIndex.at("Key").get<std::string>() == sheetCacheKey) {
+													const auto cachedData = Utils::Win32::Handle::FromCreateFile(sheetCacheDataPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0);
+													std::vector<std::pair<std::string, std::vector<char>>> entries;
+													for (const auto& entry : cachedIndex.at("Entries"))
+														entries.emplace_back(entry.at("FullPath").get<std::string>(), cachedData.Read<char>(entry.at("ModOffset").get<uint64_t>(), entry.at("ModSize").get<size_t>()));
+													for (const auto& [fullPath, data] : entries)
+														appendEntry(fullPath, data);
+													progressStoreTarget = ProgressMaxPerTask;
+													return;
+												}
+											} catch (...) {
+												// pass; rebuild
+											}
+
+											lastStep = "Parse source EXH/D files";
 											exCreator = std::make_unique<Sqex::Excel::Depth2ExhExdCreator>(exhName, *exhReaderSource.Columns, exhReaderSource.Header.Flags.Value());
 											exCreator->FillMissingLanguageFrom = fallbackLanguageList;
 											exCreator->AddLanguage(Sqex::Language::Japanese);
@@ -1142,8 +1272,8 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 													try {
 														const auto exdReader = Sqex::Excel::ExdReader(exhReaderSource, creator[exdPathSpec]);
 														exCreator->AddLanguage(language);
-														for (const auto i : exdReader.GetIds())
-															exCreator->SetRow(i, language, exdReader.ReadDepth2(i));
+														for (const auto& [i, row] : exdReader.Depth2Rows())
+															exCreator->SetRow(i, language, row);
 													} catch (const std::out_of_range&) {
 														// pass
 													} catch (const std::exception& e) {
@@ -1157,6 +1287,7 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 										}
 
 										lastStep = "Load basic stuff";
+										auto& sheet = exCreator->Sheet;
 										const auto sourceLanguages{ exCreator->Languages };
 										const auto pluralColumnIndices = [&]() {
 											for (const auto& [pattern, data] : pluralColumns) {
@@ -1165,16 +1296,32 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 											}
 											return Misc::ExcelTransformConfig::PluralColumns();
 										}();
+										// Indices into rowReplacementRules applicable to each column, in the order they are tried.
 										const auto exhRowReplacementRules = [&]() {
-											std::map<Sqex::Language, std::vector<ReplacementRule>> res;
+											std::map<Sqex::Language, std::vector<std::vector<size_t>>> res;
 											for (const auto language : fallbackLanguageList)
-												res.emplace(language, std::vector<ReplacementRule>{});
+												res.emplace(language, std::vector<std::vector<size_t>>(sheet.Columns.size()));
 
-											for (auto& [language, rules] : rowReplacementRules) {
+											for (const auto& [language, rules] : rowReplacementRules) {
 												auto& exhRules = res.at(language);
-												for (auto& rule : rules)
-													if (srell::regex_search(exhName, rule.exhNamePattern))
-														exhRules.emplace_back(rule);
+												for (size_t i = 0; i < rules.size(); ++i) {
+													if (!srell::regex_search(exhName, rules[i].exhNamePattern))
+														continue;
+													for (const auto columnIndex : rules[i].columnIndices) {
+														if (columnIndex < exhRules.size())
+															exhRules[columnIndex].emplace_back(i);
+													}
+												}
+											}
+											return res;
+										}();
+										const auto exhIgnoredCells = [&]() {
+											std::map<Sqex::Language, std::map<std::pair<int, int>, const Misc::ExcelTransformConfig::IgnoredCell*>> res;
+											for (const auto& [language, cells] : ignoredCells) {
+												for (auto it = cells.lower_bound(Misc::ExcelTransformConfig::IgnoredCell{ exhName, INT_MIN, INT_MIN });
+													it != cells.end() && 0 == _stricmp(it->name.c_str(), exhName.c_str());
+													++it)
+													res[language].emplace(std::make_pair(it->id, it->column), &*it);
 											}
 											return res;
 										}();
@@ -1207,13 +1354,13 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 										} else if (exhName == "CompleteJournal") {
 											// Row ID does not persist across versions. Use first 4 columns as the alternate key.
 
-											const auto ToMapKey = [](const std::vector<Sqex::Excel::ExdColumn>& columns) {
+											const auto ToMapKey = [](uint64_t c0, uint64_t c1, uint64_t c2, uint64_t c3) {
 												// 20, 20, 16, 8
 												return 0
-													| (columns[0].uint64 << 44)
-													| (columns[1].uint64 << 24)
-													| (columns[2].uint64 << 8)
-													| (columns[3].uint64 << 0);
+													| (c0 << 44)
+													| (c1 << 24)
+													| (c2 << 8)
+													| (c3 << 0);
 											};
 
 											do {
@@ -1233,12 +1380,13 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 												}
 
 												std::map<uint64_t, uint32_t> questTitleIdMap;
-												for (const auto& [rowId, rowSet] : exCreator->Data) {
-													for (const auto& row : rowSet | std::views::values) {
-														if (row[5].String.Empty())
+												const auto sheetLanguages = sheet.Languages();
+												for (const auto rowIndex : sheet.SortedRowIndices()) {
+													for (const auto language : sheetLanguages) {
+														if (!sheet.HasRow(rowIndex, language) || sheet.EscapedString(rowIndex, language, 5).empty())
 															continue;
 
-														questTitleIdMap[ToMapKey(row)] = rowId;
+														questTitleIdMap[ToMapKey(sheet.Raw(rowIndex, language, 0), sheet.Raw(rowIndex, language, 1), sheet.Raw(rowIndex, language, 2), sheet.Raw(rowIndex, language, 3))] = sheet.RowId(rowIndex);
 														break; // intentional; first 4 columns should be same for all languages across regions.
 													}
 												}
@@ -1275,33 +1423,28 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 																	const auto exdReader = Sqex::Excel::ExdReader(exhReaderCurrent, (*reader)[exdPathSpec]);
 																	exCreator->AddLanguage(language);
 
-																	for (const auto i : exdReader.GetIds()) {
-																		auto addingRow = exdReader.ReadDepth2(i);
-																		if (addingRow[5].String.Empty())
+																	for (const auto& [i, addingRow] : exdReader.Depth2Rows()) {
+																		const auto addingString = addingRow.EscapedString(5);
+																		if (addingString.empty())
 																			continue;
 
-																		const auto targetRowIdIt = questTitleIdMap.find(ToMapKey(addingRow));
+																		const auto targetRowIdIt = questTitleIdMap.find(ToMapKey(addingRow.Raw(0), addingRow.Raw(1), addingRow.Raw(2), addingRow.Raw(3)));
 																		if (targetRowIdIt == questTitleIdMap.end())
 																			continue;
-																		const auto targetRowId = targetRowIdIt->second;
+																		const auto targetRowIndex = sheet.RowIndexOf(targetRowIdIt->second);
 
-																		auto& rowSet = exCreator->Data.at(targetRowId);
-																		std::vector<Sqex::Excel::ExdColumn> *pRow = nullptr;
-																		if (const auto it = rowSet.find(language); it != rowSet.end())
-																			pRow = &it->second;
-																		else {
+																		if (!sheet.HasRow(targetRowIndex, language)) {
 																			for (const auto& l : exCreator->FillMissingLanguageFrom) {
-																				if (auto it = rowSet.find(l); it != rowSet.end()) {
-																					pRow = &rowSet[language];
-																					*pRow = it->second;
+																				if (sheet.HasRow(targetRowIndex, l)) {
+																					sheet.CopyRow(targetRowIndex, l, language);
 																					break;
 																				}
 																			}
+																			if (!sheet.HasRow(targetRowIndex, language))
+																				continue;
 																		}
-																		if (!pRow)
-																			continue;
 
-																		(*pRow)[5].String = std::move(addingRow[5].String);
+																		sheet.SetEscapedString(targetRowIndex, language, 5, addingString);
 																	}
 																} catch (const std::exception& e) {
 																	Logger->Format<LogLevel::Warning>(LogCategory::VirtualSqPacks,
@@ -1333,31 +1476,23 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 																	"[{}] Adding {}", exhName, exdPathSpec);
 																const auto exdReader = Sqex::Excel::ExdReader(exhReaderCurrent, (*reader)[exdPathSpec]);
 																exCreator->AddLanguage(language);
-																for (const auto i : exdReader.GetIds()) {
-																	auto row = exdReader.ReadDepth2(i);
-																	const auto rowSetIt = exCreator->Data.find(i);
-																	if (rowSetIt == exCreator->Data.end())
+																for (const auto& [i, prevRow] : exdReader.Depth2Rows()) {
+																	// Rows already present in this language are never replaced.
+																	const auto rowIndex = sheet.RowIndexOf(i);
+																	if (rowIndex == Sqex::Excel::ColumnarSheet::NoRow || sheet.HasRow(rowIndex, language))
 																		continue;
 
-																	const auto& rowSet = rowSetIt->second;
 																	auto referenceRowLanguage = Sqex::Language::Unspecified;
-																	const std::vector<Sqex::Excel::ExdColumn>* referenceRowPtr = nullptr;
 																	for (const auto& l : exCreator->FillMissingLanguageFrom) {
-																		if (auto it = rowSet.find(l);
-																			it != rowSet.end()) {
+																		if (sheet.HasRow(rowIndex, l)) {
 																			referenceRowLanguage = l;
-																			referenceRowPtr = &it->second;
 																			break;
 																		}
 																	}
-																	if (!referenceRowPtr)
+																	if (referenceRowLanguage == Sqex::Language::Unspecified)
 																		continue;
-																	const auto& referenceRow = *referenceRowPtr;
-
-																	auto prevRow{ std::move(row) };
-																	row = referenceRow;
 
-																	Sqex::SeString pluralBaseString;
+																	std::string_view pluralBaseString;
 																	{
 																		constexpr auto N = Misc::ExcelTransformConfig::PluralColumns::Index_NoColumn;
 																		size_t cols[]{
@@ -1367,35 +1502,37 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 																			pluralColumnIndices.languageSpecificColumnIndex == N ? N : translateColumnIndex(referenceRowLanguage, language, pluralColumnIndices.languageSpecificColumnIndex),
 																		};
 																		for (auto& col : cols) {
-																			if (col == N || col >= prevRow.size() || prevRow[col].Type != Sqex::Excel::Exh::ColumnDataType::String)
+																			if (col == N || col >= prevRow.Size() || prevRow.Type(col) != Sqex::Excel::Exh::ColumnDataType::String)
 																				col = N;
-																			else if (!prevRow[col].String.Empty() && pluralBaseString.Empty())
-																				pluralBaseString = prevRow[col].String;
+																			else if (const auto str = prevRow.EscapedString(col); !str.empty() && pluralBaseString.empty())
+																				pluralBaseString = str;
 																		}
 																	}
 
-																	for (size_t j = 0; j < row.size(); ++j) {
-																		if (row[j].Type != Sqex::Excel::Exh::ColumnDataType::String)
+																	sheet.CopyRow(rowIndex, referenceRowLanguage, language);
+																	for (size_t j = 0; j < sheet.Columns.size(); ++j) {
+																		if (sheet.Columns[j].Type != Sqex::Excel::Exh::ColumnDataType::String)
 																			continue;
 
 																		const auto otherColIndex = translateColumnIndex(referenceRowLanguage, language, j);
-																		if (otherColIndex >= prevRow.size()) {
+																		if (otherColIndex >= prevRow.Size()) {
 																			if (otherColIndex != j)
 																				Logger->Format<LogLevel::Warning>(LogCategory::VirtualSqPacks,
 																					"[{}] Skipping column: Column {} of language {} is was requested but there are {} columns",
-																					exhName, j, otherColIndex, static_cast<int>(language), prevRow.size());
+																					exhName, j, otherColIndex, static_cast<int>(language), prevRow.Size());
 																			continue;
 																		}
 
-																		if (prevRow[otherColIndex].Type != Sqex::Excel::Exh::ColumnDataType::String) {
+																		if (prevRow.Type(otherColIndex) != Sqex::Excel::Exh::ColumnDataType::String) {
 																			Logger->Format<LogLevel::Warning>(LogCategory::VirtualSqPacks,
 																				"[{}] Skipping column: Column {} of language {} is string but column {} of language {} is not a string",
 																				exhName, j, static_cast<int>(referenceRowLanguage), otherColIndex, static_cast<int>(language));
 																			continue;
 																		}
 
-																		if (prevRow[otherColIndex].String.Empty()) {
-																			if (pluralBaseString.Empty())
+																		const auto prevString = prevRow.EscapedString(otherColIndex);
+																		if (prevString.empty()) {
+																			if (pluralBaseString.empty())
 																				continue;
 
 																			if (j != pluralColumnIndices.singularColumnIndex
@@ -1405,16 +1542,15 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 																				continue;
 																			}
 
-																			row[j].String = pluralBaseString;
+																			sheet.SetEscapedString(rowIndex, language, j, pluralBaseString);
 																			continue;
 																		}
 
-																		if (prevRow[otherColIndex].String.Escaped().starts_with("_rsv_"))
+																		if (prevString.starts_with("_rsv_"))
 																			continue;
 
-																		row[j].String = std::move(prevRow[otherColIndex].String);
+																		sheet.SetEscapedString(rowIndex, language, j, prevString);
 																	}
-																	exCreator->SetRow(i, language, std::move(row), false);
 																}
 															} catch (const std::exception& e) {
 																Logger->Format<LogLevel::Warning>(LogCategory::VirtualSqPacks,
@@ -1432,45 +1568,47 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 										}
 
 										lastStep = "Ensure that there are no missing rows from externally sourced exd files";
-										for (auto& [id, rowSet] : exCreator->Data) {
+										for (size_t rowIndex = 0; rowIndex < sheet.RowCount(); ++rowIndex) {
 											if (progressWindow.GetCancelEvent().Wait(0) == WAIT_OBJECT_0)
 												return;
 
+											const auto id = sheet.RowId(rowIndex);
+
 											lastStep = "Find which language to use while filling current row if missing in other languages";
-											const std::vector<Sqex::Excel::ExdColumn>* referenceRowPtr = nullptr;
 											auto referenceRowLanguage = Sqex::Language::Unspecified;
 											for (const auto& l : exCreator->FillMissingLanguageFrom) {
-												if (auto it = rowSet.find(l);
-													it != rowSet.end()) {
-													referenceRowPtr = &it->second;
+												if (sheet.HasRow(rowIndex, l)) {
 													referenceRowLanguage = l;
 													break;
 												}
 											}
-											if (!referenceRowPtr)
+											if (referenceRowLanguage == Sqex::Language::Unspecified)
 												continue;
-											const auto& referenceRow = *referenceRowPtr;
 
 											lastStep = "Fill missing rows for languages that aren't from source, and restore columns if unmodifiable";
 											std::set<size_t> referenceRowUsedColumnIndices;
 											for (const auto& language : exCreator->Languages) {
-												if (auto it = rowSet.find(language);
-													it == rowSet.end())
-													rowSet[language] = referenceRow;
+												if (!sheet.HasRow(rowIndex, language))
+													sheet.CopyRow(rowIndex, referenceRowLanguage, language);
 												else {
-													auto& row = it->second;
+													const auto isNonEmptyString = [&](size_t columnIndex) {
+														return columnIndex != Misc::ExcelTransformConfig::PluralColumns::Index_NoColumn
+															&& columnIndex < sheet.Columns.size()
+															&& sheet.Columns[columnIndex].Type == Sqex::Excel::Exh::String
+															&& !sheet.EscapedString(rowIndex, language, columnIndex).empty();
+													};
 
 													// Pass 1. Fill missing columns if we have plural information
 													{
 														auto copyFromColumnIndex = pluralColumnIndices.capitalizedColumnIndex;
-														if (copyFromColumnIndex == Misc::ExcelTransformConfig::PluralColumns::Index_NoColumn || copyFromColumnIndex >= row.size() || row[copyFromColumnIndex].Type != Sqex::Excel::Exh::String || row[copyFromColumnIndex].String.Empty())
+														if (!isNonEmptyString(copyFromColumnIndex))
 															copyFromColumnIndex = pluralColumnIndices.singularColumnIndex;
-														if (copyFromColumnIndex == Misc::ExcelTransformConfig::PluralColumns::Index_NoColumn || copyFromColumnIndex >= row.size() || row[copyFromColumnIndex].Type != Sqex::Excel::Exh::String || row[copyFromColumnIndex].String.Empty())
+														if (!isNonEmptyString(copyFromColumnIndex))
 															copyFromColumnIndex = pluralColumnIndices.pluralColumnIndex;
-														if (copyFromColumnIndex == Misc::ExcelTransformConfig::PluralColumns::Index_NoColumn || copyFromColumnIndex >= row.size() || row[copyFromColumnIndex].Type != Sqex::Excel::Exh::String || row[copyFromColumnIndex].String.Empty())
+														if (!isNonEmptyString(copyFromColumnIndex))
 															copyFromColumnIndex = pluralColumnIndices.languageSpecificColumnIndex;
 
-														if (copyFromColumnIndex != Misc::ExcelTransformConfig::PluralColumns::Index_NoColumn) {
+														if (isNonEmptyString(copyFromColumnIndex)) {
 															size_t targetColumnIndices[]{
 																pluralColumnIndices.capitalizedColumnIndex,
 																pluralColumnIndices.singularColumnIndex,
@@ -1479,22 +1617,23 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 															};
 															for (const auto targetColumnIndex : targetColumnIndices) {
 																if (targetColumnIndex != Misc::ExcelTransformConfig::PluralColumns::Index_NoColumn
-																	&& targetColumnIndex < row.size()
-																	&& row[targetColumnIndex].Type == Sqex::Excel::Exh::String
-																	&& row[targetColumnIndex].String.Empty()) {
-																	row[targetColumnIndex].String = row[copyFromColumnIndex].String;
+																	&& targetColumnIndex < sheet.Columns.size()
+																	&& sheet.Columns[targetColumnIndex].Type == Sqex::Excel::Exh::String
+																	&& sheet.EscapedString(rowIndex, language, targetColumnIndex).empty()) {
+																	// Looked up every time, as setting a string may move the string storage.
+																	sheet.SetEscapedString(rowIndex, language, targetColumnIndex, sheet.EscapedString(rowIndex, language, copyFromColumnIndex));
 																}
 															}
 														}
 													}
 
 													// Pass 2. Fill missing columns from columns of reference language
-													for (size_t i = 0; i < row.size(); ++i) {
-														if (referenceRow[i].Type != Sqex::Excel::Exh::String) {
-															row[i] = referenceRow[i];
+													for (size_t i = 0; i < sheet.Columns.size(); ++i) {
+														if (sheet.Columns[i].Type != Sqex::Excel::Exh::String) {
+															sheet.CopyCell(rowIndex, referenceRowLanguage, language, i);
 															referenceRowUsedColumnIndices.insert(i);
 														} else {
-															if (row[i].String.Empty()) {
+															if (sheet.EscapedString(rowIndex, language, i).empty()) {
 																// apply only if made of incompatible languages
 
 																int sourceLanguageType = 0, referenceLanguageType = 0;
@@ -1527,7 +1666,7 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 																}
 
 																if (sourceLanguageType != referenceLanguageType) {
-																	row[i] = referenceRow[i];
+																	sheet.CopyCell(rowIndex, referenceRowLanguage, language, i);
 																	referenceRowUsedColumnIndices.insert(i);
 																}
 															}
@@ -1537,61 +1676,63 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 											}
 
 											lastStep = "Adjust language data per use config";
-											std::map<Sqex::Language, std::vector<Sqex::Excel::ExdColumn>> pendingReplacements;
+											// Applied after all languages are processed, so that rules always read the values before adjustment.
+											std::vector<std::tuple<Sqex::Language, size_t, std::string>> pendingReplacements;
 											for (const auto& language : exCreator->Languages) {
-												const auto& rules = exhRowReplacementRules.at(language);
+												const auto& columnRules = exhRowReplacementRules.at(language);
+												const auto rulesIt = rowReplacementRules.find(language);
 
-												std::set<Misc::ExcelTransformConfig::IgnoredCell>* currentIgnoredCells = nullptr;
-												if (const auto it = ignoredCells.find(language); it != ignoredCells.end())
+												const std::map<std::pair<int, int>, const Misc::ExcelTransformConfig::IgnoredCell*>* currentIgnoredCells = nullptr;
+												if (const auto it = exhIgnoredCells.find(language); it != exhIgnoredCells.end())
 													currentIgnoredCells = &it->second;
 
-												if (rules.empty() && !currentIgnoredCells)
+												if (rulesIt == rowReplacementRules.end() && !currentIgnoredCells)
 													continue;
 
-												auto row{ rowSet.at(language) };
-
-												for (size_t columnIndex = 0; columnIndex < row.size(); columnIndex++) {
-													if (row[columnIndex].Type != Sqex::Excel::Exh::String)
+												for (size_t columnIndex = 0; columnIndex < sheet.Columns.size(); columnIndex++) {
+													if (sheet.Columns[columnIndex].Type != Sqex::Excel::Exh::String)
 														continue;
 
 													if (referenceRowUsedColumnIndices.find(columnIndex) != referenceRowUsedColumnIndices.end())
 														continue;
 
+													if (columnRules[columnIndex].empty() && !currentIgnoredCells)
+														continue;
+
+													const auto currentString = sheet.EscapedString(rowIndex, language, columnIndex);
+
 													if (currentIgnoredCells) {
-														if (const auto it = currentIgnoredCells->find(Misc::ExcelTransformConfig::IgnoredCell{ exhName, static_cast<int>(id), static_cast<int>(columnIndex) });
+														if (const auto it = currentIgnoredCells->find(std::make_pair(static_cast<int>(id), static_cast<int>(columnIndex)));
 															it != currentIgnoredCells->end()) {
-															if (it->forceString) {
-																row[columnIndex].String = Sqex::SeString(*it->forceString);
+															const auto& ignoredCell = *it->second;
+															if (ignoredCell.forceString) {
+																pendingReplacements.emplace_back(language, columnIndex, *ignoredCell.forceString);
 																continue;
-															} else if (it->forceLanguage) {
-																if (const auto it2 = rowSet.find(*it->forceLanguage);
-																	it2 != rowSet.end()) {
+															} else if (ignoredCell.forceLanguage) {
+																if (sheet.HasRow(rowIndex, *ignoredCell.forceLanguage)) {
+																	const auto forcedString = sheet.EscapedString(rowIndex, *ignoredCell.forceLanguage, columnIndex);
 																	Logger->Format(LogCategory::VirtualSqPacks, "Using \"{}\" in place of \"{}\" per rules, at {}({}, {})",
-																		it2->second[columnIndex].String.Parsed(),
-																		row[columnIndex].String.Parsed(),
+																		Sqex::SeString(std::string(forcedString)).Parsed(),
+																		Sqex::SeString(std::string(currentString)).Parsed(),
 																		exhName, id, columnIndex);
-																	row[columnIndex].String = it2->second[columnIndex].String;
+																	pendingReplacements.emplace_back(language, columnIndex, forcedString);
 																	continue;
 																}
 															}
 														}
 													}
 
-													for (const auto& rule : rules) {
-														if (!rule.columnIndices.contains(columnIndex))
-															continue;
+													if (columnRules[columnIndex].empty())
+														continue;
 
-														if (!srell::regex_search(row[columnIndex].String.Escaped(), rule.stringPattern))
+													for (const auto ruleIndex : columnRules[columnIndex]) {
+														const auto& rule = rulesIt->second[ruleIndex];
+														if (!srell::regex_search(currentString.begin(), currentString.end(), rule.stringPattern))
 															continue;
 
 														std::vector p = { std::format("{}:{}", exhName, id) };
 														for (const auto ruleSourceLanguage : rule.sourceLanguage) {
-															if (const auto it = rowSet.find(ruleSourceLanguage);
-																it != rowSet.end()) {
-
-																if (row[columnIndex].Type != Sqex::Excel::Exh::String)
-																	throw std::invalid_argument(std::format("Column {} of sourceLanguage {} in {} is not a string column", columnIndex, static_cast<int>(ruleSourceLanguage), exhName));
-
+															if (sheet.HasRow(rowIndex, ruleSourceLanguage)) {
 																auto readColumnIndex = columnIndex;
 																bool normalizeToCapital = false;
 																switch (ruleSourceLanguage) {
@@ -1626,7 +1767,7 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 																	}
 																}
 																if (const auto rules = rule.preprocessReplacements.find(ruleSourceLanguage); rules != rule.preprocessReplacements.end()) {
-																	Sqex::SeString escaped(it->second[readColumnIndex].String);
+																	Sqex::SeString escaped(std::string(sheet.EscapedString(rowIndex, ruleSourceLanguage, readColumnIndex)));
 																	escaped.NewlineAsCarriageReturn(true);
 																	std::string replacing(escaped.Parsed());
 																	for (const auto& ruleName : rules->second) {
@@ -1635,7 +1776,7 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 																	}
 																	p.emplace_back(escaped.SetParsedCompatible(replacing).Escaped());
 																} else
-																	p.emplace_back(it->second[readColumnIndex].String.Escaped());
+																	p.emplace_back(sheet.EscapedString(rowIndex, ruleSourceLanguage, readColumnIndex));
 															} else
 																p.emplace_back();
 														}
@@ -1671,14 +1812,13 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 															}
 															escaped.SetParsedCompatible(replacing);
 														}
-														row[columnIndex].String = std::move(escaped);
+														pendingReplacements.emplace_back(language, columnIndex, escaped.Escaped());
 														break;
 													}
 												}
-												pendingReplacements.emplace(language, std::move(row));
 											}
-											for (auto& [language, row] : pendingReplacements)
-												exCreator->SetRow(id, language, std::move(row));
+											for (const auto& [language, columnIndex, escaped] : pendingReplacements)
+												sheet.SetEscapedString(rowIndex, language, columnIndex, escaped);
 										}
 
 										{
@@ -1687,6 +1827,7 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 
 											lastStep = "Compress";
 											currentProgressMax = compiled.size();
+											std::vector<std::pair<std::string, std::vector<char>>> compressedEntries;
 											for (auto& kv : compiled) {
 												const auto& entryPathSpec = kv.first;
 												auto& data = kv.second;
@@ -1737,31 +1878,53 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 
 												const auto targetPath = cachedDir / entryPathSpec.FullPath;
 
+												const auto compressionLevel = Config->Runtime.GetModdedFileCompressionLevel(Sqex::Sqpack::SqData::FileEntryType::Binary, data.size());
 												std::unique_ptr<Sqex::Sqpack::EntryProvider> provider;
 												//if (Config->Runtime.CompressModdedFiles)
-													provider = std::make_unique<Sqex::Sqpack::MemoryBinaryEntryProvider>(entryPathSpec, std::make_shared<Sqex::MemoryRandomAccessStream>(std::move(*reinterpret_cast<std::vector<uint8_t>*>(&data))), Config->Runtime.CompressModdedFiles ? Z_BEST_COMPRESSION : Z_NO_COMPRESSION);
+													provider = std::make_unique<Sqex::Sqpack::MemoryBinaryEntryProvider>(entryPathSpec, std::make_shared<Sqex::MemoryRandomAccessStream>(std::move(*reinterpret_cast<std::vector<uint8_t>*>(&data))), compressionLevel);
 												//else
 												//	provider = std::make_unique<Sqex::Sqpack::EmptyOrObfuscatedEntryProvider>(entryPathSpec, std::make_shared<Sqex::MemoryRandomAccessStream>(std::move(*reinterpret_cast<std::vector<uint8_t>*>(&data))));
 												const auto len = provider->StreamSize();
-												const auto dv = provider->ReadStreamIntoVector<char>(0, static_cast<SSIZE_T>(len));
+												auto dv = provider->ReadStreamIntoVector<char>(0, static_cast<SSIZE_T>(len));
 
 												if (progressWindow.GetCancelEvent().Wait(0) == WAIT_OBJECT_0)
 													return;
 
 												lastStep = "Write to filesystem";
-												const auto lock = std::lock_guard(writeMtx);
-												const auto entryLine = std::format("{}\n", nlohmann::json::object({
-													{"FullPath", Utils::StringReplaceAll<std::string>(Utils::ToUtf8(entryPathSpec.FullPath.wstring()), "\\", "/")},
-													{"ModOffset", ttmpdPtr},
-													{"ModSize", len},
-													{"DatFile", "0a0000"},
-													}).dump());
-												ttmplPtr += ttmpl.Write(ttmplPtr, std::span(entryLine));
-												ttmpdPtr += ttmpd.Write(ttmpdPtr, std::span(dv));
+												auto fullPath = Utils::StringReplaceAll<std::string>(Utils::ToUtf8(entryPathSpec.FullPath.wstring()), "\\", "/");
+												appendEntry(fullPath, dv);
+												compressedEntries.emplace_back(std::move(fullPath), std::move(dv));
 											}
 											currentProgress = 0;
 											progressIndex++;
 											publishProgress();
+
+											lastStep = "Write sheet cache";
+											try {
+												create_directories(sheetCacheIndexPath.parent_path());
+												std::filesystem::remove(sheetCacheIndexPath);
+
+												auto entries = nlohmann::json::array();
+												const auto cachedData = Utils::Win32::Handle::FromCreateFile(sheetCacheDataPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, 0);
+												uint64_t cachedDataPtr = 0;
+												for (const auto& [fullPath, data] : compressedEntries) {
+													entries.push_back(nlohmann::json::object({
+														{"FullPath", fullPath},
+														{"ModOffset", cachedDataPtr},
+														{"ModSize", data.size()},
+														}));
+													cachedDataPtr += cachedData.Write(cachedDataPtr, std::span(data));
+												}
+
+												const auto index = nlohmann::json::object({
+													{"Key", sheetCacheKey},
+													{"Entries", std::move(entries)},
+													}).dump();
+												Utils::Win32::Handle::FromCreateFile(sheetCacheIndexPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, 0)
+													.Write(0, index.data(), index.size());
+											} catch (const std::exception& e) {
+												Logger->Format<LogLevel::Warning>(LogCategory::VirtualSqPacks, "[{}] Failed to write sheet cache: {}", exhName, e.what());
+											}
 										}
 									} catch (const std::exception& e) {
 										if (errorMessage.empty()) {
@@ -1950,9 +2113,9 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 					const auto gameRoot = indexPath.parent_path().parent_path().parent_path();
 					const auto versionFile = Utils::Win32::Handle::FromCreateFile(gameRoot / "ffxivgame.ver", GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0);
 					const auto versionContent = versionFile.Read<char>(0, static_cast<size_t>(versionFile.GetFileSize()));
-					currentCacheKeys += std::format("SQPACK:{}:{}:{}\n",
+					currentCacheKeys += std::format("SQPACK:{}:compress{}:{}\n",
 						canonical(gameRoot).wstring(),
-						Config->Runtime.CompressModdedFiles ? "compress" : "nocompress",
+						static_cast<int>(Config->Runtime.GetModdedFileCompressionPolicy()),
 						std::string(versionContent.begin(), versionContent.end()));
 				}
 
@@ -2053,11 +2216,11 @@ struct XivAlexander::Apps::MainApp::Internal::VirtualSqPacks::Implementation {
 									CharLowerW(&extension[0]);
 
 									if (extension == L".tex") {
-										provider = std::make_unique<Sqex::Sqpack::MemoryTextureEntryProvider>(entryPathSpec, stream, Config->Runtime.CompressModdedFiles ? Z_BEST_COMPRESSION : Z_NO_COMPRESSION);
+										provider = std::make_unique<Sqex::Sqpack::MemoryTextureEntryProvider>(entryPathSpec, stream, Config->Runtime.GetModdedFileCompressionLevel(Sqex::Sqpack::SqData::FileEntryType::Texture, stream->StreamSize()));
 										// provider = std::make_unique<Sqex::Sqpack::EmptyOrObfuscatedEntryProvider>(entryPathSpec, static_cast<uint32_t>(stream->StreamSize()), stream);
 									} else {
 										//if (Config->Runtime.CompressModdedFiles)
-											provider = std::make_unique<Sqex::Sqpack::MemoryBinaryEntryProvider>(entryPathSpec, stream, Config->Runtime.CompressModdedFiles ? Z_BEST_COMPRESSION : Z_NO_COMPRESSION);
+											provider = std::make_unique<Sqex::Sqpack::MemoryBinaryEntryProvider>(entryPathSpec, stream, Config->Runtime.GetModdedFileCompressionLevel(Sqex::Sqpack::SqData::FileEntryType::Binary, stream->StreamSize()));
 										//else
 										//	provider = std::make_unique<Sqex::Sqpack::EmptyOrObfuscatedEntryProvider>(entryPathSpec, stream);
 									}
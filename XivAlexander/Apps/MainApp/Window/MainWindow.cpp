@@ -1344,6 +1344,15 @@ void XivAlexander::Apps::MainApp::Window::MainWindow::OnCommand_Menu_Network(int
 				});
 			return;
 
+		case ID_NETWORK_EXPORTLATENCYHISTOGRAMS: {
+			const auto dir = m_config->Init.ResolveConfigStorageDirectoryPath() / "LatencyHistograms";
+			m_app.RunOnGameLoop([this, &dir]() {
+				m_app.GetSocketHook().ExportLatencyHistograms(dir);
+				});
+			EnsureAndOpenDirectory(dir);
+			return;
+		}
+
 		case ID_NETWORK_TROUBLESHOOTREMOTEADDRESSES_TAKEOVERLOOPBACKADDRESSES:
 			config.TakeOverLoopbackAddresses.Toggle();
 			return;
@@ -2013,11 +2022,11 @@ void XivAlexander::Apps::MainApp::Window::MainWindow::OnCommand_Menu_Modding(int
 							if (file_size(target) == 0)
 								dv = Sqex::Sqpack::EmptyOrObfuscatedEntryProvider(entryPathSpec).ReadStreamIntoVector<char>(0);
 							else if (extensionLower == L".tex" || extensionLower == L".atex")
-								dv = Sqex::Sqpack::MemoryTextureEntryProvider(entryPathSpec, std::make_shared<Sqex::FileRandomAccessStream>(target), m_config->Runtime.CompressModdedFiles ? Z_BEST_COMPRESSION : Z_NO_COMPRESSION).ReadStreamIntoVector<char>(0);
+								dv = Sqex::Sqpack::MemoryTextureEntryProvider(entryPathSpec, std::make_shared<Sqex::FileRandomAccessStream>(target), m_config->Runtime.GetModdedFileCompressionLevel(Sqex::Sqpack::SqData::FileEntryType::Texture, file_size(target))).ReadStreamIntoVector<char>(0);
 							else if (extensionLower == L".mdl")
-								dv = Sqex::Sqpack::MemoryModelEntryProvider(entryPathSpec, std::make_shared<Sqex::FileRandomAccessStream>(target), m_config->Runtime.CompressModdedFiles ? Z_BEST_COMPRESSION : Z_NO_COMPRESSION).ReadStreamIntoVector<char>(0);
+								dv = Sqex::Sqpack::MemoryModelEntryProvider(entryPathSpec, std::make_shared<Sqex::FileRandomAccessStream>(target), m_config->Runtime.GetModdedFileCompressionLevel(Sqex::Sqpack::SqData::FileEntryType::Model, file_size(target))).ReadStreamIntoVector<char>(0);
 							else
-								dv = Sqex::Sqpack::MemoryBinaryEntryProvider(entryPathSpec, std::make_shared<Sqex::FileRandomAccessStream>(target), m_config->Runtime.CompressModdedFiles ? Z_BEST_COMPRESSION : Z_NO_COMPRESSION).ReadStreamIntoVector<char>(0);
+								dv = Sqex::Sqpack::MemoryBinaryEntryProvider(entryPathSpec, std::make_shared<Sqex::FileRandomAccessStream>(target), m_config->Runtime.GetModdedFileCompressionLevel(Sqex::Sqpack::SqData::FileEntryType::Binary, file_size(target))).ReadStreamIntoVector<char>(0);
 
 							if (m_backgroundWorkerProgressWindow->GetCancelEvent().Wait(0) == WAIT_OBJECT_0)
 								return;
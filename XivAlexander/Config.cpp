@@ -244,6 +244,14 @@ std::vector<Sqex::Language> XivAlexander::Config::RuntimeRepository::GetFallback
 	return result;
 }
 
+Sqex::Sqpack::CompressionPolicy XivAlexander::Config::RuntimeRepository::GetModdedFileCompressionPolicy() const {
+	return CompressModdedFiles ? ModdedFileCompressionPolicy.Value() : Sqex::Sqpack::CompressionPolicy::None;
+}
+
+int XivAlexander::Config::RuntimeRepository::GetModdedFileCompressionLevel(Sqex::Sqpack::SqData::FileEntryType type, uint64_t rawSize) const {
+	return Sqex::Sqpack::GetCompressionLevel(GetModdedFileCompressionPolicy(), type, rawSize);
+}
+
 uint64_t XivAlexander::Config::RuntimeRepository::CalculateLockFramerateIntervalUs(double fromFps, double toFps, uint64_t gcdUs, uint64_t renderIntervalDeviation) {
 	static double prevFromFps{}, prevToFps{};
 	static uint64_t prevGcdUs{}, prevRenderIntervalDeviation{};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <XivAlexanderCommon/Sqex.h>
+#include <XivAlexanderCommon/Sqex/Sqpack/CompressionPolicy.h>
 #include <XivAlexanderCommon/Utils/ListenerManager.h>
 
 namespace XivAlexander {
@@ -248,6 +249,9 @@ namespace XivAlexander {
 			
 			Item<bool> UseHashTrackerKeyLogging = CreateConfigItem(this, "UseHashTrackerKeyLogging", false);
 			Item<bool> LogAllDataFileRead = CreateConfigItem(this, "LogAllDataFileRead", false);
+			Item<bool> RecordNetworkCapture = CreateConfigItem(this, "RecordNetworkCapture", false);
+			// Write latency histograms of all connections every this many seconds; 0 to disable.
+			Item<int> LatencyHistogramSnapshotIntervalSeconds = CreateConfigItem(this, "LatencyHistogramSnapshotIntervalSeconds", 0);
 			Item<Sqex::Language> ResourceLanguageOverride = CreateConfigItem(this, "ResourceLanguageOverride", Sqex::Language::Unspecified);
 			Item<Sqex::Language> VoiceResourceLanguageOverride = CreateConfigItem(this, "VoiceResourceLanguageOverride", Sqex::Language::Unspecified);
 
@@ -283,6 +287,11 @@ namespace XivAlexander {
 
 			Item<bool> UseModding = CreateConfigItem(this, "UseModding", false);
 			Item<bool> CompressModdedFiles = CreateConfigItem(this, "CompressModdedFiles", false);
+			Item<Sqex::Sqpack::CompressionPolicy> ModdedFileCompressionPolicy = CreateConfigItem(this, "ModdedFileCompressionPolicy", Sqex::Sqpack::CompressionPolicy::Balanced);
+			// Memory kept for generated modded file data, in megabytes; 0 to use the default.
+			// Past the first, data is kept LZ4 compressed; past the second, it goes to a temporary file.
+			Item<uint64_t> ModdedFileRawDataBudgetMb = CreateConfigItem<uint64_t>(this, "ModdedFileRawDataBudgetMb", 0);
+			Item<uint64_t> ModdedFileMemoryBudgetMb = CreateConfigItem<uint64_t>(this, "ModdedFileMemoryBudgetMb", 0);
 			Item<bool> TtmpFlattenSubdirectoryDisplay = CreateConfigItem(this, "TtmpFlattenSubdirectoryDisplay", false);
 			Item<bool> TtmpUseSubdirectoryTogglingOnFlattenedView = CreateConfigItem(this, "", false);
 			Item<bool> TtmpShowDedicatedMenu = CreateConfigItem(this, "TtmpShowDedicatedMenu", false);
@@ -325,6 +334,9 @@ namespace XivAlexander {
 			
 			[[nodiscard]] std::vector<Sqex::Language> GetFallbackLanguageList() const;
 
+			[[nodiscard]] Sqex::Sqpack::CompressionPolicy GetModdedFileCompressionPolicy() const;
+			[[nodiscard]] int GetModdedFileCompressionLevel(Sqex::Sqpack::SqData::FileEntryType type, uint64_t rawSize) const;
+
 			[[nodiscard]] static uint64_t CalculateLockFramerateIntervalUs(double fromFps, double toFps, uint64_t gcdUs, uint64_t maximumRenderIntervalDeviation);
 
 		private:
@@ -3,3 +3,55 @@
 
 const char Sqex::Excel::Exh::Header::Signature_Value[4] = {'E', 'X', 'H', 'F'};
 const char Sqex::Excel::Exd::Header::Signature_Value[4] = {'E', 'X', 'D', 'F'};
+
+Sqex::Excel::ExdCell Sqex::Excel::ExdStringArena::Add(std::string_view escaped) {
+	if (escaped.size() > UINT32_MAX)
+		throw std::length_error("String too long");
+
+	ExdCell cell{ .Type = Exh::String, .StringLength = static_cast<uint32_t>(escaped.size()) };
+	cell.StringOffset = m_data.size();
+	m_data.append(escaped);
+	return cell;
+}
+
+std::string_view Sqex::Excel::ExdStringArena::Escaped(const ExdCell& cell) const {
+	if (cell.Type != Exh::String)
+		throw std::invalid_argument("Not a string cell");
+	if (cell.StringOffset > m_data.size() || m_data.size() - cell.StringOffset < cell.StringLength)
+		throw std::out_of_range("String cell does not belong to this arena");
+	return std::string_view(m_data).substr(static_cast<size_t>(cell.StringOffset), cell.StringLength);
+}
+
+Sqex::Excel::ExdColumn Sqex::Excel::ToExdColumn(const ExdCell& cell, const ExdStringArena& strings) {
+	ExdColumn column{ .Type = cell.Type, .ValidSize = cell.ValidSize };
+	if (cell.Type == Exh::String)
+		column.String.SetEscaped(std::string(strings.Escaped(cell)));
+	else
+		std::copy_n(cell.Buffer, sizeof cell.Buffer, column.Buffer);
+	return column;
+}
+
+Sqex::Excel::ExdCell Sqex::Excel::ToExdCell(const ExdColumn& column, ExdStringArena& strings) {
+	if (column.Type == Exh::String)
+		return strings.Add(column.String.Escaped());
+
+	ExdCell cell{ .Type = column.Type, .ValidSize = column.ValidSize };
+	std::copy_n(column.Buffer, sizeof column.Buffer, cell.Buffer);
+	return cell;
+}
+
+std::vector<Sqex::Excel::ExdColumn> Sqex::Excel::ToExdColumns(std::span<const ExdCell> cells, const ExdStringArena& strings) {
+	std::vector<ExdColumn> columns;
+	columns.reserve(cells.size());
+	for (const auto& cell : cells)
+		columns.emplace_back(ToExdColumn(cell, strings));
+	return columns;
+}
+
+std::vector<Sqex::Excel::ExdCell> Sqex::Excel::ToExdCells(std::span<const ExdColumn> columns, ExdStringArena& strings) {
+	std::vector<ExdCell> cells;
+	cells.reserve(columns.size());
+	for (const auto& column : columns)
+		cells.emplace_back(ToExdCell(column, strings));
+	return cells;
+}
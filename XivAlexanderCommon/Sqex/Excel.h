@@ -140,4 +140,47 @@ namespace Sqex::Excel {
 
 		Sqex::SeString String;
 	};
+
+	// Same as ExdColumn in 16 bytes; string cells refer to a range of an ExdStringArena instead of holding the string.
+	struct ExdCell {
+		Exh::ColumnDataType Type{};
+		uint8_t ValidSize{};
+		uint32_t StringLength{};
+
+		union {
+			uint8_t Buffer[8]{};
+			bool boolean;
+			int8_t int8;
+			uint8_t uint8;
+			int16_t int16;
+			uint16_t uint16;
+			int32_t int32;
+			uint32_t uint32;
+			float float32;
+			int64_t int64;
+			uint64_t uint64;
+			uint64_t StringOffset;
+		};
+	};
+	static_assert(sizeof(ExdCell) == 16);
+
+	// Escaped strings of ExdCell values, stored back to back; meant to be shared by every cell read or written together.
+	class ExdStringArena {
+		std::string m_data;
+
+	public:
+		// Appends the string, and returns a string cell referring to it.
+		[[nodiscard]] ExdCell Add(std::string_view escaped);
+		[[nodiscard]] std::string_view Escaped(const ExdCell& cell) const;
+
+		[[nodiscard]] size_t Size() const { return m_data.size(); }
+		void Reserve(size_t size) { m_data.reserve(size); }
+		void Clear() { m_data.clear(); }
+	};
+
+	// Conversion between the two representations, for code written against ExdColumn.
+	[[nodiscard]] ExdColumn ToExdColumn(const ExdCell& cell, const ExdStringArena& strings);
+	[[nodiscard]] ExdCell ToExdCell(const ExdColumn& column, ExdStringArena& strings);
+	[[nodiscard]] std::vector<ExdColumn> ToExdColumns(std::span<const ExdCell> cells, const ExdStringArena& strings);
+	[[nodiscard]] std::vector<ExdCell> ToExdCells(std::span<const ExdColumn> columns, ExdStringArena& strings);
 }
@@ -0,0 +1,343 @@
+#include "pch.h"
+#include "XivAlexanderCommon/Sqex/Excel/ColumnarSheet.h"
+
+Sqex::Excel::ColumnarSheet::ColumnarSheet(std::vector<Exh::Column> columns)
+	: Columns(std::move(columns))
+	, m_widths([&columns = Columns]() {
+		std::vector<size_t> widths;
+		widths.reserve(columns.size());
+		for (const auto& column : columns)
+			widths.emplace_back(CellWidth(column.Type));
+		return widths;
+	}()) {
+}
+
+size_t Sqex::Excel::ColumnarSheet::CellWidth(Exh::ColumnDataType type) {
+	switch (type) {
+		case Exh::String:
+			return sizeof(StringRef);
+
+		case Exh::Bool:
+		case Exh::Int8:
+		case Exh::UInt8:
+		case Exh::PackedBool0:
+		case Exh::PackedBool1:
+		case Exh::PackedBool2:
+		case Exh::PackedBool3:
+		case Exh::PackedBool4:
+		case Exh::PackedBool5:
+		case Exh::PackedBool6:
+		case Exh::PackedBool7:
+			return 1;
+
+		case Exh::Int16:
+		case Exh::UInt16:
+			return 2;
+
+		case Exh::Int32:
+		case Exh::UInt32:
+		case Exh::Float32:
+			return 4;
+
+		case Exh::Int64:
+		case Exh::UInt64:
+			return 8;
+
+		default:
+			throw std::invalid_argument(std::format("Invald column type {}", static_cast<uint32_t>(type)));
+	}
+}
+
+const Sqex::Excel::ColumnarSheet::LanguageData* Sqex::Excel::ColumnarSheet::GetLanguage(Language language) const {
+	const auto it = m_languages.find(language);
+	return it == m_languages.end() ? nullptr : &it->second;
+}
+
+Sqex::Excel::ColumnarSheet::LanguageData& Sqex::Excel::ColumnarSheet::GetOrCreateLanguage(Language language) {
+	auto [it, inserted] = m_languages.try_emplace(language);
+	if (inserted) {
+		auto& data = it->second;
+		data.Present.resize(m_rowIds.size());
+		data.Cells.resize(Columns.size());
+		for (size_t i = 0; i < Columns.size(); ++i)
+			data.Cells[i].resize(m_rowIds.size() * m_widths[i]);
+	}
+	return it->second;
+}
+
+Sqex::Excel::ColumnarSheet::StringRef Sqex::Excel::ColumnarSheet::InternString(std::string_view escaped) {
+	if (escaped.empty())
+		return {};
+
+	const auto hash = std::hash<std::string_view>()(escaped);
+	for (auto [it, end] = m_stringIndex.equal_range(hash); it != end; ++it) {
+		if (StringAt(it->second) == escaped)
+			return it->second;
+	}
+
+	if (m_strings.size() + escaped.size() > UINT32_MAX)
+		throw std::length_error("String arena is full");
+
+	StringRef ref{ static_cast<uint32_t>(m_strings.size()), static_cast<uint32_t>(escaped.size()) };
+	if (escaped.data() >= m_strings.data() && escaped.data() < m_strings.data() + m_strings.size()) {
+		// Source lives in the arena itself; appending may move it.
+		const auto offset = static_cast<size_t>(escaped.data() - m_strings.data());
+		m_strings.reserve(m_strings.size() + escaped.size());
+		m_strings.append(m_strings, offset, escaped.size());
+	} else
+		m_strings.append(escaped);
+	m_stringIndex.emplace(hash, ref);
+	return ref;
+}
+
+void Sqex::Excel::ColumnarSheet::CompactStrings() {
+	std::string strings;
+	std::unordered_multimap<size_t, StringRef> stringIndex;
+	std::unordered_map<uint32_t, uint32_t> newOffsets;
+	for (auto& data : m_languages | std::views::values) {
+		for (size_t i = 0; i < Columns.size(); ++i) {
+			if (Columns[i].Type != Exh::String)
+				continue;
+
+			const auto refs = reinterpret_cast<StringRef*>(data.Cells[i].data());
+			for (size_t rowIndex = 0; rowIndex < m_rowIds.size(); ++rowIndex) {
+				auto& ref = refs[rowIndex];
+				if (!data.Present[rowIndex] || !ref.Length) {
+					ref = {};
+					continue;
+				}
+
+				const auto [it, inserted] = newOffsets.try_emplace(ref.Offset, static_cast<uint32_t>(strings.size()));
+				if (inserted) {
+					const auto escaped = StringAt(ref);
+					strings.append(escaped);
+					stringIndex.emplace(std::hash<std::string_view>()(escaped), StringRef{ it->second, ref.Length });
+				}
+				ref.Offset = it->second;
+			}
+		}
+	}
+	m_strings = std::move(strings);
+	m_stringIndex = std::move(stringIndex);
+}
+
+size_t Sqex::Excel::ColumnarSheet::RowIndexOf(uint32_t id) const {
+	const auto it = m_rowIndices.find(id);
+	return it == m_rowIndices.end() ? NoRow : it->second;
+}
+
+size_t Sqex::Excel::ColumnarSheet::AddRow(uint32_t id) {
+	const auto [it, inserted] = m_rowIndices.try_emplace(id, m_rowIds.size());
+	if (!inserted)
+		return it->second;
+
+	if (!m_rowIds.empty() && m_rowIds.back() > id)
+		m_rowIdsSorted = false;
+	m_rowIds.emplace_back(id);
+	for (auto& data : m_languages | std::views::values) {
+		data.Present.emplace_back(0);
+		for (size_t i = 0; i < Columns.size(); ++i)
+			data.Cells[i].resize(m_rowIds.size() * m_widths[i]);
+	}
+	return it->second;
+}
+
+std::vector<size_t> Sqex::Excel::ColumnarSheet::SortedRowIndices() const {
+	std::vector<size_t> result(m_rowIds.size());
+	std::iota(result.begin(), result.end(), size_t{});
+	if (!m_rowIdsSorted)
+		std::ranges::sort(result, {}, [this](size_t i) { return m_rowIds[i]; });
+	return result;
+}
+
+std::vector<Sqex::Language> Sqex::Excel::ColumnarSheet::Languages() const {
+	std::vector<Language> result;
+	for (const auto language : m_languages | std::views::keys)
+		result.emplace_back(language);
+	return result;
+}
+
+bool Sqex::Excel::ColumnarSheet::HasRow(size_t rowIndex, Language language) const {
+	const auto data = GetLanguage(language);
+	return data && data->Present[rowIndex];
+}
+
+void Sqex::Excel::ColumnarSheet::RemoveRow(size_t rowIndex, Language language) {
+	if (const auto it = m_languages.find(language); it != m_languages.end())
+		it->second.Present[rowIndex] = 0;
+}
+
+void Sqex::Excel::ColumnarSheet::CopyRow(size_t rowIndex, Language fromLanguage, Language toLanguage) {
+	if (fromLanguage == toLanguage)
+		return;
+	if (!HasRow(rowIndex, fromLanguage))
+		throw std::out_of_range("Source row does not exist");
+
+	// String arena is shared between languages, so string cells are copied as they are.
+	auto& to = GetOrCreateLanguage(toLanguage);
+	const auto& from = m_languages.at(fromLanguage);
+	for (size_t i = 0; i < Columns.size(); ++i) {
+		const auto width = m_widths[i];
+		std::copy_n(&from.Cells[i][rowIndex * width], width, &to.Cells[i][rowIndex * width]);
+	}
+	to.Present[rowIndex] = 1;
+}
+
+uint64_t Sqex::Excel::ColumnarSheet::Raw(size_t rowIndex, Language language, size_t column) const {
+	if (Columns[column].Type == Exh::String)
+		throw std::invalid_argument(std::format("Column {} is a string column", column));
+	if (!HasRow(rowIndex, language))
+		throw std::out_of_range("Row does not exist");
+
+	uint64_t value = 0;
+	const auto width = m_widths[column];
+	std::copy_n(&m_languages.at(language).Cells[column][rowIndex * width], width, reinterpret_cast<char*>(&value));
+	return value;
+}
+
+void Sqex::Excel::ColumnarSheet::SetRaw(size_t rowIndex, Language language, size_t column, uint64_t value) {
+	if (Columns[column].Type == Exh::String)
+		throw std::invalid_argument(std::format("Column {} is a string column", column));
+	if (!HasRow(rowIndex, language))
+		throw std::out_of_range("Row does not exist");
+
+	const auto width = m_widths[column];
+	std::copy_n(reinterpret_cast<const char*>(&value), width, &m_languages.at(language).Cells[column][rowIndex * width]);
+}
+
+std::string_view Sqex::Excel::ColumnarSheet::EscapedString(size_t rowIndex, Language language, size_t column) const {
+	if (Columns[column].Type != Exh::String)
+		throw std::invalid_argument(std::format("Column {} is not a string column", column));
+	if (!HasRow(rowIndex, language))
+		throw std::out_of_range("Row does not exist");
+
+	return StringAt(*reinterpret_cast<const StringRef*>(&m_languages.at(language).Cells[column][rowIndex * sizeof(StringRef)]));
+}
+
+void Sqex::Excel::ColumnarSheet::SetEscapedString(size_t rowIndex, Language language, size_t column, std::string_view escaped) {
+	if (Columns[column].Type != Exh::String)
+		throw std::invalid_argument(std::format("Column {} is not a string column", column));
+	if (!HasRow(rowIndex, language))
+		throw std::out_of_range("Row does not exist");
+
+	const auto ref = InternString(escaped);
+	std::copy_n(reinterpret_cast<const char*>(&ref), sizeof ref, &m_languages.at(language).Cells[column][rowIndex * sizeof ref]);
+}
+
+void Sqex::Excel::ColumnarSheet::CopyCell(size_t rowIndex, Language fromLanguage, Language toLanguage, size_t column) {
+	if (fromLanguage == toLanguage)
+		return;
+	if (!HasRow(rowIndex, fromLanguage) || !HasRow(rowIndex, toLanguage))
+		throw std::out_of_range("Row does not exist");
+
+	const auto width = m_widths[column];
+	std::copy_n(&m_languages.at(fromLanguage).Cells[column][rowIndex * width], width, &m_languages.at(toLanguage).Cells[column][rowIndex * width]);
+}
+
+Sqex::Excel::ExdCell Sqex::Excel::ColumnarSheet::Column(size_t rowIndex, Language language, size_t column, ExdStringArena& strings) const {
+	if (Columns[column].Type == Exh::String)
+		return strings.Add(EscapedString(rowIndex, language, column));
+
+	ExdCell result{ .Type = Columns[column].Type };
+	switch (result.Type) {
+		case Exh::PackedBool0:
+		case Exh::PackedBool1:
+		case Exh::PackedBool2:
+		case Exh::PackedBool3:
+		case Exh::PackedBool4:
+		case Exh::PackedBool5:
+		case Exh::PackedBool6:
+		case Exh::PackedBool7:
+			result.boolean = Raw(rowIndex, language, column) != 0;
+			break;
+
+		default:
+			result.ValidSize = static_cast<uint8_t>(m_widths[column]);
+			result.uint64 = Raw(rowIndex, language, column);
+	}
+	return result;
+}
+
+void Sqex::Excel::ColumnarSheet::SetColumn(size_t rowIndex, Language language, size_t column, const ExdCell& value, const ExdStringArena& strings) {
+	switch (Columns[column].Type) {
+		case Exh::String:
+			SetEscapedString(rowIndex, language, column, strings.Escaped(value));
+			break;
+
+		case Exh::PackedBool0:
+		case Exh::PackedBool1:
+		case Exh::PackedBool2:
+		case Exh::PackedBool3:
+		case Exh::PackedBool4:
+		case Exh::PackedBool5:
+		case Exh::PackedBool6:
+		case Exh::PackedBool7:
+			SetRaw(rowIndex, language, column, value.boolean ? 1 : 0);
+			break;
+
+		default:
+			SetRaw(rowIndex, language, column, value.uint64);
+	}
+}
+
+std::vector<Sqex::Excel::ExdCell> Sqex::Excel::ColumnarSheet::Row(size_t rowIndex, Language language, ExdStringArena& strings) const {
+	if (!HasRow(rowIndex, language))
+		throw std::out_of_range("Row does not exist");
+
+	std::vector<ExdCell> result;
+	result.reserve(Columns.size());
+	for (size_t i = 0; i < Columns.size(); ++i)
+		result.emplace_back(Column(rowIndex, language, i, strings));
+	return result;
+}
+
+void Sqex::Excel::ColumnarSheet::SetRow(size_t rowIndex, Language language, std::span<const ExdCell> row, const ExdStringArena& strings) {
+	if (row.empty()) {
+		RemoveRow(rowIndex, language);
+		return;
+	}
+	if (row.size() != Columns.size())
+		throw std::invalid_argument(std::format("bad column data (expected {} columns, got {} columns)", Columns.size(), row.size()));
+
+	GetOrCreateLanguage(language).Present[rowIndex] = 1;
+	for (size_t i = 0; i < Columns.size(); ++i)
+		SetColumn(rowIndex, language, i, row[i], strings);
+}
+
+Sqex::Excel::ExdColumn Sqex::Excel::ColumnarSheet::Column(size_t rowIndex, Language language, size_t column) const {
+	ExdStringArena strings;
+	return ToExdColumn(Column(rowIndex, language, column, strings), strings);
+}
+
+void Sqex::Excel::ColumnarSheet::SetColumn(size_t rowIndex, Language language, size_t column, const ExdColumn& value) {
+	ExdStringArena strings;
+	SetColumn(rowIndex, language, column, ToExdCell(value, strings), strings);
+}
+
+std::vector<Sqex::Excel::ExdColumn> Sqex::Excel::ColumnarSheet::Row(size_t rowIndex, Language language) const {
+	ExdStringArena strings;
+	return ToExdColumns(Row(rowIndex, language, strings), strings);
+}
+
+void Sqex::Excel::ColumnarSheet::SetRow(size_t rowIndex, Language language, std::span<const ExdColumn> row) {
+	ExdStringArena strings;
+	SetRow(rowIndex, language, ToExdCells(row, strings), strings);
+}
+
+void Sqex::Excel::ColumnarSheet::SetRow(size_t rowIndex, Language language, const ExdReader::RowView& row) {
+	if (row.Size() != Columns.size())
+		throw std::invalid_argument(std::format("bad column data (expected {} columns, got {} columns)", Columns.size(), row.Size()));
+
+	auto& data = GetOrCreateLanguage(language);
+	for (size_t i = 0; i < Columns.size(); ++i) {
+		const auto width = m_widths[i];
+		if (Columns[i].Type == Exh::String) {
+			const auto ref = InternString(row.EscapedString(i));
+			std::copy_n(reinterpret_cast<const char*>(&ref), width, &data.Cells[i][rowIndex * width]);
+		} else {
+			const auto value = row.Raw(i);
+			std::copy_n(reinterpret_cast<const char*>(&value), width, &data.Cells[i][rowIndex * width]);
+		}
+	}
+	data.Present[rowIndex] = 1;
+}
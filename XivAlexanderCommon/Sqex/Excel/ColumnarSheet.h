@@ -0,0 +1,100 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "XivAlexanderCommon/Sqex/Excel.h"
+#include "XivAlexanderCommon/Sqex/Excel/Reader.h"
+
+namespace Sqex::Excel {
+	/*
+	 * Decoded rows of a 2nd depth sheet, stored column by column for every language.
+	 *
+	 * Fixed size columns are kept as native endian values, one array per column per language, with the width of the
+	 * column type; packed booleans take a byte each. String columns keep (offset, length) pairs into an arena of
+	 * escaped strings shared by all languages, in which every distinct string is stored once; equal strings therefore
+	 * always have the same StringRef. Rows are addressed by row index, which stays stable once a row is added.
+	 *
+	 * The arena only grows: a string that is no longer referenced after its cells are overwritten or removed stays in
+	 * it until CompactStrings is called.
+	 */
+	class ColumnarSheet {
+	public:
+		static constexpr size_t NoRow = SIZE_MAX;
+
+		struct StringRef {
+			uint32_t Offset;
+			uint32_t Length;
+		};
+
+		const std::vector<Exh::Column> Columns;
+
+	private:
+		struct LanguageData {
+			std::vector<uint8_t> Present;
+			std::vector<std::vector<char>> Cells;
+		};
+
+		const std::vector<size_t> m_widths;
+		std::vector<uint32_t> m_rowIds;
+		std::unordered_map<uint32_t, size_t> m_rowIndices;
+		bool m_rowIdsSorted = true;
+		std::map<Language, LanguageData> m_languages;
+		std::string m_strings;
+		std::unordered_multimap<size_t, StringRef> m_stringIndex;  // Hash of the content to the interned string
+
+		[[nodiscard]] const LanguageData* GetLanguage(Language language) const;
+		LanguageData& GetOrCreateLanguage(Language language);
+		[[nodiscard]] StringRef InternString(std::string_view escaped);
+		[[nodiscard]] std::string_view StringAt(const StringRef& ref) const {
+			return std::string_view(m_strings).substr(ref.Offset, ref.Length);
+		}
+
+	public:
+		ColumnarSheet(std::vector<Exh::Column> columns);
+
+		[[nodiscard]] static size_t CellWidth(Exh::ColumnDataType type);
+
+		[[nodiscard]] size_t RowCount() const { return m_rowIds.size(); }
+		[[nodiscard]] uint32_t RowId(size_t rowIndex) const { return m_rowIds[rowIndex]; }
+		[[nodiscard]] size_t RowIndexOf(uint32_t id) const;
+		size_t AddRow(uint32_t id);
+
+		// Row indices in ascending order of row ids.
+		[[nodiscard]] std::vector<size_t> SortedRowIndices() const;
+
+		[[nodiscard]] std::vector<Language> Languages() const;
+		[[nodiscard]] bool HasRow(size_t rowIndex, Language language) const;
+		void RemoveRow(size_t rowIndex, Language language);
+		void CopyRow(size_t rowIndex, Language fromLanguage, Language toLanguage);
+
+		// Bits of a non-string cell, zero-extended.
+		[[nodiscard]] uint64_t Raw(size_t rowIndex, Language language, size_t column) const;
+		void SetRaw(size_t rowIndex, Language language, size_t column, uint64_t value);
+
+		// Equal strings share storage, so the returned views of equal strings point to the same address.
+		[[nodiscard]] std::string_view EscapedString(size_t rowIndex, Language language, size_t column) const;
+		void SetEscapedString(size_t rowIndex, Language language, size_t column, std::string_view escaped);
+
+		void CopyCell(size_t rowIndex, Language fromLanguage, Language toLanguage, size_t column);
+
+		// Size of the arena holding every distinct string.
+		[[nodiscard]] size_t StringBytes() const { return m_strings.size(); }
+
+		// Drops strings no longer referenced by any present row. Invalidates views returned by EscapedString.
+		void CompactStrings();
+
+		// String cells are appended to strings when reading, and looked up from strings when writing.
+		[[nodiscard]] ExdCell Column(size_t rowIndex, Language language, size_t column, ExdStringArena& strings) const;
+		void SetColumn(size_t rowIndex, Language language, size_t column, const ExdCell& value, const ExdStringArena& strings);
+
+		[[nodiscard]] std::vector<ExdCell> Row(size_t rowIndex, Language language, ExdStringArena& strings) const;
+		void SetRow(size_t rowIndex, Language language, std::span<const ExdCell> row, const ExdStringArena& strings);
+
+		[[nodiscard]] ExdColumn Column(size_t rowIndex, Language language, size_t column) const;
+		void SetColumn(size_t rowIndex, Language language, size_t column, const ExdColumn& value);
+
+		[[nodiscard]] std::vector<ExdColumn> Row(size_t rowIndex, Language language) const;
+		void SetRow(size_t rowIndex, Language language, std::span<const ExdColumn> row);
+		void SetRow(size_t rowIndex, Language language, const ExdReader::RowView& row);
+	};
+}
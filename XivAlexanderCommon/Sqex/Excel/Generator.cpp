@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "XivAlexanderCommon/Sqex/Excel/Generator.h"
 
+#include "XivAlexanderCommon/Utils/Win32/ThreadPool.h"
+
 Sqex::Excel::Depth2ExhExdCreator::Depth2ExhExdCreator(std::string name, std::vector<Exh::Column> columns, const Exh::ExhFlag& flag)
 	: Name(std::move(name))
 	, Columns(std::move(columns))
@@ -45,7 +47,8 @@ Sqex::Excel::Depth2ExhExdCreator::Depth2ExhExdCreator(std::string name, std::vec
 			}
 		}
 		return Sqex::Align<uint32_t>(size, 8).Alloc;
-	}()) {
+	}())
+	, Sheet(Columns) {
 }
 
 void Sqex::Excel::Depth2ExhExdCreator::AddLanguage(Language language) {
@@ -54,46 +57,53 @@ void Sqex::Excel::Depth2ExhExdCreator::AddLanguage(Language language) {
 		Languages.insert(it, language);
 }
 
-const std::vector<Sqex::Excel::ExdColumn>& Sqex::Excel::Depth2ExhExdCreator::GetRow(uint32_t id, Language language) const {
-	return Data.at(id).at(language);
+std::vector<Sqex::Excel::ExdCell> Sqex::Excel::Depth2ExhExdCreator::GetRow(uint32_t id, Language language, ExdStringArena& strings) const {
+	const auto rowIndex = Sheet.RowIndexOf(id);
+	if (rowIndex == ColumnarSheet::NoRow)
+		throw std::out_of_range("Row does not exist");
+	return Sheet.Row(rowIndex, language, strings);
+}
+
+void Sqex::Excel::Depth2ExhExdCreator::SetRow(uint32_t id, Language language, std::span<const ExdCell> row, const ExdStringArena& strings, bool replace) {
+	if (!row.empty() && row.size() != Columns.size())
+		throw std::invalid_argument(std::format("bad column data (expected {} columns, got {} columns)", Columns.size(), row.size()));
+	const auto rowIndex = Sheet.AddRow(id);
+	if (!Sheet.HasRow(rowIndex, language) || replace)
+		Sheet.SetRow(rowIndex, language, row, strings);
+}
+
+std::vector<Sqex::Excel::ExdColumn> Sqex::Excel::Depth2ExhExdCreator::GetRow(uint32_t id, Language language) const {
+	const auto rowIndex = Sheet.RowIndexOf(id);
+	if (rowIndex == ColumnarSheet::NoRow)
+		throw std::out_of_range("Row does not exist");
+	return Sheet.Row(rowIndex, language);
 }
 
-void Sqex::Excel::Depth2ExhExdCreator::SetRow(uint32_t id, Language language, std::vector<ExdColumn> row, bool replace) {
+void Sqex::Excel::Depth2ExhExdCreator::SetRow(uint32_t id, Language language, std::span<const ExdColumn> row, bool replace) {
 	if (!row.empty() && row.size() != Columns.size())
 		throw std::invalid_argument(std::format("bad column data (expected {} columns, got {} columns)", Columns.size(), row.size()));
-	auto& target = Data[id][language];
-	if (target.empty() || replace)
-		target = std::move(row);
+	const auto rowIndex = Sheet.AddRow(id);
+	if (!Sheet.HasRow(rowIndex, language) || replace)
+		Sheet.SetRow(rowIndex, language, row);
 }
 
-std::pair<Sqex::Sqpack::EntryPathSpec, std::vector<char>> Sqex::Excel::Depth2ExhExdCreator::Flush(uint32_t startId, std::map<uint32_t, std::vector<char>> rows, Language language) {
+void Sqex::Excel::Depth2ExhExdCreator::SetRow(uint32_t id, Language language, const ExdReader::RowView& row, bool replace) {
+	const auto rowIndex = Sheet.AddRow(id);
+	if (!Sheet.HasRow(rowIndex, language) || replace)
+		Sheet.SetRow(rowIndex, language, row);
+}
+
+std::pair<Sqex::Sqpack::EntryPathSpec, std::vector<char>> Sqex::Excel::Depth2ExhExdCreator::Flush(uint32_t startId, std::span<const Exd::RowLocator> locators, std::vector<char> exdFile, Language language) const {
 	Exd::Header exdHeader;
 	const auto exdHeaderSpan = span_cast<char>(1, &exdHeader);
+	const auto locatorSpan = span_cast<char>(locators);
 	memcpy(exdHeader.Signature, Exd::Header::Signature_Value, 4);
 	exdHeader.Version = Exd::Header::Version_Value;
-
-	size_t dataSize = 0;
-	for (const auto& row : rows | std::views::values)
-		dataSize += row.size();
-	exdHeader.DataSize = static_cast<uint32_t>(dataSize);
-
-	std::vector<Exd::RowLocator> locators;
-	auto offsetAccumulator = static_cast<uint32_t>(sizeof exdHeader + rows.size() * sizeof Exd::RowLocator);
-	for (const auto& row : rows) {
-		locators.emplace_back(row.first, offsetAccumulator);
-		offsetAccumulator += static_cast<uint32_t>(row.second.size());
-		if (reinterpret_cast<const Exd::RowHeader*>(&row.second[0])->DataSize != row.second.size() - 6)
-			__debugbreak();
-	}
-	const auto locatorSpan = span_cast<char>(locators);
 	exdHeader.IndexSize = static_cast<uint32_t>(locatorSpan.size_bytes());
-
-	std::vector<char> exdFile;
-	exdFile.reserve(offsetAccumulator);
-	std::copy_n(&exdHeaderSpan[0], exdHeaderSpan.size_bytes(), std::back_inserter(exdFile));
-	std::copy_n(&locatorSpan[0], locatorSpan.size_bytes(), std::back_inserter(exdFile));
-	for (const auto& row : rows | std::views::values)
-		std::copy_n(&row[0], row.size(), std::back_inserter(exdFile));
+	exdHeader.DataSize = static_cast<uint32_t>(exdFile.size() - exdHeaderSpan.size_bytes() - locatorSpan.size_bytes());
+	std::copy_n(&exdHeaderSpan[0], exdHeaderSpan.size_bytes(), &exdFile[0]);
+	if (!locatorSpan.empty())
+		std::copy_n(&locatorSpan[0], locatorSpan.size_bytes(), &exdFile[exdHeaderSpan.size_bytes()]);
 
 	const auto* languageCode = "";
 	switch (language) {
@@ -129,126 +139,151 @@ std::pair<Sqex::Sqpack::EntryPathSpec, std::vector<char>> Sqex::Excel::Depth2Exh
 	);
 }
 
+void Sqex::Excel::Depth2ExhExdCreator::LayoutStrings(RowStrings& layout, size_t rowIndex, Language language) const {
+	layout.Escaped.clear();
+	layout.Offsets.clear();
+	layout.Size = 0;
+	for (size_t i = 0; i < Columns.size(); ++i) {
+		if (Columns[i].Type != Exh::String)
+			continue;
+
+		const auto escaped = Sheet.EscapedString(rowIndex, language, i);
+		auto offset = layout.Size;
+		if (DeduplicateStrings) {
+			// Strings are interned in Sheet, so equal strings are at the same address.
+			for (size_t j = 0; j < layout.Escaped.size(); ++j) {
+				if (layout.Escaped[j].data() == escaped.data() && layout.Escaped[j].size() == escaped.size()) {
+					offset = layout.Offsets[j];
+					break;
+				}
+			}
+		}
+		if (offset == layout.Size)
+			layout.Size += escaped.size() + 1;
+		layout.Escaped.emplace_back(escaped);
+		layout.Offsets.emplace_back(static_cast<uint32_t>(offset));
+	}
+}
+
+size_t Sqex::Excel::Depth2ExhExdCreator::RowSize(const RowStrings& layout) const {
+	return Sqex::Align<size_t>(sizeof(Exd::RowHeader) + FixedDataSize + layout.Size, 4);
+}
+
+void Sqex::Excel::Depth2ExhExdCreator::WriteRow(std::span<char> row, size_t rowIndex, Language language, const RowStrings& layout) const {
+	const auto fixedDataOffset = sizeof(Exd::RowHeader);
+	const auto variableDataOffset = fixedDataOffset + FixedDataSize;
+	size_t stringIndex = 0;
+
+	for (size_t i = 0; i < Columns.size(); ++i) {
+		const auto& columnDefinition = Columns[i];
+		switch (columnDefinition.Type) {
+			case Exh::String: {
+				const auto offset = layout.Offsets[stringIndex];
+				const auto stringOffset = BE(offset);
+				std::copy_n(reinterpret_cast<const char*>(&stringOffset), 4, &row[fixedDataOffset + columnDefinition.Offset]);
+				std::ranges::copy(layout.Escaped[stringIndex], row.begin() + variableDataOffset + offset);
+				stringIndex++;
+				break;
+			}
+
+			case Exh::PackedBool0:
+			case Exh::PackedBool1:
+			case Exh::PackedBool2:
+			case Exh::PackedBool3:
+			case Exh::PackedBool4:
+			case Exh::PackedBool5:
+			case Exh::PackedBool6:
+			case Exh::PackedBool7:
+				if (Sheet.Raw(rowIndex, language, i))
+					row[fixedDataOffset + columnDefinition.Offset] |= (1 << (static_cast<int>(columnDefinition.Type.Value()) - static_cast<int>(Exh::PackedBool0)));
+				break;
+
+			default: {
+				const auto value = Sheet.Raw(rowIndex, language, i);
+				const auto width = ColumnarSheet::CellWidth(columnDefinition.Type);
+				const auto target = row.subspan(fixedDataOffset + columnDefinition.Offset, width);
+				std::copy_n(reinterpret_cast<const char*>(&value), width, &target[0]);
+				// ReSharper disable once CppUseRangeAlgorithm
+				std::reverse(target.begin(), target.end());
+			}
+		}
+	}
+
+	Exd::RowHeader rowHeader;
+	rowHeader.DataSize = static_cast<uint32_t>(row.size() - fixedDataOffset);
+	rowHeader.SubRowCount = 1;
+	std::copy_n(reinterpret_cast<const char*>(&rowHeader), sizeof rowHeader, &row[0]);
+}
+
+std::optional<std::pair<Sqex::Sqpack::EntryPathSpec, std::vector<char>>> Sqex::Excel::Depth2ExhExdCreator::CompilePage(uint32_t startId, std::span<const size_t> rowIndices, Language language) const {
+	std::vector<std::pair<size_t, Language>> sources;
+	sources.reserve(rowIndices.size());
+	for (const auto rowIndex : rowIndices) {
+		if (Sheet.HasRow(rowIndex, language)) {
+			sources.emplace_back(rowIndex, language);
+			continue;
+		}
+		for (const auto lang : FillMissingLanguageFrom) {
+			if (Sheet.HasRow(rowIndex, lang)) {
+				sources.emplace_back(rowIndex, lang);
+				break;
+			}
+		}
+	}
+	if (sources.empty())
+		return std::nullopt;
+
+	// Lay out every row first, so that the file is allocated once and rows are written in place.
+	std::vector<Exd::RowLocator> locators;
+	std::vector<size_t> rowSizes;
+	locators.reserve(sources.size());
+	rowSizes.reserve(sources.size());
+	RowStrings layout;
+	auto fileSize = sizeof(Exd::Header) + sources.size() * sizeof(Exd::RowLocator);
+	for (const auto& [rowIndex, sourceLanguage] : sources) {
+		LayoutStrings(layout, rowIndex, sourceLanguage);
+		locators.emplace_back(Sheet.RowId(rowIndex), static_cast<uint32_t>(fileSize));
+		rowSizes.emplace_back(RowSize(layout));
+		fileSize += rowSizes.back();
+	}
+
+	std::vector<char> exdFile(fileSize);
+	for (size_t i = 0; i < sources.size(); ++i) {
+		LayoutStrings(layout, sources[i].first, sources[i].second);
+		WriteRow(std::span(exdFile).subspan(locators[i].Offset, rowSizes[i]), sources[i].first, sources[i].second, layout);
+	}
+	return Flush(startId, locators, std::move(exdFile), language);
+}
+
 std::map<Sqex::Sqpack::EntryPathSpec, std::vector<char>, Sqex::Sqpack::EntryPathSpec::FullPathComparator> Sqex::Excel::Depth2ExhExdCreator::Compile(size_t divideUnit) {
 	std::map<Sqpack::EntryPathSpec, std::vector<char>, Sqpack::EntryPathSpec::FullPathComparator> result;
-	std::vector<std::pair<Exh::Pagination, std::vector<uint32_t>>> pages;
-	for (const auto id : Data | std::views::keys) {
+	std::vector<std::pair<Exh::Pagination, std::vector<size_t>>> pages;
+	Sheet.CompactStrings();
+	for (const auto rowIndex : Sheet.SortedRowIndices()) {
+		const auto id = Sheet.RowId(rowIndex);
 		if (pages.empty()) {
 			pages.emplace_back();
 		} else if (pages.back().second.size() == divideUnit || DivideAtIds.find(id) != DivideAtIds.end()) {
-			pages.back().first.RowCountWithSkip = pages.back().second.back() - pages.back().second.front() + 1;
+			pages.back().first.RowCountWithSkip = Sheet.RowId(pages.back().second.back()) - Sheet.RowId(pages.back().second.front()) + 1;
 			pages.emplace_back();
 		}
 
 		if (pages.back().second.empty())
 			pages.back().first.StartId = id;
-		pages.back().second.push_back(id);
+		pages.back().second.push_back(rowIndex);
 	}
 	if (pages.empty())
 		return {};
-	pages.back().first.RowCountWithSkip = pages.back().second.back() - pages.back().second.front() + 1;
-
-	for (const auto& page : pages) {
-		for (const auto language : Languages) {
-			std::map<uint32_t, std::vector<char>> rows;
-			for (const auto id : page.second) {
-				std::vector<char> row(sizeof Exd::RowHeader + FixedDataSize);
-
-				const auto fixedDataOffset = sizeof Exd::RowHeader;
-				const auto variableDataOffset = fixedDataOffset + FixedDataSize;
-
-				auto sourceLanguage = language;
-				auto& rowSet = Data[id];
-				if (rowSet.find(sourceLanguage) == rowSet.end()) {
-					sourceLanguage = Language::Unspecified;
-					for (auto lang : FillMissingLanguageFrom) {
-						if (rowSet.find(lang) == rowSet.end()) {
-							sourceLanguage = lang;
-							break;
-						}
-					}
-					if (sourceLanguage == Language::Unspecified)
-						continue;
-				}
-
-				auto& columns = rowSet[sourceLanguage];
-				if (columns.empty())
-					continue;
-
-				for (size_t i = 0; i < columns.size(); ++i) {
-					auto& column = columns[i];
-					const auto& columnDefinition = Columns[i];
-					switch (columnDefinition.Type) {
-						case Exh::String:
-						{
-							const auto stringOffset = BE(static_cast<uint32_t>(row.size() - variableDataOffset));
-							std::copy_n(reinterpret_cast<const char*>(&stringOffset), 4, &row[fixedDataOffset + columnDefinition.Offset]);
-							row.reserve(row.size() + column.String.Escaped().size() + 1);
-							row.insert(row.end(), column.String.Escaped().begin(), column.String.Escaped().end());
-							row.push_back(0);
-							column.ValidSize = 0;
-							break;
-						}
-
-						case Exh::Bool:
-						case Exh::Int8:
-						case Exh::UInt8:
-							column.ValidSize = 1;
-							break;
-
-						case Exh::Int16:
-						case Exh::UInt16:
-							column.ValidSize = 2;
-							break;
-
-						case Exh::Int32:
-						case Exh::UInt32:
-						case Exh::Float32:
-							column.ValidSize = 4;
-							break;
-
-						case Exh::Int64:
-						case Exh::UInt64:
-							column.ValidSize = 8;
-							break;
-
-						case Exh::PackedBool0:
-						case Exh::PackedBool1:
-						case Exh::PackedBool2:
-						case Exh::PackedBool3:
-						case Exh::PackedBool4:
-						case Exh::PackedBool5:
-						case Exh::PackedBool6:
-						case Exh::PackedBool7:
-							column.ValidSize = 0;
-							if (column.boolean)
-								row[fixedDataOffset + columnDefinition.Offset] |= (1 << (static_cast<int>(column.Type) - static_cast<int>(Exh::PackedBool0)));
-							else
-								row[fixedDataOffset + columnDefinition.Offset] &= ~((1 << (static_cast<int>(column.Type) - static_cast<int>(Exh::PackedBool0))));
-							break;
-					}
-					if (column.ValidSize) {
-						const auto target = std::span(row).subspan(fixedDataOffset + columnDefinition.Offset, column.ValidSize);
-						std::copy_n(&column.Buffer[0], column.ValidSize, &target[0]);
-						// ReSharper disable once CppUseRangeAlgorithm
-						std::reverse(target.begin(), target.end());
-					}
-				}
-				row.resize(Sqex::Align<size_t>(row.size(), 4));
-
-				auto& rowHeader = *reinterpret_cast<Exd::RowHeader*>(&row[0]);
-				rowHeader.DataSize = static_cast<uint32_t>(row.size() - sizeof rowHeader);
-				rowHeader.SubRowCount = 1;
-
-				if (reinterpret_cast<const Exd::RowHeader*>(&row[0])->DataSize != row.size() - 6)
-					__debugbreak();
-
-				rows.emplace(id, std::move(row));
-			}
-			if (rows.empty())
-				continue;
-			result.emplace(Flush(page.first.StartId, std::move(rows), language));
-		}
+	pages.back().first.RowCountWithSkip = Sheet.RowId(pages.back().second.back()) - Sheet.RowId(pages.back().second.front()) + 1;
+
+	std::vector<std::optional<std::pair<Sqpack::EntryPathSpec, std::vector<char>>>> compiledPages(pages.size() * Languages.size());
+	Utils::Win32::ParallelFor(compiledPages.size(), [&](size_t i) {
+		const auto& [pagination, rowIndices] = pages[i / Languages.size()];
+		compiledPages[i] = CompilePage(pagination.StartId, rowIndices, Languages[i % Languages.size()]);
+	});
+	for (auto& compiledPage : compiledPages) {
+		if (compiledPage)
+			result.emplace(std::move(*compiledPage));
 	}
 
 	{
@@ -262,7 +297,7 @@ std::map<Sqex::Sqpack::EntryPathSpec, std::vector<char>, Sqex::Sqpack::EntryPath
 		exhHeader.LanguageCount = static_cast<uint16_t>(Languages.size());
 		exhHeader.Flags = Flags;
 		exhHeader.Depth = Exh::Level2;
-		exhHeader.RowCountWithoutSkip = static_cast<uint32_t>(Data.size());
+		exhHeader.RowCountWithoutSkip = static_cast<uint32_t>(Sheet.RowCount());
 
 		const auto columnSpan = span_cast<char>(Columns);
 		std::vector<Exh::Pagination> paginations;
@@ -1,5 +1,9 @@
 #pragma once
+
+#include <optional>
+
 #include "XivAlexanderCommon/Sqex/Excel.h"
+#include "XivAlexanderCommon/Sqex/Excel/ColumnarSheet.h"
 #include "XivAlexanderCommon/Sqex/Sqpack.h"
 
 namespace Sqex::Excel {
@@ -9,22 +13,45 @@ namespace Sqex::Excel {
 		const std::vector<Exh::Column> Columns;
 		const Exh::ExhFlag Flags;
 		const uint32_t FixedDataSize;
-		std::map<uint32_t, std::map<Language, std::vector<ExdColumn>>> Data;
+		ColumnarSheet Sheet;
 		std::set<uint32_t> DivideAtIds;
 		std::vector<Language> Languages;
 		std::vector<Language> FillMissingLanguageFrom;
 
+		// If set, identical strings within a row are written once, and every column holding it points there.
+		bool DeduplicateStrings = false;
+
 		Depth2ExhExdCreator(std::string name, std::vector<Exh::Column> columns, const Exh::ExhFlag& flag);
 
 		void AddLanguage(Language language);
 
-		const std::vector<ExdColumn>& GetRow(uint32_t id, Language language) const;
-		void SetRow(uint32_t id, Language language, std::vector<ExdColumn> row, bool replace = true);
+		[[nodiscard]] std::vector<ExdCell> GetRow(uint32_t id, Language language, ExdStringArena& strings) const;
+		void SetRow(uint32_t id, Language language, std::span<const ExdCell> row, const ExdStringArena& strings, bool replace = true);
+		[[nodiscard]] std::vector<ExdColumn> GetRow(uint32_t id, Language language) const;
+		void SetRow(uint32_t id, Language language, std::span<const ExdColumn> row, bool replace = true);
+		void SetRow(uint32_t id, Language language, const ExdReader::RowView& row, bool replace = true);
 
 	private:
-		std::pair<Sqpack::EntryPathSpec, std::vector<char>> Flush(uint32_t startId, std::map<uint32_t, std::vector<char>> rows, Language language);
+		// Escaped strings of a row, and where each of them goes in the variable data of the row.
+		struct RowStrings {
+			std::vector<std::string_view> Escaped;
+			std::vector<uint32_t> Offsets;
+			size_t Size = 0;
+		};
+
+		void LayoutStrings(RowStrings& layout, size_t rowIndex, Language language) const;
+		[[nodiscard]] size_t RowSize(const RowStrings& layout) const;
+
+		// row should be zero-filled, and exactly RowSize bytes long.
+		void WriteRow(std::span<char> row, size_t rowIndex, Language language, const RowStrings& layout) const;
+
+		// exdFile should have space reserved for the header and the row locators at the beginning.
+		std::pair<Sqpack::EntryPathSpec, std::vector<char>> Flush(uint32_t startId, std::span<const Exd::RowLocator> locators, std::vector<char> exdFile, Language language) const;
+
+		[[nodiscard]] std::optional<std::pair<Sqpack::EntryPathSpec, std::vector<char>>> CompilePage(uint32_t startId, std::span<const size_t> rowIndices, Language language) const;
 
 	public:
+		// Each (page, language) pair is compiled separately, on idle threads of the process thread pool as well as the calling thread.
 		std::map<Sqpack::EntryPathSpec, std::vector<char>, Sqpack::EntryPathSpec::FullPathComparator> Compile(size_t divideUnit = SIZE_MAX);
 	};
 }
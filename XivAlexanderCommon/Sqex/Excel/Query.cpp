@@ -0,0 +1,332 @@
+#include "pch.h"
+#include "XivAlexanderCommon/Sqex/Excel/Query.h"
+
+#include "XivAlexanderCommon/Sqex/SeString.h"
+#include "XivAlexanderCommon/Utils/Win32/ThreadPool.h"
+
+Sqex::Excel::SheetCache::SheetCache(const Sqpack::GameReader& game, size_t maxPages)
+	: m_game(game)
+	, m_maxPages(std::max<size_t>(1, maxPages))
+	, m_exl(*game.GetFile("exd/root.exl")) {
+}
+
+std::shared_ptr<const Sqex::Excel::ExhReader> Sqex::Excel::SheetCache::Sheet(const std::string& name) const {
+	{
+		const auto lock = std::lock_guard(m_mtx);
+		if (const auto it = m_sheets.find(name); it != m_sheets.end())
+			return it->second;
+	}
+
+	auto exh = std::make_shared<const ExhReader>(name, *m_game.GetFile(std::format("exd/{}.exh", name)));
+
+	const auto lock = std::lock_guard(m_mtx);
+	return m_sheets.emplace(name, std::move(exh)).first->second;
+}
+
+std::shared_ptr<const Sqex::Excel::ExdReader> Sqex::Excel::SheetCache::Page(const std::string& name, size_t pageIndex, Language language) const {
+	auto key = PageKey{ name, pageIndex, language };
+	{
+		const auto lock = std::lock_guard(m_mtx);
+		if (const auto it = m_pageIndex.find(key); it != m_pageIndex.end()) {
+			m_pages.splice(m_pages.begin(), m_pages, it->second);
+			return it->second->second;
+		}
+	}
+
+	// Decode outside the lock; if another thread decoded the same page meanwhile, theirs is kept.
+	const auto exh = Sheet(name);
+	auto page = std::make_shared<const ExdReader>(*exh, m_game[exh->GetDataPathSpec(exh->Pages.at(pageIndex), language)]);
+
+	const auto lock = std::lock_guard(m_mtx);
+	if (const auto it = m_pageIndex.find(key); it != m_pageIndex.end()) {
+		m_pages.splice(m_pages.begin(), m_pages, it->second);
+		return it->second->second;
+	}
+	m_pages.emplace_front(key, page);
+	m_pageIndex.emplace(std::move(key), m_pages.begin());
+	while (m_pages.size() > m_maxPages) {
+		m_pageIndex.erase(m_pages.back().first);
+		m_pages.pop_back();
+	}
+	return page;
+}
+
+std::shared_ptr<const Sqex::Excel::ExdReader> Sqex::Excel::SheetCache::PageOfRow(const std::string& name, uint32_t rowId, Language language) const {
+	const auto pageIndex = PageIndexOfRow(*Sheet(name), rowId);
+	if (!pageIndex)
+		return nullptr;
+	return Page(name, *pageIndex, language);
+}
+
+std::optional<size_t> Sqex::Excel::SheetCache::PageIndexOfRow(const ExhReader& exh, uint32_t rowId) {
+	for (size_t i = 0; i < exh.Pages.size(); ++i) {
+		const auto& page = exh.Pages[i];
+		if (page.StartId <= rowId && rowId - page.StartId < page.RowCountWithSkip)
+			return i;
+	}
+	return std::nullopt;
+}
+
+std::optional<Sqex::Language> Sqex::Excel::SheetCache::ResolveLanguage(const ExhReader& exh, Language language) {
+	if (std::ranges::find(exh.Languages, language) != exh.Languages.end())
+		return language;
+	if (std::ranges::find(exh.Languages, Language::Unspecified) != exh.Languages.end())
+		return Language::Unspecified;
+	if (language == Language::Unspecified && !exh.Languages.empty())
+		return exh.Languages.front();
+	return std::nullopt;
+}
+
+std::string Sqex::Excel::Query::CellText(const ExdReader::RowView& row, size_t index) {
+	switch (row.Type(index)) {
+		case Exh::String: {
+			const auto escaped = row.EscapedString(index);
+			if (SeStringTokenizer::FindStartOfText(escaped) == std::string_view::npos)
+				return std::string(escaped);
+
+			std::string result;
+			result.reserve(escaped.size());
+			SeStringToken token;
+			for (SeStringTokenizer tokenizer(escaped); tokenizer.Next(token);) {
+				if (!token.IsPayload)
+					result += token.Escaped;
+				else if (token.PayloadType == static_cast<uint32_t>(SePayload::PayloadType::NewLine))
+					result += '\n';
+				else {
+					result += std::format("<{:02X}:", token.PayloadType);
+					for (const auto c : token.PayloadData)
+						result += std::format("{:02X}", static_cast<uint8_t>(c));
+					result += '>';
+				}
+			}
+			return result;
+		}
+
+		case Exh::Float32:
+			return std::format("{}", row.Float32(index));
+
+		case Exh::UInt64:
+			return std::format("{}", row.UInt64(index));
+
+		default:
+			return std::format("{}", row.Int64(index));
+	}
+}
+
+nlohmann::json Sqex::Excel::Query::CellJson(const ExdReader::RowView& row, size_t index) {
+	switch (row.Type(index)) {
+		case Exh::String:
+			return CellText(row, index);
+
+		case Exh::Float32:
+			return row.Float32(index);
+
+		case Exh::UInt64:
+			return row.UInt64(index);
+
+		case Exh::Bool:
+		case Exh::PackedBool0:
+		case Exh::PackedBool1:
+		case Exh::PackedBool2:
+		case Exh::PackedBool3:
+		case Exh::PackedBool4:
+		case Exh::PackedBool5:
+		case Exh::PackedBool6:
+		case Exh::PackedBool7:
+			return row.Bool(index);
+
+		default:
+			return row.Int64(index);
+	}
+}
+
+static void AppendCsvField(std::string& line, std::string_view field) {
+	if (!line.empty())
+		line += ',';
+	if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+		line += field;
+		return;
+	}
+
+	line += '"';
+	for (const auto c : field) {
+		if (c == '"')
+			line += '"';
+		line += c;
+	}
+	line += '"';
+}
+
+size_t Sqex::Excel::Query::Run(const SheetCache& cache, std::ostream& out, OutputFormat format) const {
+	struct Unit {
+		std::shared_ptr<const ExhReader> Exh;
+		size_t PageIndex;
+		Sqex::Language Language;
+	};
+
+	// Sheet headers are tiny, so every unit of work is listed up front; pages are read only when evaluated.
+	std::vector<Unit> units;
+	for (const auto& name : cache.Exl() | std::views::keys) {
+		if (!srell::regex_match(name, SheetPattern))
+			continue;
+
+		std::shared_ptr<const ExhReader> exh;
+		try {
+			exh = cache.Sheet(name);
+		} catch (const std::out_of_range&) {
+			continue;  // Listed in root.exl, but not present
+		}
+
+		std::vector<Language> languages;
+		if (Languages.empty())
+			languages = exh->Languages;
+		else {
+			for (const auto language : Languages) {
+				if (const auto resolved = SheetCache::ResolveLanguage(*exh, language); resolved && std::ranges::find(languages, *resolved) == languages.end())
+					languages.emplace_back(*resolved);
+			}
+		}
+
+		for (const auto language : languages)
+			for (size_t i = 0; i < exh->Pages.size(); ++i)
+				units.emplace_back(Unit{ exh, i, language });
+	}
+
+	std::vector<std::shared_ptr<const ExhReader>> joinSheets;
+	for (const auto& join : Joins)
+		joinSheets.emplace_back(cache.Sheet(join.Sheet));
+
+	if (format == OutputFormat::Csv && !Columns.empty() && std::ranges::all_of(Joins, [](const auto& join) { return !join.Columns.empty(); })) {
+		std::string line;
+		for (const auto name : { "sheet", "language", "id", "subrow" })
+			AppendCsvField(line, name);
+		for (const auto column : Columns)
+			AppendCsvField(line, std::format("{}", column));
+		for (const auto& join : Joins)
+			for (const auto column : join.Columns)
+				AppendCsvField(line, std::format("{}.{}", join.Sheet, column));
+		out << line << '\n';
+	}
+
+	const auto evaluate = [&](const Unit& unit, std::string& chunk) {
+		const auto page = cache.Page(unit.Exh->Name, unit.PageIndex, unit.Language);
+		const auto languageName = nlohmann::json(unit.Language).get<std::string>();
+
+		// Consecutive rows mostly join into the same page; remember the last one for each join.
+		std::vector<std::pair<std::optional<size_t>, std::shared_ptr<const ExdReader>>> joinPages(Joins.size());
+
+		size_t count = 0;
+		const auto emit = [&](uint32_t id, std::optional<size_t> subRowId, const ExdReader::RowView& row) {
+			for (const auto& condition : Conditions) {
+				const auto matches = condition.Column < row.Size() && srell::regex_search(CellText(row, condition.Column), condition.Pattern);
+				if (matches == condition.Negate)
+					return;
+			}
+
+			std::string line;
+			nlohmann::json values, joined;
+			const auto appendCells = [&](const ExdReader::RowView* source, const std::vector<size_t>& columns, nlohmann::json& target) {
+				const auto columnCount = columns.empty() ? (source ? source->Size() : 0) : columns.size();
+				target = nlohmann::json::array();
+				for (size_t i = 0; i < columnCount; ++i) {
+					const auto column = columns.empty() ? i : columns[i];
+					const auto present = source && column < source->Size();
+					if (format == OutputFormat::Csv)
+						AppendCsvField(line, present ? CellText(*source, column) : std::string());
+					else
+						target.emplace_back(present ? CellJson(*source, column) : nullptr);
+				}
+			};
+
+			if (format == OutputFormat::Csv) {
+				AppendCsvField(line, unit.Exh->Name);
+				AppendCsvField(line, languageName);
+				AppendCsvField(line, std::format("{}", id));
+				AppendCsvField(line, subRowId ? std::format("{}", *subRowId) : std::string());
+			}
+			appendCells(&row, Columns, values);
+
+			joined = nlohmann::json::array();
+			for (size_t i = 0; i < Joins.size(); ++i) {
+				const auto& join = Joins[i];
+				const auto& joinExh = *joinSheets[i];
+				auto& [lastPageIndex, joinPage] = joinPages[i];
+
+				ExdReader::RowView joinedRow;
+				const ExdReader::RowView* source = nullptr;
+				if (join.Column < row.Size() && row.Type(join.Column) != Exh::String && row.Type(join.Column) != Exh::Float32) {
+					const auto joinId = row.Int64(join.Column);
+					const auto joinLanguage = SheetCache::ResolveLanguage(joinExh, unit.Language);
+					const auto pageIndex = joinId >= 0 && joinId <= UINT32_MAX ? SheetCache::PageIndexOfRow(joinExh, static_cast<uint32_t>(joinId)) : std::nullopt;
+					if (joinLanguage && pageIndex) {
+						if (lastPageIndex != pageIndex) {
+							joinPage = cache.Page(joinExh.Name, *pageIndex, *joinLanguage);
+							lastPageIndex = pageIndex;
+						}
+						if (joinPage->HasRow(static_cast<uint32_t>(joinId))) {
+							if (joinExh.Header.Depth == Exh::Level3) {
+								if (joinPage->ReadDepth3SubRowCount(static_cast<uint32_t>(joinId))) {
+									joinedRow = joinPage->ReadDepth3View(static_cast<uint32_t>(joinId), 0);
+									source = &joinedRow;
+								}
+							} else {
+								joinedRow = joinPage->ReadDepth2View(static_cast<uint32_t>(joinId));
+								source = &joinedRow;
+							}
+						}
+					}
+				}
+
+				nlohmann::json joinedValues;
+				appendCells(source, join.Columns, joinedValues);
+				if (format == OutputFormat::JsonLines)
+					joined.emplace_back(source ? std::move(joinedValues) : nullptr);
+			}
+
+			if (format == OutputFormat::JsonLines) {
+				auto obj = nlohmann::json::object({
+					{"sheet", unit.Exh->Name},
+					{"language", languageName},
+					{"id", id},
+				});
+				if (subRowId)
+					obj.emplace("subrow", *subRowId);
+				obj.emplace("values", std::move(values));
+				if (!Joins.empty())
+					obj.emplace("joined", std::move(joined));
+				line = obj.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+			}
+			chunk += line;
+			chunk += '\n';
+			count++;
+		};
+
+		if (unit.Exh->Header.Depth == Exh::Level3) {
+			for (const auto id : page->GetIds())
+				for (size_t i = 0, i_ = page->ReadDepth3SubRowCount(id); i < i_; ++i)
+					emit(id, i, page->ReadDepth3View(id, i));
+		} else {
+			for (const auto& [id, row] : page->Depth2Rows())
+				emit(id, std::nullopt, row);
+		}
+		return count;
+	};
+
+	size_t rowCount = 0;
+	const auto batchSize = std::max<size_t>(1, BatchSize);
+	std::vector<std::string> chunks;
+	std::vector<size_t> counts;
+	for (size_t batchStart = 0; batchStart < units.size(); batchStart += batchSize) {
+		const auto batchCount = std::min(batchSize, units.size() - batchStart);
+		chunks.assign(batchCount, std::string());
+		counts.assign(batchCount, 0);
+		Utils::Win32::ParallelFor(batchCount, [&](size_t i) {
+			counts[i] = evaluate(units[batchStart + i], chunks[i]);
+		});
+		for (size_t i = 0; i < batchCount; ++i) {
+			out << chunks[i];
+			rowCount += counts[i];
+		}
+	}
+	return rowCount;
+}
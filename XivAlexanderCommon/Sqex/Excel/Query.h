@@ -0,0 +1,85 @@
+#pragma once
+
+#include <list>
+#include <optional>
+
+#include "XivAlexanderCommon/Sqex.h"
+#include "XivAlexanderCommon/Sqex/Excel/Reader.h"
+#include "XivAlexanderCommon/Sqex/Sqpack/Reader.h"
+
+namespace Sqex::Excel {
+
+	// Reads sheets of a game installation on demand, keeping the most recently used pages around.
+	// Safe to use from multiple threads.
+	class SheetCache {
+		struct PageKey {
+			std::string Sheet;
+			size_t Page;
+			Sqex::Language Language;
+
+			auto operator<=>(const PageKey&) const = default;
+		};
+
+		const Sqpack::GameReader& m_game;
+		const size_t m_maxPages;
+		const ExlReader m_exl;
+
+		mutable std::mutex m_mtx;
+		mutable std::map<std::string, std::shared_ptr<const ExhReader>> m_sheets;
+		mutable std::list<std::pair<PageKey, std::shared_ptr<const ExdReader>>> m_pages;  // Most recently used first
+		mutable std::map<PageKey, decltype(m_pages)::iterator> m_pageIndex;
+
+	public:
+		SheetCache(const Sqpack::GameReader& game, size_t maxPages = 256);
+
+		[[nodiscard]] const ExlReader& Exl() const { return m_exl; }
+
+		// Throws std::out_of_range if the sheet does not exist.
+		[[nodiscard]] std::shared_ptr<const ExhReader> Sheet(const std::string& name) const;
+		[[nodiscard]] std::shared_ptr<const ExdReader> Page(const std::string& name, size_t pageIndex, Language language) const;
+
+		// Page that may contain the row, or nullptr if no page of the sheet covers it.
+		[[nodiscard]] std::shared_ptr<const ExdReader> PageOfRow(const std::string& name, uint32_t rowId, Language language) const;
+		[[nodiscard]] static std::optional<size_t> PageIndexOfRow(const ExhReader& exh, uint32_t rowId);
+
+		// Language itself if the sheet has it, Unspecified if the sheet is not localized,
+		// first language of the sheet if Unspecified is requested, and nullopt otherwise.
+		[[nodiscard]] static std::optional<Language> ResolveLanguage(const ExhReader& exh, Language language);
+	};
+
+	struct Query {
+		enum class OutputFormat {
+			Csv,
+			JsonLines,
+		};
+
+		struct Condition {
+			size_t Column;
+			srell::u8cregex Pattern;  // Searched in the text form of the cell
+			bool Negate = false;
+		};
+
+		struct Join {
+			size_t Column;  // Holds a row id of Sheet
+			std::string Sheet;
+			std::vector<size_t> Columns;  // Every column if empty
+		};
+
+		srell::u8cregex SheetPattern;  // Must match the whole sheet name
+		std::vector<Language> Languages;  // Every language of each sheet if empty
+		std::vector<Condition> Conditions;  // All of them must hold
+		std::vector<size_t> Columns;  // Every column if empty
+		std::vector<Join> Joins;
+
+		// Pages are evaluated in parallel, at most BatchSize of them at a time;
+		// results are written in order of sheet name, language, and row id, so that output does not depend on scheduling.
+		size_t BatchSize = 64;
+
+		// Returns the number of rows written.
+		size_t Run(const SheetCache& cache, std::ostream& out, OutputFormat format) const;
+
+		// Text form of a cell: numbers in decimal, and strings with payloads other than new lines as <type:data> in hex.
+		[[nodiscard]] static std::string CellText(const ExdReader::RowView& row, size_t index);
+		[[nodiscard]] static nlohmann::json CellJson(const ExdReader::RowView& row, size_t index);
+	};
+}
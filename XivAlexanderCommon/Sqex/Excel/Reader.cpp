@@ -112,27 +112,160 @@ void Sqex::Excel::ExhReader::Dump() const {
 Sqex::Excel::ExdReader::ExdReader(const ExhReader& exh, std::shared_ptr<const RandomAccessStream> stream, bool strict): m_stream(std::move(stream))
 	, m_fixedDataSize(exh.Header.FixedDataSize)
 	, m_depth(exh.Header.Depth)
-	, Header(m_stream->ReadStream<Exd::Header>(0))
+	, m_data(m_stream->ReadStreamIntoVector<char>(0))
+	, Header(m_data.size() >= sizeof(Exd::Header) ? *reinterpret_cast<const Exd::Header*>(&m_data[0]) : throw CorruptDataException("Data too short for header"))
 	, ColumnDefinitions(exh.Columns) {
-	const auto count = Header.IndexSize / sizeof Exd::RowLocator;
+	const auto count = Header.IndexSize / sizeof(Exd::RowLocator);
+	if (sizeof Header + count * sizeof(Exd::RowLocator) > m_data.size())
+		throw CorruptDataException("Data too short for row locators");
+
+	const auto locators = std::span(reinterpret_cast<const Exd::RowLocator*>(&m_data[sizeof Header]), count);
 	m_rowLocators.reserve(count);
-	for (const auto& locator : m_stream->ReadStreamIntoVector<Exd::RowLocator>(sizeof Header, count)) {
+	for (const auto& locator : locators)
 		m_rowLocators.emplace_back(std::make_pair(locator.RowId.Value(), locator.Offset.Value()));
-	}
 	std::ranges::sort(m_rowLocators);
-}
 
-Sqex::Excel::ExdColumn Sqex::Excel::ExdReader::TranslateColumn(const Exh::Column& columnDefinition, std::span<const char> fixedData, std::span<const char> fullData) const {
-	ExdColumn column{ .Type = columnDefinition.Type };
-	switch (column.Type) {
-		case Exh::String:
-		{
-			BE<uint32_t> stringOffset;
-			std::copy_n(&fixedData[columnDefinition.Offset], 4, reinterpret_cast<char*>(&stringOffset));
-			column.String.SetEscaped(&fullData[m_fixedDataSize + stringOffset]);
-			break;
+	// Most pages have nearly contiguous row ids; allow up to as many holes as there are rows.
+	if (!m_rowLocators.empty()) {
+		const auto span = static_cast<size_t>(m_rowLocators.back().first) - m_rowLocators.front().first + 1;
+		if (span <= 2 * m_rowLocators.size()) {
+			m_firstRowId = m_rowLocators.front().first;
+			m_directRowOffsets.resize(span);
+			for (const auto& [id, offset] : m_rowLocators) {
+				if (offset == 0)
+					throw CorruptDataException("Row offset points to the header");
+				m_directRowOffsets[id - m_firstRowId] = offset;
+			}
 		}
+	}
+}
+
+Sqex::Excel::ExdReader::RowView::RowView(const std::vector<Exh::Column>& columns, std::span<const char> fixedData, std::span<const char> stringData)
+	: m_columns(&columns)
+	, m_fixedData(fixedData)
+	, m_stringData(stringData) {
+}
+
+template<typename T>
+T Sqex::Excel::ExdReader::RowView::ReadFixed(size_t offset) const {
+	if (offset + sizeof(T) > m_fixedData.size())
+		throw CorruptDataException("Column offset out of range");
+
+	BE<T> value;
+	std::copy_n(&m_fixedData[offset], sizeof value, reinterpret_cast<char*>(&value));
+	return value.Value();
+}
+
+bool Sqex::Excel::ExdReader::RowView::Bool(size_t index) const {
+	const auto& columnDefinition = (*m_columns)[index];
+	switch (const auto type = columnDefinition.Type.Value()) {
+		case Exh::PackedBool0:
+		case Exh::PackedBool1:
+		case Exh::PackedBool2:
+		case Exh::PackedBool3:
+		case Exh::PackedBool4:
+		case Exh::PackedBool5:
+		case Exh::PackedBool6:
+		case Exh::PackedBool7:
+			return ReadFixed<uint8_t>(columnDefinition.Offset) & (1 << (static_cast<int>(type) - static_cast<int>(Exh::PackedBool0)));
+
+		default:
+			return Int64(index) != 0;
+	}
+}
+
+int64_t Sqex::Excel::ExdReader::RowView::Int64(size_t index) const {
+	const auto& columnDefinition = (*m_columns)[index];
+	switch (columnDefinition.Type) {
+		case Exh::Bool:
+		case Exh::UInt8:
+			return ReadFixed<uint8_t>(columnDefinition.Offset);
+		case Exh::Int8:
+			return ReadFixed<int8_t>(columnDefinition.Offset);
+		case Exh::Int16:
+			return ReadFixed<int16_t>(columnDefinition.Offset);
+		case Exh::UInt16:
+			return ReadFixed<uint16_t>(columnDefinition.Offset);
+		case Exh::Int32:
+			return ReadFixed<int32_t>(columnDefinition.Offset);
+		case Exh::UInt32:
+			return ReadFixed<uint32_t>(columnDefinition.Offset);
+		case Exh::Int64:
+			return ReadFixed<int64_t>(columnDefinition.Offset);
+		case Exh::UInt64:
+			return static_cast<int64_t>(ReadFixed<uint64_t>(columnDefinition.Offset));
+		case Exh::PackedBool0:
+		case Exh::PackedBool1:
+		case Exh::PackedBool2:
+		case Exh::PackedBool3:
+		case Exh::PackedBool4:
+		case Exh::PackedBool5:
+		case Exh::PackedBool6:
+		case Exh::PackedBool7:
+			return Bool(index) ? 1 : 0;
+		default:
+			throw std::invalid_argument(std::format("Column {} is not an integer column", index));
+	}
+}
+
+float Sqex::Excel::ExdReader::RowView::Float32(size_t index) const {
+	const auto& columnDefinition = (*m_columns)[index];
+	if (columnDefinition.Type != Exh::Float32)
+		throw std::invalid_argument(std::format("Column {} is not a float column", index));
+	return ReadFixed<float>(columnDefinition.Offset);
+}
+
+std::string_view Sqex::Excel::ExdReader::RowView::EscapedString(size_t index) const {
+	const auto& columnDefinition = (*m_columns)[index];
+	if (columnDefinition.Type != Exh::String)
+		throw std::invalid_argument(std::format("Column {} is not a string column", index));
 
+	const auto stringOffset = ReadFixed<uint32_t>(columnDefinition.Offset);
+	if (stringOffset > m_stringData.size())
+		throw CorruptDataException("String offset out of range");
+
+	const auto remaining = m_stringData.subspan(stringOffset);
+	return { remaining.data(), static_cast<size_t>(std::ranges::find(remaining, '\0') - remaining.begin()) };
+}
+
+uint64_t Sqex::Excel::ExdReader::RowView::Raw(size_t index) const {
+	const auto& columnDefinition = (*m_columns)[index];
+	switch (columnDefinition.Type) {
+		case Exh::Bool:
+		case Exh::Int8:
+		case Exh::UInt8:
+			return ReadFixed<uint8_t>(columnDefinition.Offset);
+		case Exh::Int16:
+		case Exh::UInt16:
+			return ReadFixed<uint16_t>(columnDefinition.Offset);
+		case Exh::Int32:
+		case Exh::UInt32:
+		case Exh::Float32:
+			return ReadFixed<uint32_t>(columnDefinition.Offset);
+		case Exh::Int64:
+		case Exh::UInt64:
+			return ReadFixed<uint64_t>(columnDefinition.Offset);
+		case Exh::PackedBool0:
+		case Exh::PackedBool1:
+		case Exh::PackedBool2:
+		case Exh::PackedBool3:
+		case Exh::PackedBool4:
+		case Exh::PackedBool5:
+		case Exh::PackedBool6:
+		case Exh::PackedBool7:
+			return Bool(index) ? 1 : 0;
+		default:
+			throw std::invalid_argument(std::format("Column {} is not a fixed size column", index));
+	}
+}
+
+Sqex::Excel::ExdCell Sqex::Excel::ExdReader::RowView::Column(size_t index, ExdStringArena& strings) const {
+	const auto& columnDefinition = (*m_columns)[index];
+	if (columnDefinition.Type == Exh::String)
+		return strings.Add(EscapedString(index));
+
+	ExdCell column{ .Type = columnDefinition.Type };
+	switch (column.Type) {
 		case Exh::Bool:
 		case Exh::Int8:
 		case Exh::UInt8:
@@ -163,63 +296,135 @@ Sqex::Excel::ExdColumn Sqex::Excel::ExdReader::TranslateColumn(const Exh::Column
 		case Exh::PackedBool5:
 		case Exh::PackedBool6:
 		case Exh::PackedBool7:
-			column.boolean = fixedData[columnDefinition.Offset] & (1 << (static_cast<int>(column.Type) - static_cast<int>(Exh::PackedBool0)));
+			column.boolean = Bool(index);
 			break;
 
 		default:
 			throw CorruptDataException(std::format("Invald column type {}", static_cast<uint32_t>(column.Type)));
 	}
 	if (column.ValidSize) {
-		std::copy_n(&fixedData[columnDefinition.Offset], column.ValidSize, &column.Buffer[0]);
+		if (columnDefinition.Offset + column.ValidSize > m_fixedData.size())
+			throw CorruptDataException("Column offset out of range");
+		std::copy_n(&m_fixedData[columnDefinition.Offset], column.ValidSize, &column.Buffer[0]);
 		std::reverse(&column.Buffer[0], &column.Buffer[column.ValidSize]);
 	}
 	return column;
 }
 
-std::pair<Sqex::Excel::Exd::RowHeader, std::vector<char>> Sqex::Excel::ExdReader::ReadRowRaw(uint32_t index) const {
+std::vector<Sqex::Excel::ExdCell> Sqex::Excel::ExdReader::RowView::Columns(ExdStringArena& strings) const {
+	std::vector<ExdCell> result;
+	result.reserve(Size());
+	for (size_t i = 0, i_ = Size(); i < i_; ++i)
+		result.emplace_back(Column(i, strings));
+	return result;
+}
+
+Sqex::Excel::ExdColumn Sqex::Excel::ExdReader::RowView::Column(size_t index) const {
+	ExdStringArena strings;
+	return ToExdColumn(Column(index, strings), strings);
+}
+
+std::vector<Sqex::Excel::ExdColumn> Sqex::Excel::ExdReader::RowView::Columns() const {
+	ExdStringArena strings;
+	return ToExdColumns(Columns(strings), strings);
+}
+
+std::pair<Sqex::Excel::Exd::RowHeader, std::span<const char>> Sqex::Excel::ExdReader::ReadRowRawAt(uint32_t offset) const {
+	if (offset + sizeof(Exd::RowHeader) > m_data.size())
+		throw CorruptDataException("Row offset out of range");
+
+	Exd::RowHeader rowHeader;
+	std::copy_n(&m_data[offset], sizeof rowHeader, reinterpret_cast<char*>(&rowHeader));
+	if (offset + sizeof rowHeader + rowHeader.DataSize > m_data.size())
+		throw CorruptDataException("Row data out of range");
+
+	return std::make_pair(rowHeader, std::span(m_data).subspan(offset + sizeof rowHeader, rowHeader.DataSize));
+}
+
+uint32_t Sqex::Excel::ExdReader::FindRowOffset(uint32_t index) const {
+	if (!m_directRowOffsets.empty()) {
+		if (index < m_firstRowId || index - m_firstRowId >= m_directRowOffsets.size())
+			return 0;
+		return m_directRowOffsets[index - m_firstRowId];
+	}
+
 	const auto it = std::ranges::lower_bound(m_rowLocators, std::make_pair(index, 0U), [](const auto& l, const auto& r) {
 		return l.first < r.first;
 	});
 	if (it == m_rowLocators.end() || it->first != index)
+		return 0;
+	return it->second;
+}
+
+std::pair<Sqex::Excel::Exd::RowHeader, std::span<const char>> Sqex::Excel::ExdReader::ReadRowRaw(uint32_t index) const {
+	const auto offset = FindRowOffset(index);
+	if (!offset)
 		throw std::out_of_range("index out of range");
 
-	const auto rowHeader = m_stream->ReadStream<Exd::RowHeader>(it->second);
-	return std::make_pair(rowHeader, m_stream->ReadStreamIntoVector<char>(it->second + sizeof rowHeader, rowHeader.DataSize));
+	return ReadRowRawAt(offset);
 }
 
-std::vector<Sqex::Excel::ExdColumn> Sqex::Excel::ExdReader::ReadDepth2(uint32_t index) const {
+Sqex::Excel::ExdReader::RowView Sqex::Excel::ExdReader::Depth2RowAt(uint32_t offset) const {
+	const auto [rowHeader, buffer] = ReadRowRawAt(offset);
+	if (rowHeader.SubRowCount != 1)
+		throw CorruptDataException("SubRowCount > 1 on 2nd depth sheet");
+	if (buffer.size() < m_fixedDataSize)
+		throw CorruptDataException("Row data too short");
+
+	return { *ColumnDefinitions, buffer.subspan(0, m_fixedDataSize), buffer.subspan(m_fixedDataSize) };
+}
+
+Sqex::Excel::ExdReader::RowView Sqex::Excel::ExdReader::ReadDepth2View(uint32_t index) const {
 	if (m_depth != Exh::Level2)
 		throw std::invalid_argument("Not a 2nd depth sheet");
 
-	std::vector<ExdColumn> result;
-	const auto [rowHeader, buffer] = ReadRowRaw(index);
-	const auto fixedData = std::span(buffer).subspan(0, m_fixedDataSize);
+	const auto offset = FindRowOffset(index);
+	if (!offset)
+		throw std::out_of_range("index out of range");
 
-	if (rowHeader.SubRowCount != 1)
-		throw CorruptDataException("SubRowCount > 1 on 2nd depth sheet");
+	return Depth2RowAt(offset);
+}
 
-	for (const auto& columnDefinition : *ColumnDefinitions)
-		result.emplace_back(TranslateColumn(columnDefinition, fixedData, std::span(buffer)));
+size_t Sqex::Excel::ExdReader::ReadDepth3SubRowCount(uint32_t index) const {
+	if (m_depth != Exh::Level3)
+		throw std::invalid_argument("Not a 3rd depth sheet");
 
-	return result;
+	return ReadRowRaw(index).first.SubRowCount;
 }
 
-std::vector<std::vector<Sqex::Excel::ExdColumn>> Sqex::Excel::ExdReader::ReadDepth3(uint32_t index) const {
+Sqex::Excel::ExdReader::RowView Sqex::Excel::ExdReader::ReadDepth3View(uint32_t index, size_t subRowIndex) const {
 	if (m_depth != Exh::Level3)
 		throw std::invalid_argument("Not a 3rd depth sheet");
 
-	std::vector<std::vector<ExdColumn>> result;
 	const auto [rowHeader, buffer] = ReadRowRaw(index);
+	if (subRowIndex >= rowHeader.SubRowCount)
+		throw std::out_of_range("subrow index out of range");
 
-	for (size_t i = 0, i_ = rowHeader.SubRowCount; i < i_; ++i) {
-		const auto baseOffset = i * (2 + m_fixedDataSize);
-		const auto fixedData = std::span(buffer).subspan(2 + baseOffset, m_fixedDataSize);
+	const auto baseOffset = subRowIndex * (2 + m_fixedDataSize);
+	if (buffer.size() < 2 + baseOffset + m_fixedDataSize)
+		throw CorruptDataException("Row data too short");
+	return { *ColumnDefinitions, buffer.subspan(2 + baseOffset, m_fixedDataSize), buffer.subspan(m_fixedDataSize) };
+}
 
-		std::vector<ExdColumn> row;
-		for (const auto& columnDefinition : *ColumnDefinitions)
-			row.emplace_back(TranslateColumn(columnDefinition, fixedData, std::span(buffer)));
-		result.emplace_back(std::move(row));
-	}
+std::vector<Sqex::Excel::ExdCell> Sqex::Excel::ExdReader::ReadDepth2(uint32_t index, ExdStringArena& strings) const {
+	return ReadDepth2View(index).Columns(strings);
+}
+
+std::vector<Sqex::Excel::ExdColumn> Sqex::Excel::ExdReader::ReadDepth2(uint32_t index) const {
+	return ReadDepth2View(index).Columns();
+}
+
+std::vector<std::vector<Sqex::Excel::ExdCell>> Sqex::Excel::ExdReader::ReadDepth3(uint32_t index, ExdStringArena& strings) const {
+	std::vector<std::vector<ExdCell>> result;
+	for (size_t i = 0, i_ = ReadDepth3SubRowCount(index); i < i_; ++i)
+		result.emplace_back(ReadDepth3View(index, i).Columns(strings));
+	return result;
+}
+
+std::vector<std::vector<Sqex::Excel::ExdColumn>> Sqex::Excel::ExdReader::ReadDepth3(uint32_t index) const {
+	std::vector<std::vector<ExdColumn>> result;
+	for (size_t i = 0, i_ = ReadDepth3SubRowCount(index); i < i_; ++i)
+		result.emplace_back(ReadDepth3View(index, i).Columns());
 	return result;
 }
 
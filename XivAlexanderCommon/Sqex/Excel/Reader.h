@@ -59,22 +59,78 @@ namespace Sqex::Excel {
 		const std::shared_ptr<const RandomAccessStream> m_stream;
 		const size_t m_fixedDataSize;
 		const Exh::Depth m_depth;
+		const std::vector<char> m_data;  // Whole page, read once on construction
 		std::vector<std::pair<uint32_t, uint32_t>> m_rowLocators;
 
+		// If row ids are dense enough, offset of row (m_firstRowId + i) at [i], or 0 if there is no such row.
+		// Left empty for sparse pages, which are looked up from m_rowLocators instead.
+		uint32_t m_firstRowId = 0;
+		std::vector<uint32_t> m_directRowOffsets;
+
 	public:
 		const Exd::Header Header;
 		const std::shared_ptr<std::vector<Exh::Column>> ColumnDefinitions;
 
 		ExdReader(const ExhReader& exh, std::shared_ptr<const RandomAccessStream> stream, bool strict = false);
 
-	private:
-		[[nodiscard]] ExdColumn TranslateColumn(const Exh::Column& columnDefinition, std::span<const char> fixedData, std::span<const char> fullData) const;
+		// Non-owning view of a row inside the page buffer; columns are decoded only when accessed.
+		// Valid as long as the ExdReader it came from is alive.
+		class RowView {
+			const std::vector<Exh::Column>* m_columns = nullptr;
+			std::span<const char> m_fixedData;
+			std::span<const char> m_stringData;
+
+		public:
+			RowView() = default;
+			RowView(const std::vector<Exh::Column>& columns, std::span<const char> fixedData, std::span<const char> stringData);
+
+			[[nodiscard]] size_t Size() const { return m_columns ? m_columns->size() : 0; }
+			[[nodiscard]] Exh::ColumnDataType Type(size_t index) const { return (*m_columns)[index].Type; }
+
+			[[nodiscard]] bool Bool(size_t index) const;
+			[[nodiscard]] int64_t Int64(size_t index) const;  // Any integer or bool column, sign- or zero-extended
+			[[nodiscard]] uint64_t UInt64(size_t index) const { return static_cast<uint64_t>(Int64(index)); }
+			[[nodiscard]] float Float32(size_t index) const;
+			[[nodiscard]] std::string_view EscapedString(size_t index) const;
+			[[nodiscard]] uint64_t Raw(size_t index) const;  // Bits of any non-string column, zero-extended
+
+			// String cells are appended to strings.
+			[[nodiscard]] ExdCell Column(size_t index, ExdStringArena& strings) const;
+			[[nodiscard]] std::vector<ExdCell> Columns(ExdStringArena& strings) const;
 
-		[[nodiscard]] std::pair<Exd::RowHeader, std::vector<char>> ReadRowRaw(uint32_t index) const;
+			[[nodiscard]] ExdColumn Column(size_t index) const;
+			[[nodiscard]] std::vector<ExdColumn> Columns() const;
+
+		private:
+			template<typename T>
+			[[nodiscard]] T ReadFixed(size_t offset) const;
+		};
+
+	private:
+		[[nodiscard]] uint32_t FindRowOffset(uint32_t index) const;  // 0 if there is no such row
+		[[nodiscard]] std::pair<Exd::RowHeader, std::span<const char>> ReadRowRawAt(uint32_t offset) const;
+		[[nodiscard]] std::pair<Exd::RowHeader, std::span<const char>> ReadRowRaw(uint32_t index) const;
+		[[nodiscard]] RowView Depth2RowAt(uint32_t offset) const;
 
 	public:
+		[[nodiscard]] bool HasRow(uint32_t index) const { return FindRowOffset(index) != 0; }
+		[[nodiscard]] RowView ReadDepth2View(uint32_t index) const;
+		[[nodiscard]] size_t ReadDepth3SubRowCount(uint32_t index) const;
+		[[nodiscard]] RowView ReadDepth3View(uint32_t index, size_t subRowIndex) const;
+
+		// Range of (row id, RowView) pairs in ascending order of row ids.
+		[[nodiscard]] auto Depth2Rows() const {
+			if (m_depth != Exh::Level2)
+				throw std::invalid_argument("Not a 2nd depth sheet");
+			return m_rowLocators | std::views::transform([this](const auto& locator) {
+				return std::make_pair(locator.first, Depth2RowAt(locator.second));
+			});
+		}
+
+		[[nodiscard]] std::vector<ExdCell> ReadDepth2(uint32_t index, ExdStringArena& strings) const;
 		[[nodiscard]] std::vector<ExdColumn> ReadDepth2(uint32_t index) const;
 
+		[[nodiscard]] std::vector<std::vector<ExdCell>> ReadDepth3(uint32_t index, ExdStringArena& strings) const;
 		[[nodiscard]] std::vector<std::vector<ExdColumn>> ReadDepth3(uint32_t index) const;
 
 		[[nodiscard]] std::vector<uint32_t> GetIds() const;
@@ -0,0 +1,190 @@
+#include "pch.h"
+#include "AnimationLockTracker.h"
+
+Sqex::Network::AnimationLockTracker::AnimationLockTracker(std::function<void(const PendingAction&)> onPendingActionIgnored)
+	: m_onPendingActionIgnored(std::move(onPendingActionIgnored)) {
+}
+
+void Sqex::Network::AnimationLockTracker::OnActionRequest(uint32_t actionId, uint32_t sequence, int64_t nowUs) {
+	m_pendingActions.emplace_back(PendingAction{
+		.ActionId = actionId,
+		.Sequence = sequence,
+		.RequestUs = nowUs,
+	});
+
+	// If there was no action queued to begin with before the current one, update the base lock time to now.
+	if (m_pendingActions.size() == 1 && (!m_pendingActions.back().RequestUs || (!m_lastAnimationLockEndsAtUs || *m_lastAnimationLockEndsAtUs < m_pendingActions.back().RequestUs)))
+		m_lastAnimationLockEndsAtUs = m_pendingActions.back().RequestUs;
+}
+
+void Sqex::Network::AnimationLockTracker::OnOriginalWaitTime(uint16_t sourceSequence, int64_t originalWaitUs) {
+	m_originalWaitUsMap[sourceSequence] = originalWaitUs;
+}
+
+Sqex::Network::AnimationLockTracker::ActionEffectResult Sqex::Network::AnimationLockTracker::OnActionEffect(
+	uint32_t actionId, uint16_t sourceSequence, int64_t animationLockDurationUs, int64_t nowUs,
+	const Options& options, const std::function<LatencyInfo(int64_t rttUs)>& measureLatency, std::ostream& description) {
+
+	int64_t originalWaitUs, waitUs;
+	if (const auto it = m_originalWaitUsMap.find(sourceSequence); it == m_originalWaitUsMap.end())
+		waitUs = originalWaitUs = animationLockDurationUs;
+	else {
+		waitUs = originalWaitUs = it->second;
+		m_originalWaitUsMap.erase(it);
+	}
+
+	if (sourceSequence == 0) {
+		// Process actions originating from server.
+		if (m_latestSuccessfulRequest && !m_latestSuccessfulRequest->CastTimeUs && m_latestSuccessfulRequest->Sequence) {
+			m_latestSuccessfulRequest->ActionId = actionId;
+			m_latestSuccessfulRequest->Sequence = 0;
+			*m_lastAnimationLockEndsAtUs += (originalWaitUs + nowUs) - (m_latestSuccessfulRequest->OriginalWaitUs + m_latestSuccessfulRequest->ResponseUs);
+			m_lastAnimationLockEndsAtUs = std::min(nowUs + AutoAttackDelayUs + originalWaitUs, std::max(nowUs + AutoAttackDelayUs, *m_lastAnimationLockEndsAtUs));
+
+		} else {
+			m_lastAnimationLockEndsAtUs = nowUs + waitUs;
+		}
+		description << " serverOriginated";
+
+	} else {
+		// find the one sharing Sequence, assuming action responses are always in order
+		DropPendingActionsUntil([sourceSequence](const auto& item) { return item.Sequence == sourceSequence; });
+
+		if (!m_pendingActions.empty()) {
+			m_latestSuccessfulRequest = m_pendingActions.front();
+			m_latestSuccessfulRequest->ResponseUs = nowUs;
+			m_latestSuccessfulRequest->OriginalWaitUs = originalWaitUs;
+
+			// 100ms animation lock after cast ends stays. Modify animation lock duration for instant actions only.
+			// Since no other action is in progress right before the cast ends, we can safely replace the animation lock with the latest after-cast lock.
+			if (!m_latestSuccessfulRequest->CastTimeUs) {
+				const auto rttUs = static_cast<int64_t>(nowUs - m_latestSuccessfulRequest->RequestUs);
+				const auto latency = measureLatency(rttUs);
+				description << std::format(" rtt={}us", rttUs);
+				m_lastAnimationLockEndsAtUs = ResolveNextAnimationLockEndUs(nowUs, originalWaitUs, rttUs, options, latency, description);
+
+			} else {
+				m_lastAnimationLockEndsAtUs = m_latestSuccessfulRequest->RequestUs + m_latestSuccessfulRequest->CastTimeUs + waitUs;
+			}
+			m_pendingActions.pop_front();
+
+		} else {
+			m_lastAnimationLockEndsAtUs = nowUs + waitUs;
+		}
+	}
+
+	auto result = ActionEffectResult{ .OriginalWaitUs = originalWaitUs, .WaitUs = originalWaitUs, .Rewrite = false };
+	waitUs = *m_lastAnimationLockEndsAtUs - nowUs;
+	if (waitUs == originalWaitUs || (m_latestSuccessfulRequest && m_latestSuccessfulRequest->CastTimeUs)) {
+		description << std::format(" wait={}us", originalWaitUs);
+	} else if (waitUs < 0) {
+		const auto invalidWaitUs = waitUs;
+		waitUs = 0;
+		description << std::format(" wait={}us->{}us->{}us (ping/jitter too high)", originalWaitUs, invalidWaitUs, waitUs);
+
+		if (!options.PreviewMode) {
+			result.Rewrite = true;
+			if (m_latestSuccessfulRequest)
+				m_latestSuccessfulRequest->WaitTimeUs = -m_latestSuccessfulRequest->OriginalWaitUs;
+		}
+
+	} else if (waitUs < originalWaitUs) {
+		description << std::format(" wait={}us->{}us", originalWaitUs, waitUs);
+
+		if (!options.PreviewMode) {
+			result.Rewrite = true;
+			if (m_latestSuccessfulRequest)
+				m_latestSuccessfulRequest->WaitTimeUs = waitUs - originalWaitUs;
+		}
+	}
+	result.WaitUs = waitUs;
+	return result;
+}
+
+void Sqex::Network::AnimationLockTracker::OnActionRejected(uint32_t actionId, uint16_t sourceSequence) {
+	// find the one sharing Sequence, assuming action responses are always in order
+	DropPendingActionsUntil([actionId, sourceSequence](const auto& item) {
+		// Sometimes SourceSequence is empty, in which case, we use ActionId to judge.
+		return sourceSequence != 0 ? item.Sequence == sourceSequence : item.ActionId == actionId;
+	});
+
+	if (!m_pendingActions.empty())
+		m_pendingActions.pop_front();
+}
+
+void Sqex::Network::AnimationLockTracker::OnCancelCast(uint32_t actionId) {
+	// find the one sharing Sequence, assuming action responses are always in order
+	DropPendingActionsUntil([actionId](const auto& item) { return item.ActionId == actionId; });
+
+	if (!m_pendingActions.empty())
+		m_pendingActions.pop_front();
+}
+
+void Sqex::Network::AnimationLockTracker::OnCast(int64_t castTimeUs) {
+	// Mark that the last request was a cast.
+	// If it indeed is a cast, the game UI will block the user from generating additional requests,
+	// so first item is guaranteed to be the cast action.
+	if (!m_pendingActions.empty())
+		m_pendingActions.front().CastTimeUs = castTimeUs;
+}
+
+void Sqex::Network::AnimationLockTracker::DropPendingActionsUntil(const std::function<bool(const PendingAction&)>& isTarget) {
+	while (!m_pendingActions.empty() && !isTarget(m_pendingActions.front())) {
+		if (m_onPendingActionIgnored)
+			m_onPendingActionIgnored(m_pendingActions.front());
+		m_pendingActions.pop_front();
+	}
+}
+
+int64_t Sqex::Network::AnimationLockTracker::ResolveNextAnimationLockEndUs(int64_t nowUs, int64_t originalWaitUs, int64_t rttUs,
+	const Options& options, const LatencyInfo& latency, std::ostream& description) {
+	description << std::format(" mode={}", static_cast<int>(options.Mode) + 1);
+
+	auto latencyUs = latency.LatencyUs;
+
+	// Estimated latency for use as fallback.
+	const auto latencyEstimateUs = ((latency.RttMinUs + latency.RttMeanUs) / 2) - ((latency.RttDeviationUs + 25000) / 2);
+
+	// Replace latency with estimated latency under certain circumstances:
+	// - Failed to obtain measurement
+	// - Server RTT measurement is faster than actual latency
+	if (latencyUs == INT64_MAX || rttUs < latencyUs) {
+		latencyUs = latencyEstimateUs;
+		description << std::format(" latency={}us*", latencyUs);
+	} else {
+		description << std::format(" latency={}us", latencyUs);
+	}
+
+	auto delay = 0LL;
+
+	switch (options.Mode) {
+		case MitigationMode::SubtractLatency:
+			delay = (rttUs - latencyUs);
+			break;
+
+		case MitigationMode::SimulateRtt:
+			delay = options.ExpectedAnimationLockDurationUs;
+			break;
+
+		case MitigationMode::SimulateNormalizedRttAndLatency: {
+			// Server-side focused mode. Attempts to guess the server delay from response time statistics.
+			// Handles fake-ping VPN usage by using estimated latency when necessary.
+			auto bestLatencyUs = std::max(latencyUs, latencyEstimateUs);
+
+			if (bestLatencyUs != latencyUs) {
+				description << std::format("->{}us", bestLatencyUs);
+			}
+
+			// Estimate server delay, using modulus to handle high ping rtt multipliers.
+			delay = bestLatencyUs > 0 ? ((rttUs % bestLatencyUs) + (rttUs - bestLatencyUs)) / 2 : rttUs;
+			break;
+		}
+	}
+
+	// Disallow negative delay values.
+	delay = std::max(delay, 0LL);
+
+	// Return the new animation lock time without server response time delay, but with artificial delay (safety/lag) value.
+	description << std::format(" delay={}us", delay);
+	return nowUs + (originalWaitUs - rttUs) + delay;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+#include <ostream>
+
+namespace Sqex::Network {
+	/*
+	 * Keeps track of action requests and responses of one game connection, and decides how long the animation lock
+	 * after each action should be, so that the next action can be used as if the server has responded with no latency.
+	 * All timestamps are given by the caller, so this can also be driven from recorded or synthetic traffic.
+	 */
+	class AnimationLockTracker {
+	public:
+		static constexpr int64_t AutoAttackDelayUs = 100000;
+
+		enum class MitigationMode {
+			SubtractLatency,
+			SimulateRtt,
+			SimulateNormalizedRttAndLatency,
+		};
+
+		struct Options {
+			MitigationMode Mode = MitigationMode::SimulateNormalizedRttAndLatency;
+			int64_t ExpectedAnimationLockDurationUs = 75000;
+			bool PreviewMode = false;
+		};
+
+		struct LatencyInfo {
+			int64_t LatencyUs = INT64_MAX;  // Measured network latency, or INT64_MAX if not available
+			int64_t RttMinUs = 0;
+			int64_t RttMeanUs = 0;
+			int64_t RttDeviationUs = 0;
+		};
+
+		struct PendingAction {
+			uint32_t ActionId{};
+			uint32_t Sequence{};
+			int64_t RequestUs{};
+			int64_t ResponseUs{};
+			int64_t OriginalWaitUs{};
+			int64_t WaitTimeUs{};
+			int64_t CastTimeUs{};
+		};
+
+		struct ActionEffectResult {
+			int64_t OriginalWaitUs;
+			int64_t WaitUs;
+			bool Rewrite;  // If true, animation lock duration should be replaced with WaitUs
+		};
+
+	private:
+		// The game will allow the user to use an action, if server does not respond in 500ms since last action usage.
+		// This will result in cancellation of following actions, so to prevent this, we keep track of outgoing action
+		// request timestamps, and stack up required animation lock time responses from server.
+		// The game will only process the latest animation lock duration information.
+		std::deque<PendingAction> m_pendingActions;
+		std::optional<PendingAction> m_latestSuccessfulRequest;
+		std::optional<int64_t> m_lastAnimationLockEndsAtUs;
+		std::map<int, int64_t> m_originalWaitUsMap;
+
+		const std::function<void(const PendingAction&)> m_onPendingActionIgnored;
+
+	public:
+		AnimationLockTracker(std::function<void(const PendingAction&)> onPendingActionIgnored = {});
+
+		void OnActionRequest(uint32_t actionId, uint32_t sequence, int64_t nowUs);
+		void OnOriginalWaitTime(uint16_t sourceSequence, int64_t originalWaitUs);
+
+		/// \param measureLatency Called with the round trip time of the action, if the action has been requested
+		/// from this connection and is not a cast. Should record the value and return current latency statistics.
+		ActionEffectResult OnActionEffect(uint32_t actionId, uint16_t sourceSequence, int64_t animationLockDurationUs, int64_t nowUs,
+			const Options& options, const std::function<LatencyInfo(int64_t rttUs)>& measureLatency, std::ostream& description);
+
+		void OnActionRejected(uint32_t actionId, uint16_t sourceSequence);
+		void OnCancelCast(uint32_t actionId);
+		void OnCast(int64_t castTimeUs);
+
+		[[nodiscard]] const std::deque<PendingAction>& PendingActions() const { return m_pendingActions; }
+		[[nodiscard]] const std::optional<PendingAction>& LatestSuccessfulRequest() const { return m_latestSuccessfulRequest; }
+		[[nodiscard]] const std::optional<int64_t>& LastAnimationLockEndsAtUs() const { return m_lastAnimationLockEndsAtUs; }
+
+	private:
+		void DropPendingActionsUntil(const std::function<bool(const PendingAction&)>& isTarget);
+
+		static int64_t ResolveNextAnimationLockEndUs(int64_t nowUs, int64_t originalWaitUs, int64_t rttUs,
+			const Options& options, const LatencyInfo& latency, std::ostream& description);
+	};
+}
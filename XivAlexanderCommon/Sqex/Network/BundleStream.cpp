@@ -0,0 +1,205 @@
+#include "pch.h"
+#include "BundleStream.h"
+
+using namespace Sqex::Network::Structure;
+
+Sqex::Network::BundleStream::BundleStream(std::string name, const Utils::OodleNetworkFunctions& oodle, WarningCallback warn)
+	: m_name(std::move(name))
+	, m_warn(std::move(warn))
+	, m_oodler(oodle)
+	, m_unoodler(oodle) {
+}
+
+void Sqex::Network::BundleStream::Reserve(size_t freeSpace) {
+	if (m_buffer.size() - m_size >= freeSpace)
+		return;
+
+	auto capacity = std::max(MinimumCapacity, m_buffer.size());
+	while (capacity - m_size < freeSpace)
+		capacity <<= 1;
+
+	std::vector<uint8_t> buffer(capacity);
+	CopyOut(buffer.data(), m_size);
+	m_buffer = std::move(buffer);
+	m_head = 0;
+}
+
+void Sqex::Network::BundleStream::Commit(size_t length) {
+	m_size += length;
+	m_peakSize = std::max(m_peakSize, m_size);
+}
+
+void Sqex::Network::BundleStream::CopyOut(void* buf, size_t length) const {
+	if (!length)
+		return;
+
+	const auto first = std::min(length, m_buffer.size() - m_head);
+	memcpy(buf, m_buffer.data() + m_head, first);
+	memcpy(static_cast<uint8_t*>(buf) + first, m_buffer.data(), length - first);
+}
+
+void Sqex::Network::BundleStream::ConsumeBytes(size_t length) {
+	if (length > m_size) {
+		length = m_size;
+		if (m_warn)
+			m_warn(std::format("{}: overconsuming", m_name));
+	}
+
+	m_head = (m_head + length) & (m_buffer.size() - 1);
+	m_size -= length;
+	m_magicScanner.Consume(length);
+	if (!m_size) {
+		m_head = 0;
+
+		// Give back memory grown for a burst of data.
+		if (m_buffer.size() > RetainedCapacity) {
+			m_buffer = std::vector<uint8_t>();
+			m_wrapped = std::vector<uint8_t>();
+		}
+	}
+}
+
+void Sqex::Network::BundleStream::Write(const void* buf, size_t length) {
+	if (!length)
+		return;
+
+	Reserve(length);
+	const auto uint8buf = static_cast<const uint8_t*>(buf);
+	const auto tail = Tail();
+	const auto first = std::min(length, m_buffer.size() - tail);
+	memcpy(m_buffer.data() + tail, uint8buf, first);
+	memcpy(m_buffer.data(), uint8buf + first, length - first);
+	Commit(length);
+}
+
+std::span<const uint8_t> Sqex::Network::BundleStream::PeekContiguous(size_t length) {
+	length = std::min(length, m_size);
+	if (m_head + length <= m_buffer.size())
+		return { m_buffer.data() + m_head, length };
+
+	m_wrapped.resize(length);
+	CopyOut(m_wrapped.data(), length);
+	return { m_wrapped };
+}
+
+void Sqex::Network::BundleStream::TunnelXivStream(BundleStream& target, const MessageMangler& messageMangler) {
+	while (m_size) {
+		auto buf = Peek();
+		if (buf.size_bytes() < sizeof(XivBundleHeader))
+			buf = PeekContiguous(sizeof(XivBundleHeader));
+
+		if (const auto trashLength = m_magicScanner.Find(buf)) {
+			target.Write(buf.data(), trashLength);
+			Consume(trashLength);
+			continue;
+		}
+
+		// Incomplete header
+		if (buf.size_bytes() < sizeof(XivBundleHeader))
+			break;
+
+		const auto totalLength = reinterpret_cast<const XivBundle*>(buf.data())->TotalLength;
+
+		// Invalid TotalLength
+		if (totalLength == 0) {
+			target.Write(buf.subspan(0, 1));
+			Consume(1);
+			continue;
+		}
+
+		// Incomplete data
+		if (m_size < totalLength)
+			break;
+
+		if (buf.size_bytes() < totalLength)
+			buf = PeekContiguous(totalLength);
+		const auto* pGamePacket = reinterpret_cast<const XivBundle*>(buf.data());
+
+		try {
+			pGamePacket->GetMessages(m_inflater, m_unoodler, m_messages);
+			auto modified = false;
+			for (size_t i = 0; i < m_messages.Count(); ++i) {
+				if (!messageMangler(&m_messages[i], modified))
+					m_messages.Delete(i);
+			}
+
+			// Nothing changed; skip encoding again and forward the original bundle.
+			if (!modified && !m_messages.DeletedCount()) {
+				target.Write(pGamePacket, totalLength);
+				Consume(totalLength);
+				m_passedThroughBundleCount++;
+				continue;
+			}
+
+			const auto body = m_messages.Compact();
+			auto header = *pGamePacket;
+			header.TotalLength = static_cast<uint32_t>(sizeof(XivBundleHeader));
+			header.MessageCount = static_cast<uint16_t>(m_messages.RemainingCount());
+			header.CompressionType = pGamePacket->CompressionType;
+			header.DecodedBodyLength = static_cast<uint32_t>(body.size());
+
+			size_t encodeBound;
+			switch (header.CompressionType) {
+				case CompressionType::None:
+					encodeBound = body.size();
+					break;
+				case CompressionType::Deflate:
+					encodeBound = m_deflater.Bound(body.size());
+					break;
+				case CompressionType::Oodle:
+					encodeBound = Utils::Oodler::EncodeBound(body.size());
+					break;
+				default:
+					throw std::runtime_error("Unsupported compression method");
+			}
+
+			// Encode straight into target if there is enough contiguous space; otherwise, go through scratch buffers.
+			auto writer = target.Write();
+			if (const auto space = writer.Allocate<uint8_t>(sizeof(XivBundleHeader) + encodeBound); space.size() == sizeof(XivBundleHeader) + encodeBound) {
+				const auto encodeTarget = space.subspan(sizeof(XivBundleHeader));
+				std::span<uint8_t> encoded;
+				switch (header.CompressionType) {
+					case CompressionType::None:
+						std::ranges::copy(body, encodeTarget.begin());
+						encoded = encodeTarget.subspan(0, body.size());
+						break;
+					case CompressionType::Deflate:
+						encoded = m_deflater.Deflate(body, encodeTarget);
+						break;
+					case CompressionType::Oodle:
+						encoded = m_oodler.encode(body, encodeTarget);
+						break;
+				}
+
+				header.TotalLength += static_cast<uint32_t>(encoded.size());
+				memcpy(space.data(), &header, sizeof(XivBundleHeader));
+				writer.Write(header.TotalLength);
+
+			} else {
+				std::span<uint8_t> encoded;
+				switch (header.CompressionType) {
+					case CompressionType::None:
+						encoded = body;
+						break;
+					case CompressionType::Deflate:
+						encoded = m_deflater(body);
+						break;
+					case CompressionType::Oodle:
+						encoded = m_oodler.encode(body);
+						break;
+				}
+
+				header.TotalLength += static_cast<uint32_t>(encoded.size());
+				target.Write(&header, sizeof(XivBundleHeader));
+				target.Write(encoded);
+			}
+			m_reencodedBundleCount++;
+		} catch (const std::exception& e) {
+			if (m_warn)
+				m_warn(std::format("{}: Error: {}\n{}", m_name, e.what(), pGamePacket->Represent()));
+			target.Write(pGamePacket, totalLength);
+		}
+
+		Consume(totalLength);
+	}
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "XivAlexanderCommon/Sqex/Network/Structure.h"
+#include "XivAlexanderCommon/Utils/ZlibWrapper.h"
+
+namespace Sqex::Network {
+	/*
+	 * Buffered data of one direction of a game connection.
+	 * Data is kept in a ring buffer that grows only when more data is pending than it can hold.
+	 */
+	class BundleStream {
+	public:
+		// Return false to drop the message. Set modified to true if the message has been changed in place.
+		typedef std::function<bool(Structure::XivMessage*, bool& modified)> MessageMangler;
+		typedef std::function<void(const std::string&)> WarningCallback;
+
+	private:
+		const std::string m_name;
+		const WarningCallback m_warn;
+		Utils::ZlibReusableDeflater m_deflater;
+		Utils::ZlibReusableInflater m_inflater;
+		Utils::Oodler m_oodler, m_unoodler;
+		Structure::XivMessageList m_messages;
+		Structure::XivBundleMagicScanner m_magicScanner;
+
+		// Ring buffer; capacity is always zero or a power of two.
+		std::vector<uint8_t> m_buffer{};
+		size_t m_head = 0;
+		size_t m_size = 0;
+		size_t m_peakSize = 0;
+
+		// Contiguous copy of data that wraps around the end of m_buffer.
+		std::vector<uint8_t> m_wrapped{};
+
+		static constexpr size_t MinimumCapacity = 65536;
+		static constexpr size_t RetainedCapacity = 1048576;
+
+		uint64_t m_passedThroughBundleCount = 0;
+		uint64_t m_reencodedBundleCount = 0;
+
+		[[nodiscard]] size_t Tail() const {
+			return (m_head + m_size) & (m_buffer.size() - 1);
+		}
+
+		void Reserve(size_t freeSpace);
+		void Commit(size_t length);
+		void CopyOut(void* buf, size_t length) const;
+		void ConsumeBytes(size_t length);
+
+	public:
+		class Writer {
+			BundleStream& m_stream;
+
+		public:
+			Writer(BundleStream& stream)
+				: m_stream(stream) {
+			}
+
+			// Returns contiguous free space of up to length items, which may be shorter if it would wrap around.
+			template<typename T>
+			std::span<T> Allocate(size_t length) {
+				m_stream.Reserve(length * sizeof(T));
+				return AllocateAvailable<T>(length);
+			}
+
+			// Same as Allocate, but never grows the buffer; returns an empty span if the buffer is full.
+			template<typename T>
+			std::span<T> AllocateAvailable(size_t length) {
+				if (m_stream.m_buffer.empty())
+					return {};
+
+				const auto tail = m_stream.Tail();
+				const auto contiguous = m_stream.m_head + m_stream.m_size >= m_stream.m_buffer.size()
+					? m_stream.m_head - tail
+					: m_stream.m_buffer.size() - tail;
+				return { reinterpret_cast<T*>(m_stream.m_buffer.data() + tail), std::min(length, contiguous / sizeof(T)) };
+			}
+
+			size_t Write(size_t length) {
+				m_stream.Commit(length);
+				return length;
+			}
+		};
+
+		BundleStream(std::string name, const Utils::OodleNetworkFunctions& oodle, WarningCallback warn);
+
+		Writer Write() {
+			return { *this };
+		}
+
+		void Write(const void* buf, size_t length);
+
+		template<typename T, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
+		void Write(const T& data) {
+			Write(&data, sizeof data);
+		}
+
+		template<typename T = uint8_t, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
+		void Write(const std::span<T>& data) {
+			Write(data.data(), data.size_bytes());
+		}
+
+		// Returns data up to where it wraps around the end of the buffer.
+		template<typename T = uint8_t, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
+		[[nodiscard]] std::span<const T> Peek() const {
+			if (!m_size)
+				return {};
+			return {
+				reinterpret_cast<const T*>(m_buffer.data() + m_head),
+				std::min(m_size, m_buffer.size() - m_head) / sizeof(T)
+			};
+		}
+
+		// Returns first length bytes as a contiguous span, copying them only if they wrap around the end of the buffer.
+		[[nodiscard]] std::span<const uint8_t> PeekContiguous(size_t length);
+
+		template<typename T = uint8_t, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
+		void Consume(size_t count) {
+			ConsumeBytes(count * sizeof(T));
+		}
+
+		template<typename T, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
+		size_t Read(T* buf, size_t count) {
+			count = std::min(count, m_size / sizeof(T));
+			CopyOut(buf, count * sizeof(T));
+			Consume<T>(count);
+			return count;
+		}
+
+		template<typename T = uint8_t, typename = std::enable_if_t<std::is_standard_layout_v<T>>>
+		[[nodiscard]] size_t Available() const {
+			return m_size / sizeof(T);
+		}
+
+		[[nodiscard]] size_t PeakBufferedBytes() const {
+			return m_peakSize;
+		}
+
+		[[nodiscard]] uint64_t PassedThroughBundleCount() const {
+			return m_passedThroughBundleCount;
+		}
+
+		[[nodiscard]] uint64_t ReencodedBundleCount() const {
+			return m_reencodedBundleCount;
+		}
+
+		/// \brief Moves complete bundles into target, passing each message through messageMangler.
+		/// Data that is not a part of any bundle is moved as-is, and incomplete bundles are left in this stream.
+		void TunnelXivStream(BundleStream& target, const MessageMangler& messageMangler);
+	};
+}
@@ -0,0 +1,80 @@
+#include "pch.h"
+#include "Capture.h"
+
+Sqex::Network::Capture::Writer::Writer(const std::filesystem::path& path)
+	: m_stream(path, std::ios::binary | std::ios::trunc) {
+	if (!m_stream)
+		throw std::runtime_error(std::format("Failed to open {} for writing", path.string()));
+
+	FileHeader header{};
+	memcpy(header.Signature, FileHeader::SignatureValue, sizeof header.Signature);
+	header.Version = FileHeader::CurrentVersion;
+	m_stream.write(reinterpret_cast<const char*>(&header), sizeof header);
+	if (!m_stream)
+		throw std::runtime_error(std::format("Failed to write to {}", path.string()));
+}
+
+void Sqex::Network::Capture::Writer::Add(uint64_t timestampUs, uint32_t connectionId, Direction direction, std::span<const uint8_t> data) {
+	if (data.empty())
+		return;
+	if (data.size() >= ChunkHeader::DirectionBit)
+		throw std::invalid_argument("Chunk too big");
+
+	if (m_firstTimestampUs == UINT64_MAX)
+		m_firstTimestampUs = timestampUs;
+
+	const auto header = ChunkHeader{
+		.TimestampUs = timestampUs - std::min(timestampUs, m_firstTimestampUs),
+		.ConnectionId = connectionId,
+		.LengthAndDirection = static_cast<uint32_t>(data.size()) | (direction == Direction::Send ? ChunkHeader::DirectionBit : 0),
+	};
+	m_stream.write(reinterpret_cast<const char*>(&header), sizeof header);
+	m_stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	if (!m_stream)
+		throw std::runtime_error("Failed to write capture chunk");
+}
+
+void Sqex::Network::Capture::Writer::Flush() {
+	m_stream.flush();
+	if (!m_stream)
+		throw std::runtime_error("Failed to flush capture file");
+}
+
+Sqex::Network::Capture::Reader::Reader(const std::filesystem::path& path) {
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream)
+		throw std::runtime_error(std::format("Failed to open {}", path.string()));
+
+	m_data.resize(static_cast<size_t>(std::filesystem::file_size(path)));
+	stream.read(reinterpret_cast<char*>(m_data.data()), static_cast<std::streamsize>(m_data.size()));
+	if (static_cast<size_t>(stream.gcount()) != m_data.size())
+		throw std::runtime_error("Failed to read capture file");
+
+	if (m_data.size() < sizeof(FileHeader))
+		throw std::runtime_error("Not a capture file (too short)");
+	const auto& header = *reinterpret_cast<const FileHeader*>(m_data.data());
+	if (memcmp(header.Signature, FileHeader::SignatureValue, sizeof header.Signature) != 0)
+		throw std::runtime_error("Not a capture file (signature mismatch)");
+	if (header.Version != FileHeader::CurrentVersion)
+		throw std::runtime_error(std::format("Unsupported capture file version {}", header.Version));
+
+	for (size_t offset = sizeof(FileHeader); offset < m_data.size();) {
+		if (offset + sizeof(ChunkHeader) > m_data.size())
+			throw std::runtime_error("Capture file truncated (incomplete chunk header)");
+
+		// Chunk data are not padded, so headers may be misaligned.
+		ChunkHeader chunkHeader;
+		memcpy(&chunkHeader, &m_data[offset], sizeof chunkHeader);
+		offset += sizeof chunkHeader;
+		if (offset + chunkHeader.Length() > m_data.size())
+			throw std::runtime_error("Capture file truncated (incomplete chunk data)");
+
+		m_chunks.emplace_back(Chunk{
+			.TimestampUs = chunkHeader.TimestampUs,
+			.ConnectionId = chunkHeader.ConnectionId,
+			.Direction = chunkHeader.GetDirection(),
+			.Data = std::span(&m_data[offset], chunkHeader.Length()),
+		});
+		offset += chunkHeader.Length();
+	}
+}
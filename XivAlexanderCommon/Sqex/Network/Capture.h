@@ -0,0 +1,70 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <vector>
+
+namespace Sqex::Network::Capture {
+	/*
+	 * Capture file layout:
+	 * FileHeader, followed by ChunkHeader and Length bytes of data for every chunk, in the order they were observed.
+	 * Chunks are raw data as returned from recv or passed to send, before any processing.
+	 */
+
+	enum class Direction : uint8_t {
+		Recv = 0,
+		Send = 1,
+	};
+
+	struct FileHeader {
+		static constexpr char SignatureValue[8]{ 'X', 'A', 'N', 'E', 'T', 'C', 'A', 'P' };
+		static constexpr uint32_t CurrentVersion = 1;
+
+		char Signature[8];
+		uint32_t Version;
+		uint32_t Reserved;
+	};
+	static_assert(sizeof(FileHeader) == 16);
+
+	struct ChunkHeader {
+		uint64_t TimestampUs;  // Relative to the first chunk
+		uint32_t ConnectionId;
+		uint32_t LengthAndDirection;  // Bit 31 is set for Direction::Send
+
+		static constexpr uint32_t DirectionBit = 0x80000000U;
+
+		[[nodiscard]] uint32_t Length() const { return LengthAndDirection & ~DirectionBit; }
+		[[nodiscard]] Direction GetDirection() const { return LengthAndDirection & DirectionBit ? Direction::Send : Direction::Recv; }
+	};
+	static_assert(sizeof(ChunkHeader) == 16);
+
+	struct Chunk {
+		uint64_t TimestampUs;
+		uint32_t ConnectionId;
+		Capture::Direction Direction;
+		std::span<const uint8_t> Data;
+	};
+
+	class Writer {
+		std::ofstream m_stream;
+		uint64_t m_firstTimestampUs = UINT64_MAX;
+
+	public:
+		Writer(const std::filesystem::path& path);
+
+		/// \param timestampUs Any monotonic clock in microseconds; stored relative to the first chunk.
+		void Add(uint64_t timestampUs, uint32_t connectionId, Direction direction, std::span<const uint8_t> data);
+		void Flush();
+	};
+
+	class Reader {
+		std::vector<uint8_t> m_data;
+		std::vector<Chunk> m_chunks;
+
+	public:
+		Reader(const std::filesystem::path& path);
+
+		[[nodiscard]] const std::vector<Chunk>& Chunks() const { return m_chunks; }
+	};
+}
@@ -1,10 +1,15 @@
 #include "pch.h"
 #include "Structure.h"
 
-#include "Sqex.h"
-#include "Utils/Utils.h"
+#include <ctime>
+
 #include "Utils/ZlibWrapper.h"
 
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
 const uint8_t Sqex::Network::Structure::XivBundle::MagicConstant1[]{
 	0x52, 0x52, 0xa0, 0x41,
 	0xff, 0x5d, 0x46, 0xe2,
@@ -19,73 +24,231 @@ const uint8_t Sqex::Network::Structure::XivBundle::MagicConstant2[]{
 };
 
 std::span<const uint8_t> Sqex::Network::Structure::XivBundle::ExtractFrontTrash(const std::span<const uint8_t>& buf) {
-	const auto searchLength = std::min(sizeof Magic, buf.size());
-	return {
-		buf.begin(),
-		std::min(
-			std::search(buf.begin(), buf.end(), MagicConstant1, MagicConstant1 + searchLength),
-			std::search(buf.begin(), buf.end(), MagicConstant2, MagicConstant2 + searchLength)
-		)
-	};
+	return buf.subspan(0, XivBundleMagicScanner().Find(buf));
+}
+
+namespace {
+	using Sqex::Network::Structure::XivBundle;
+	constexpr auto MagicLength = sizeof(XivBundle::Magic);
+
+	bool IsMagicAt(const uint8_t* p) {
+		return !memcmp(p, XivBundle::MagicConstant1, MagicLength) || !memcmp(p, XivBundle::MagicConstant2, MagicLength);
+	}
+
+	// Candidates are filtered by the first and the last byte of each magic, and then compared in full.
+	// Each of the following returns the first position in [pos, end) that begins with a magic, or end if there is none.
+	// All MagicLength bytes from every position in the range must be readable.
+
+	size_t FindMagicScalar(const uint8_t* data, size_t pos, size_t end) {
+		for (; pos < end; ++pos) {
+			if (((data[pos] == XivBundle::MagicConstant1[0] && data[pos + MagicLength - 1] == XivBundle::MagicConstant1[MagicLength - 1])
+				|| (data[pos] == XivBundle::MagicConstant2[0] && data[pos + MagicLength - 1] == XivBundle::MagicConstant2[MagicLength - 1]))
+				&& IsMagicAt(data + pos))
+				return pos;
+		}
+		return end;
+	}
+
+#if defined(_M_X64) || defined(_M_IX86)
+	size_t LowestSetBit(uint32_t mask) {
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+	}
+
+	size_t FindMagicSse2(const uint8_t* data, size_t pos, size_t end) {
+		const auto first1 = _mm_set1_epi8(static_cast<char>(XivBundle::MagicConstant1[0]));
+		const auto last1 = _mm_set1_epi8(static_cast<char>(XivBundle::MagicConstant1[MagicLength - 1]));
+		const auto first2 = _mm_set1_epi8(static_cast<char>(XivBundle::MagicConstant2[0]));
+		const auto last2 = _mm_set1_epi8(static_cast<char>(XivBundle::MagicConstant2[MagicLength - 1]));
+
+		for (; pos + sizeof(__m128i) <= end; pos += sizeof(__m128i)) {
+			const auto head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+			const auto tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + MagicLength - 1));
+			auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(
+				_mm_and_si128(_mm_cmpeq_epi8(head, first1), _mm_cmpeq_epi8(tail, last1)),
+				_mm_and_si128(_mm_cmpeq_epi8(head, first2), _mm_cmpeq_epi8(tail, last2)))));
+			for (; mask; mask &= mask - 1) {
+				if (const auto candidate = pos + LowestSetBit(mask); IsMagicAt(data + candidate))
+					return candidate;
+			}
+		}
+		return FindMagicScalar(data, pos, end);
+	}
+
+	size_t FindMagicAvx2(const uint8_t* data, size_t pos, size_t end) {
+		const auto first1 = _mm256_set1_epi8(static_cast<char>(XivBundle::MagicConstant1[0]));
+		const auto last1 = _mm256_set1_epi8(static_cast<char>(XivBundle::MagicConstant1[MagicLength - 1]));
+		const auto first2 = _mm256_set1_epi8(static_cast<char>(XivBundle::MagicConstant2[0]));
+		const auto last2 = _mm256_set1_epi8(static_cast<char>(XivBundle::MagicConstant2[MagicLength - 1]));
+
+		for (; pos + sizeof(__m256i) <= end; pos += sizeof(__m256i)) {
+			const auto head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+			const auto tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + MagicLength - 1));
+			auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(
+				_mm256_and_si256(_mm256_cmpeq_epi8(head, first1), _mm256_cmpeq_epi8(tail, last1)),
+				_mm256_and_si256(_mm256_cmpeq_epi8(head, first2), _mm256_cmpeq_epi8(tail, last2)))));
+			for (; mask; mask &= mask - 1) {
+				if (const auto candidate = pos + LowestSetBit(mask); IsMagicAt(data + candidate))
+					return candidate;
+			}
+		}
+		return FindMagicSse2(data, pos, end);
+	}
+
+	bool IsAvx2Supported() {
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		__cpuid(info, 1);
+		constexpr auto OsXsave = 1 << 27, Avx = 1 << 28;
+		if ((info[2] & (OsXsave | Avx)) != (OsXsave | Avx))
+			return false;
+
+		// Check that the OS saves YMM registers
+		if ((_xgetbv(0) & 6) != 6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		constexpr auto Avx2 = 1 << 5;
+		return info[1] & Avx2;
+	}
+#endif
+
+	size_t FindMagic(const uint8_t* data, size_t pos, size_t end) {
+#if defined(_M_X64) || defined(_M_IX86)
+		static const auto s_avx2 = IsAvx2Supported();
+		return s_avx2 ? FindMagicAvx2(data, pos, end) : FindMagicSse2(data, pos, end);
+#else
+		return FindMagicScalar(data, pos, end);
+#endif
+	}
+
+	tm EpochToLocalTime(int64_t epochSeconds) {
+		const auto t = static_cast<time_t>(epochSeconds);
+		tm local{};
+#ifdef _WIN32
+		localtime_s(&local, &t);
+#else
+		localtime_r(&t, &local);
+#endif
+		return local;
+	}
+}
+
+size_t Sqex::Network::Structure::XivBundleMagicScanner::Find(std::span<const uint8_t> buf) {
+	const auto size = buf.size();
+	auto pos = std::min(m_scanned, size);
+
+	if (size >= MagicLength) {
+		const auto end = size - MagicLength + 1;
+		if (pos < end)
+			pos = FindMagic(buf.data(), pos, end);
+		if (pos < end)
+			return m_scanned = pos;
+	}
+
+	// Positions near the end can only be checked against a prefix of a magic.
+	for (; pos < size; ++pos) {
+		const auto length = size - pos;
+		if (!memcmp(&buf[pos], XivBundle::MagicConstant1, length) || !memcmp(&buf[pos], XivBundle::MagicConstant2, length))
+			break;
+	}
+	return m_scanned = pos;
 }
 
 std::string Sqex::Network::Structure::XivBundle::Represent() const {
-	const auto st = Utils::EpochToLocalSystemTime(Timestamp);
+	const auto t = EpochToLocalTime(Timestamp / 1000);
 	return std::format(
 		"[{:04}-{:02}-{:02} {:02}:{:02}:{:02}.{:03}] Length={} ConnType={} Count={} CompressionType={}",
-		st.wYear, st.wMonth, st.wDay,
-		st.wHour, st.wMinute, st.wSecond,
-		st.wMilliseconds,
+		t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+		t.tm_hour, t.tm_min, t.tm_sec,
+		Timestamp % 1000,
 		TotalLength, ConnType, MessageCount, static_cast<int>(CompressionType)
 	);
 }
 
-std::vector<std::vector<uint8_t>> Sqex::Network::Structure::XivBundle::SplitMessages(uint16_t expectedMessageCount, const std::span<const uint8_t>& buf) {
-	std::vector<std::vector<uint8_t>> result;
-	result.reserve(expectedMessageCount);
-	for (size_t i = 0; i < buf.size();) {
-		const auto& message = *reinterpret_cast<const XivMessage*>(&buf[i]);
-		if (i + message.Length > buf.size() || !message.Length)
+void Sqex::Network::Structure::XivMessageList::Reset(uint16_t expectedMessageCount, std::span<uint8_t> body) {
+	m_body = body;
+	m_offsets.clear();
+	m_offsets.reserve(expectedMessageCount);
+	for (size_t i = 0; i < body.size();) {
+		if (i + sizeof(XivMessageHeader) > body.size())
+			throw std::runtime_error("Could not parse game message (incomplete message header)");
+
+		const auto& message = *reinterpret_cast<const XivMessage*>(&body[i]);
+		if (i + message.Length > body.size() || !message.Length)
 			throw std::runtime_error("Could not parse game message (sum(message.length for each message) > total message length)");
 
-		const auto sub = buf.subspan(i, static_cast<size_t>(message.Length));
-		result.emplace_back(sub.begin(), sub.end());
+		m_offsets.push_back(static_cast<uint32_t>(i));
 		i += message.Length;
 	}
-	return result;
+	m_deleted.assign(m_offsets.size(), false);
+	m_deletedCount = 0;
+}
+
+void Sqex::Network::Structure::XivMessageList::ResetWithCopy(uint16_t expectedMessageCount, std::span<const uint8_t> body) {
+	m_ownedBody.assign(body.begin(), body.end());
+	Reset(expectedMessageCount, std::span(m_ownedBody));
+}
+
+void Sqex::Network::Structure::XivMessageList::Delete(size_t index) {
+	if (m_deleted[index])
+		return;
+	m_deleted[index] = true;
+	m_deletedCount++;
+}
+
+std::span<uint8_t> Sqex::Network::Structure::XivMessageList::Compact() {
+	if (!m_deletedCount)
+		return m_body;
+
+	size_t writePtr = 0;
+	for (size_t i = 0; i < m_offsets.size(); ++i) {
+		if (m_deleted[i])
+			continue;
+
+		const auto length = reinterpret_cast<const XivMessage*>(&m_body[m_offsets[i]])->Length;
+		if (writePtr != m_offsets[i])
+			std::memmove(&m_body[writePtr], &m_body[m_offsets[i]], length);
+		writePtr += length;
+	}
+	return m_body.subspan(0, writePtr);
 }
 
-std::vector<std::vector<uint8_t>> Sqex::Network::Structure::XivBundle::GetMessages(Utils::ZlibReusableInflater& inflater, Utils::Oodler& oodler) const {
-	const auto view = std::span(Data, TotalLength - sizeof XivBundleHeader);
+void Sqex::Network::Structure::XivBundle::GetMessages(Utils::ZlibReusableInflater& inflater, Utils::Oodler& oodler, XivMessageList& result) const {
+	const auto view = std::span(Data, TotalLength - sizeof(XivBundleHeader));
 
 	switch (CompressionType) {
 		case CompressionType::None:
-			return SplitMessages(MessageCount, view);
+			return result.ResetWithCopy(MessageCount, view);
 		case CompressionType::Deflate:
-			return SplitMessages(MessageCount, inflater(view));
+			return result.Reset(MessageCount, inflater(view));
 		case CompressionType::Oodle:
-			return SplitMessages(MessageCount, oodler.decode(view, DecodedBodyLength));
+			return result.Reset(MessageCount, oodler.decode(view, DecodedBodyLength));
 		default:
-			throw CorruptDataException(std::format("Unsupported compression type {}", static_cast<int>(CompressionType)));
+			throw std::runtime_error(std::format("Unsupported compression type {}", static_cast<int>(CompressionType)));
 	}
 }
 
 std::string Sqex::Network::Structure::XivMessage::Represent(bool dump) const {
 	std::string dumpstr;
 	if (Type == MessageType::ClientKeepAlive || Type == MessageType::ServerKeepAlive) {
-		const auto st = Utils::EpochToLocalSystemTime(Data.KeepAlive.Epoch * 1000LL);
+		const auto t = EpochToLocalTime(Data.KeepAlive.Epoch);
 		dumpstr += std::format(
 			"\n\tFFXIVMessage {:04}-{:02}-{:02} {:02}:{:02}:{:02} ID={}",
-			st.wYear, st.wMonth, st.wDay,
-			st.wHour, st.wMinute, st.wSecond,
+			t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+			t.tm_hour, t.tm_min, t.tm_sec,
 			Data.KeepAlive.Id
 		);
 	} else if (Type == MessageType::Ipc) {
-		const auto st = Utils::EpochToLocalSystemTime(Data.Ipc.Epoch * 1000LL);
+		const auto t = EpochToLocalTime(Data.Ipc.Epoch);
 		dumpstr += std::format(
 			"\n\tFFXIVMessage {:04}-{:02}-{:02} {:02}:{:02}:{:02} Type={:04x} SubType={:04x} Unknown1={:04x} SeqId={:04x} Unknown2={:08x}",
-			st.wYear, st.wMonth, st.wDay,
-			st.wHour, st.wMinute, st.wSecond,
+			t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+			t.tm_hour, t.tm_min, t.tm_sec,
 			static_cast<int>(Data.Ipc.Type), Data.Ipc.SubType, Data.Ipc.Unknown1, Data.Ipc.ServerId, Data.Ipc.Unknown2
 		);
 		if (dump) {
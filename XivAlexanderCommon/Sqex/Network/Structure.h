@@ -67,75 +67,80 @@ namespace Sqex::Network::Structure {
 		};
 
 		struct S2C_ActorControl {
-			union {
+			struct RawType {
 				S2C_ActorControlCategory Category;
+				uint16_t Padding1;
+				uint32_t Param1;
+				uint32_t Param2;
+				uint32_t Param3;
+				uint32_t Param4;
+				uint32_t Padding2;
+			};
 
-				struct RawType {
-					S2C_ActorControlCategory Category;
-					uint16_t Padding1;
-					uint32_t Param1;
-					uint32_t Param2;
-					uint32_t Param3;
-					uint32_t Param4;
-					uint32_t Padding2;
-				} Raw;
-
-				struct CancelCastType {
-					S2C_ActorControlCategory Category;
-					uint16_t Padding1;
-					uint32_t Param1;
-					uint32_t Param2;
-					uint32_t ActionId;
-					uint32_t Param4;
-					uint32_t Padding2;
-				} CancelCast;
+			struct CancelCastType {
+				S2C_ActorControlCategory Category;
+				uint16_t Padding1;
+				uint32_t Param1;
+				uint32_t Param2;
+				uint32_t ActionId;
+				uint32_t Param4;
+				uint32_t Padding2;
+			};
+
+			union {
+				S2C_ActorControlCategory Category;
+				RawType Raw;
+				CancelCastType CancelCast;
 			};
 		};
 
 		struct S2C_ActorControlSelf {
-			union {
+			struct RawType {
 				S2C_ActorControlSelfCategory Category;
+				uint16_t Padding1;
+				uint32_t Param1;
+				uint32_t Param2;
+				uint32_t Param3;
+				uint32_t Param4;
+				uint32_t Param5;
+				uint32_t Param6;
+				uint32_t Padding2;
+			};
 
-				struct RawType {
-					S2C_ActorControlSelfCategory Category;
-					uint16_t Padding1;
-					uint32_t Param1;
-					uint32_t Param2;
-					uint32_t Param3;
-					uint32_t Param4;
-					uint32_t Param5;
-					uint32_t Param6;
-					uint32_t Padding2;
-				} Raw;
-
-				struct RollbackType {
-					S2C_ActorControlSelfCategory Category;
-					uint16_t Padding1;
-					uint32_t Param1;
-					uint32_t Param2;
-					uint32_t ActionId;
-					uint32_t Param4;
-					uint32_t Param5;
-					uint32_t SourceSequence;
-					uint32_t Padding2;
-				} Rollback;
-
-				struct CooldownType {
-					S2C_ActorControlSelfCategory Category;
-					uint16_t Padding1;
-					uint32_t CooldownGroupId;
-					uint32_t ActionId;
-					int32_t Duration10ms;  // in 10 milliseconds unit
-					uint32_t Param4;
-					uint32_t Param5;
-					uint32_t Param6;
-					uint32_t Padding2;
-
-					void DurationF(double v) { Duration10ms = static_cast<uint32_t>(100. * v); }
-					double DurationF() const { return static_cast<double>(Duration10ms) / 100.; }
-					void DurationUs(int64_t v) { Duration10ms = static_cast<int32_t>(v / 10000ULL); }
-					int64_t DurationUs() const { return Duration10ms * 10000ULL; };
-				} Cooldown;
+			struct RollbackType {
+				S2C_ActorControlSelfCategory Category;
+				uint16_t Padding1;
+				uint32_t Param1;
+				uint32_t Param2;
+				uint32_t ActionId;
+				uint32_t Param4;
+				uint32_t Param5;
+				uint32_t SourceSequence;
+				uint32_t Padding2;
+			};
+
+			struct CooldownType {
+				S2C_ActorControlSelfCategory Category;
+				uint16_t Padding1;
+				uint32_t CooldownGroupId;
+				uint32_t ActionId;
+				int32_t Duration10ms;  // in 10 milliseconds unit
+				uint32_t Param4;
+				uint32_t Param5;
+				uint32_t Param6;
+				uint32_t Padding2;
+
+				void DurationF(double v) { Duration10ms = static_cast<uint32_t>(100. * v); }
+				double DurationF() const { return static_cast<double>(Duration10ms) / 100.; }
+				void DurationUs(int64_t v) { Duration10ms = static_cast<int32_t>(v / 10000ULL); }
+				int64_t DurationUs() const { return Duration10ms * 10000ULL; };
+			};
+
+			union {
+				S2C_ActorControlSelfCategory Category;
+				RawType Raw;
+				RollbackType Rollback;
+				CooldownType Cooldown;
 			};
 		};
 
@@ -231,21 +236,80 @@ namespace Sqex::Network::Structure {
 		uint16_t ConnType;		// 28 ~ 29
 		uint16_t MessageCount;	// 30 ~ 31
 		uint8_t Encoding;		// 32
-		CompressionType CompressionType;	// 33
+		Structure::CompressionType CompressionType;	// 33
 		uint16_t Unknown2;		// 34 ~ 35
 		uint32_t DecodedBodyLength; // 36 ~ 39
 	};
 
+	/*
+	 * Messages of a decoded bundle body, viewed in place.
+	 * Messages may be modified through the returned references; removed messages are only marked,
+	 * and the body is rewritten once in Compact.
+	 */
+	class XivMessageList {
+		std::vector<uint8_t> m_ownedBody;
+		std::span<uint8_t> m_body;
+		std::vector<uint32_t> m_offsets;
+		std::vector<bool> m_deleted;
+		size_t m_deletedCount = 0;
+
+	public:
+		/// \brief Splits body into messages without copying. body must stay valid while this list is in use.
+		void Reset(uint16_t expectedMessageCount, std::span<uint8_t> body);
+
+		/// \brief Splits a copy of body into messages. The copy is kept in a buffer reused across calls.
+		void ResetWithCopy(uint16_t expectedMessageCount, std::span<const uint8_t> body);
+
+		[[nodiscard]] size_t Count() const { return m_offsets.size(); }
+		[[nodiscard]] size_t RemainingCount() const { return m_offsets.size() - m_deletedCount; }
+		[[nodiscard]] size_t DeletedCount() const { return m_deletedCount; }
+
+		[[nodiscard]] XivMessage& operator[](size_t index) { return *reinterpret_cast<XivMessage*>(&m_body[m_offsets[index]]); }
+		[[nodiscard]] const XivMessage& operator[](size_t index) const { return *reinterpret_cast<const XivMessage*>(&m_body[m_offsets[index]]); }
+
+		[[nodiscard]] bool IsDeleted(size_t index) const { return m_deleted[index]; }
+		void Delete(size_t index);
+
+		/// \brief Moves remaining messages to the front of the body in one pass.
+		/// \returns The body containing only the remaining messages.
+		std::span<uint8_t> Compact();
+	};
+
 	struct XivBundle : XivBundleHeader {
 		uint8_t Data[1];
 
 		static const uint8_t MagicConstant1[sizeof Magic];
 		static const uint8_t MagicConstant2[sizeof Magic];
+		/// \brief Returns leading bytes of buf that cannot be a part of a bundle.
+		/// Use XivBundleMagicScanner instead when scanning the same buffer repeatedly.
 		[[nodiscard]] static std::span<const uint8_t> ExtractFrontTrash(const std::span<const uint8_t>& buf);
 
 		std::string Represent() const;
 
-		[[nodiscard]] static std::vector<std::vector<uint8_t>> SplitMessages(uint16_t expectedMessageCount, const std::span<const uint8_t>& buf);
-		[[nodiscard]] std::vector<std::vector<uint8_t>> GetMessages(Utils::ZlibReusableInflater&, Utils::Oodler&) const;
+		/// \brief Decodes the body and splits it into result.
+		/// If compressed, result refers to the buffer of inflater or oodler, and is valid until either is used again.
+		void GetMessages(Utils::ZlibReusableInflater& inflater, Utils::Oodler& oodler, XivMessageList& result) const;
+	};
+
+	/*
+	 * Finds where the next bundle may begin in a buffer of pending stream data.
+	 * Remembers how far the data has been found not to contain a magic, so that repeated calls on a growing buffer
+	 * do not scan the same bytes again. Call Consume whenever data is removed from the front of the buffer.
+	 */
+	class XivBundleMagicScanner {
+		size_t m_scanned = 0;
+
+	public:
+		/// \returns Offset of the first position that begins with either magic, or with a prefix of either magic
+		/// if it is too close to the end of buf; buf.size() if there is none.
+		[[nodiscard]] size_t Find(std::span<const uint8_t> buf);
+
+		void Consume(size_t length) {
+			m_scanned = m_scanned > length ? m_scanned - length : 0;
+		}
+
+		void Reset() {
+			m_scanned = 0;
+		}
 	};
 }
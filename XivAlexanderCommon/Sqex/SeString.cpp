@@ -1,55 +1,97 @@
 #include "pch.h"
 #include "XivAlexanderCommon/Sqex/SeString.h"
 
+#include <bit>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#endif
+
+bool Sqex::SeStringTokenizer::Next(SeStringToken& token) {
+	if (m_remaining.empty())
+		return false;
+
+	if (m_remaining[0] != StartOfText) {
+		const auto length = std::min(FindStartOfText(m_remaining, 1), m_remaining.size());
+		token = { m_remaining.substr(0, length) };
+		m_remaining = m_remaining.substr(length);
+		return true;
+	}
+
+	if (m_remaining.size() < 3)
+		throw std::invalid_argument("STX occurred but there are less than 3 remaining bytes");
+	auto remaining = m_remaining.substr(1);
+
+	const auto payloadTypeLength = SeExpressionUint32::ExpressionLength(remaining[0]);
+	if (payloadTypeLength == 0)
+		throw std::invalid_argument("payload type length specifier is not a SeExpressionUint32");
+	else if (remaining.size() < payloadTypeLength)
+		throw std::invalid_argument("payload type length specifier is incomplete");
+	const auto payloadType = SeExpressionUint32::Decode(remaining);
+	remaining = remaining.substr(payloadTypeLength);
+
+	if (remaining.empty())
+		throw std::invalid_argument("payload data length specifier is missing");
+	const auto lengthLength = SeExpressionUint32::ExpressionLength(remaining[0]);
+	if (lengthLength == 0)
+		throw std::invalid_argument("payload data length specifier is not a SeExpressionUint32");
+	else if (remaining.size() < lengthLength)
+		throw std::invalid_argument("payload data length specifier is incomplete");
+	const auto payloadLength = SeExpressionUint32::Decode(remaining);
+	remaining = remaining.substr(lengthLength);
+
+	if (remaining.size() < payloadLength)
+		throw std::invalid_argument("payload is incomplete");
+	const auto payloadData = remaining.substr(0, payloadLength);
+	remaining = remaining.substr(payloadLength);
+
+	if (remaining.empty() || remaining[0] != EndOfText)
+		throw std::invalid_argument("ETX not found");
+	remaining = remaining.substr(1);
+
+	token = { m_remaining.substr(0, m_remaining.size() - remaining.size()), true, payloadType, payloadData };
+	m_remaining = remaining;
+	return true;
+}
+
+size_t Sqex::SeStringTokenizer::FindStartOfText(std::string_view s, size_t pos) {
+#if defined(_M_X64) || defined(_M_IX86)
+	const auto stx = _mm_set1_epi8(StartOfText);
+	for (; pos + sizeof(__m128i) <= s.size(); pos += sizeof(__m128i)) {
+		const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + pos));
+		if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, stx))))
+			return pos + std::countr_zero(mask);
+	}
+#endif
+	for (; pos < s.size(); ++pos) {
+		if (s[pos] == StartOfText)
+			return pos;
+	}
+	return std::string_view::npos;
+}
+
 void Sqex::SeString::Parse() const {
-	if (!m_parsed.empty() || m_escaped.empty())
+	if (m_escapedIsParsed || !m_parsed.empty() || m_escaped.empty())
 		return;
 
+	if (SeStringTokenizer::FindStartOfText(m_escaped) == std::string_view::npos) {
+		m_escapedIsParsed = true;
+		return;
+	}
+
 	std::string parsed;
 	std::vector<SePayload> payloads;
 	parsed.reserve(m_escaped.size());
 
-	std::string_view remaining(m_escaped);
-	while (!remaining.empty()) {
-		if (remaining[0] == StartOfText) {
-			if (remaining.size() < 3)
-				throw std::invalid_argument("STX occurred but there are less than 3 remaining bytes");
-			remaining = remaining.substr(1);
-
-			const auto payloadTypeLength = SeExpressionUint32::ExpressionLength(remaining[0]);
-			if (payloadTypeLength == 0)
-				throw std::invalid_argument("payload type length specifier is not a SeExpressionUint32");
-			else if (remaining.size() < payloadTypeLength)
-				throw std::invalid_argument("payload type length specifier is incomplete");
-			const auto payloadType = SeExpressionUint32(remaining);
-			remaining = remaining.substr(payloadTypeLength);
-
-			const auto lengthLength = SeExpressionUint32::ExpressionLength(remaining[0]);
-			if (lengthLength == 0)
-				throw std::invalid_argument("payload data length specifier is not a SeExpressionUint32");
-			else if (remaining.size() < lengthLength)
-				throw std::invalid_argument("payload data length specifier is incomplete");
-			const auto payloadLength = SeExpressionUint32(remaining);
-			remaining = remaining.substr(lengthLength);
-
-			if (remaining.size() < payloadLength)
-				throw std::invalid_argument("payload is incomplete");
-			auto payload = SePayload(payloadType, remaining.substr(0, payloadLength));
-			remaining = remaining.substr(payloadLength);
-
-			if (remaining.empty() || remaining[0] != EndOfText)
-				throw std::invalid_argument("ETX not found");
-			remaining = remaining.substr(1);
-
-			if (m_newlineAsCarriageReturn && payload.Type() == SePayload::PayloadType::NewLine) {
-				parsed.push_back('\r');
-			} else {
-				parsed.push_back(StartOfText);
-				payloads.emplace_back(std::move(payload));
-			}
-		} else {
-			parsed.push_back(remaining.front());
-			remaining = remaining.substr(1);
+	SeStringToken token;
+	for (SeStringTokenizer tokenizer(m_escaped); tokenizer.Next(token);) {
+		if (!token.IsPayload)
+			parsed += token.Escaped;
+		else if (m_newlineAsCarriageReturn && token.PayloadType == SePayload::PayloadType::NewLine)
+			parsed.push_back('\r');
+		else {
+			parsed.push_back(StartOfText);
+			payloads.emplace_back(token.PayloadType, token.PayloadData);
 		}
 	}
 
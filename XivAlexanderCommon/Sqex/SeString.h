@@ -131,11 +131,39 @@ namespace Sqex {
 		}
 	};
 
-	class SeString {
+	// Piece of an escaped SeString: either a run of text without any payload, or a single payload.
+	// Views point into the string being tokenized.
+	struct SeStringToken {
+		std::string_view Escaped;
+		bool IsPayload = false;
+		uint32_t PayloadType = 0;
+		std::string_view PayloadData;
+	};
+
+	// Splits an escaped SeString into tokens without allocating anything.
+	class SeStringTokenizer {
+		std::string_view m_remaining;
+
+	public:
 		static constexpr auto StartOfText = '\x02';
 		static constexpr auto EndOfText = '\x03';
 
+		SeStringTokenizer(std::string_view escaped)
+			: m_remaining(escaped) {
+		}
+
+		// Returns false if there is nothing left. Throws std::invalid_argument on a malformed payload.
+		bool Next(SeStringToken& token);
+
+		[[nodiscard]] static size_t FindStartOfText(std::string_view s, size_t pos = 0);
+	};
+
+	class SeString {
+		static constexpr auto StartOfText = SeStringTokenizer::StartOfText;
+		static constexpr auto EndOfText = SeStringTokenizer::EndOfText;
+
 		bool m_newlineAsCarriageReturn = false;
+		mutable bool m_escapedIsParsed = false;  // Set if m_escaped contains no payload, in which case m_parsed is left empty
 		mutable std::string m_escaped;
 		mutable std::string m_parsed;
 		mutable std::vector<SePayload> m_payloads;
@@ -188,6 +216,7 @@ namespace Sqex {
 			Escape();
 			m_parsed.clear();
 			m_payloads.clear();
+			m_escapedIsParsed = false;
 			m_newlineAsCarriageReturn = enable;
 		}
 
@@ -197,7 +226,7 @@ namespace Sqex {
 
 		[[nodiscard]] const std::string& Parsed() const {
 			Parse();
-			return m_parsed;
+			return m_escapedIsParsed ? m_escaped : m_parsed;
 		}
 
 		SeString& SetParsed(std::string parsed, std::vector<SePayload> payloads) {
@@ -205,6 +234,7 @@ namespace Sqex {
 			m_parsed = std::move(parsed);
 			m_payloads = std::move(payloads);
 			m_escaped.clear();
+			m_escapedIsParsed = false;
 			return *this;
 		}
 
@@ -213,6 +243,7 @@ namespace Sqex {
 			VerifyComponents(s, m_payloads);
 			m_parsed = std::move(s);
 			m_escaped.clear();
+			m_escapedIsParsed = false;
 			return *this;
 		}
 
@@ -225,6 +256,7 @@ namespace Sqex {
 			m_escaped = std::move(escaped);
 			m_parsed.clear();
 			m_payloads.clear();
+			m_escapedIsParsed = false;
 			return *this;
 		}
 
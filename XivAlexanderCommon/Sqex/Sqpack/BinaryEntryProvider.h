@@ -1,6 +1,7 @@
 #pragma once
 
 #include "XivAlexanderCommon/Sqex/Sqpack/LazyEntryProvider.h"
+#include "XivAlexanderCommon/Sqex/Sqpack/TieredEntryDataStore.h"
 
 namespace Sqex::Sqpack {
 	class OnTheFlyBinaryEntryProvider : public LazyFileOpeningEntryProvider {
@@ -26,7 +27,7 @@ namespace Sqex::Sqpack {
 	};
 
 	class MemoryBinaryEntryProvider : public LazyFileOpeningEntryProvider {
-		std::vector<char> m_data;
+		std::unique_ptr<TieredEntryDataStore::Item> m_data;
 
 	public:
 		using LazyFileOpeningEntryProvider::LazyFileOpeningEntryProvider;
@@ -39,7 +40,7 @@ namespace Sqex::Sqpack {
 
 	protected:
 		void Initialize(const RandomAccessStream& stream) override;
-		[[nodiscard]] uint64_t StreamSize(const RandomAccessStream& stream) const override { return static_cast<uint32_t>(m_data.size()); }
+		[[nodiscard]] uint64_t StreamSize(const RandomAccessStream& stream) const override { return m_data->Size(); }
 		uint64_t ReadStreamPartial(const RandomAccessStream& stream, uint64_t offset, void* buf, uint64_t length) const override;
 	};
 }
@@ -0,0 +1,103 @@
+#include "pch.h"
+#include "XivAlexanderCommon/Sqex/Sqpack/CompressedEntryCache.h"
+
+#include "XivAlexanderCommon/Sqex/Sqpack/RandomAccessStreamAsEntryProviderView.h"
+#include "XivAlexanderCommon/Utils/Win32/Handle.h"
+
+Sqex::Sqpack::CompressedEntryCache::CompressedEntryCache(std::filesystem::path dir)
+	: m_dir(std::move(dir)) {
+}
+
+std::shared_ptr<Sqex::Sqpack::EntryProvider> Sqex::Sqpack::CompressedEntryCache::GetOrBuild(
+	const EntryPathSpec& pathSpec,
+	const RandomAccessStream& raw,
+	SqData::FileEntryType type,
+	int compressionLevel,
+	const std::function<std::shared_ptr<EntryProvider>()>& build
+) {
+	const auto cachePath = GetCachePath(raw, type, compressionLevel);
+
+	try {
+		if (exists(cachePath)) {
+			auto data = std::make_shared<FileRandomAccessStream>(Utils::Win32::Handle::FromCreateFile(cachePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0));
+			if (data->StreamSize() >= sizeof SqData::FileEntryHeader) {
+				std::error_code ec;
+				last_write_time(cachePath, std::filesystem::file_time_type::clock::now(), ec);
+
+				++m_hits;
+				return std::make_shared<RandomAccessStreamAsEntryProviderView>(pathSpec, std::move(data));
+			}
+		}
+	} catch (...) {
+		// treat unreadable cache files as a miss; it will be overwritten below
+	}
+
+	++m_misses;
+	const auto provider = build();
+	auto data = provider->ReadStreamIntoVector<uint8_t>(0);
+
+	try {
+		create_directories(cachePath.parent_path());
+
+		// Write to a unique temporary file first, so that concurrent writers and readers never see a partial entry.
+		auto tempPath = cachePath;
+		tempPath += std::format(L".{}.tmp", GetCurrentThreadId());
+		Utils::Win32::Handle::FromCreateFile(tempPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, 0).Write(0, std::span(data));
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, cachePath, ec);
+		if (ec)
+			std::filesystem::remove(tempPath, ec);
+	} catch (...) {
+		// caching is best effort
+	}
+
+	return std::make_shared<RandomAccessStreamAsEntryProviderView>(pathSpec, std::make_shared<MemoryRandomAccessStream>(std::move(data)));
+}
+
+void Sqex::Sqpack::CompressedEntryCache::Trim(uint64_t maxBytes) const {
+	std::error_code ec;
+	if (!exists(m_dir, ec))
+		return;
+
+	std::vector<std::tuple<std::filesystem::file_time_type, uint64_t, std::filesystem::path>> files;
+	uint64_t totalBytes = 0;
+	for (const auto& item : std::filesystem::recursive_directory_iterator(m_dir, ec)) {
+		if (!item.is_regular_file(ec))
+			continue;
+		const auto size = item.file_size(ec);
+		files.emplace_back(item.last_write_time(ec), size, item.path());
+		totalBytes += size;
+	}
+
+	if (totalBytes <= maxBytes)
+		return;
+
+	std::ranges::sort(files);
+	for (const auto& [time, size, path] : files) {
+		if (totalBytes <= maxBytes)
+			break;
+		if (std::filesystem::remove(path, ec))
+			totalBytes -= size;
+	}
+}
+
+std::filesystem::path Sqex::Sqpack::CompressedEntryCache::GetCachePath(const RandomAccessStream& raw, SqData::FileEntryType type, int compressionLevel) const {
+	const auto rawSize = raw.StreamSize();
+
+	uint8_t hash[CryptoPP::SHA1::DIGESTSIZE]{};
+	CryptoPP::SHA1 sha1;
+	std::vector<uint8_t> buf(65536);
+	Align<uint64_t>(rawSize, buf.size()).IterateChunked([&](uint64_t, uint64_t offset, uint64_t size) {
+		raw.ReadStream(offset, &buf[0], size);
+		sha1.Update(&buf[0], static_cast<size_t>(size));
+		});
+	sha1.Final(reinterpret_cast<byte*>(hash));
+
+	std::string hex;
+	hex.reserve(sizeof hash * 2);
+	for (const auto b : hash)
+		hex += std::format("{:02x}", b);
+
+	return m_dir / hex.substr(0, 2) / std::format("{}_{}_{}_{}.bin", hex, rawSize, static_cast<int>(type), compressionLevel);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+
+#include "XivAlexanderCommon/Sqex/Sqpack/EntryProvider.h"
+
+namespace Sqex::Sqpack {
+	/*
+	 * Content-addressed on-disk cache of built sqpack entries.
+	 * Entries are keyed by the hash of their decoded file content, their entry type, and the compression level used,
+	 * so identical files shared across modpacks or modpack versions are compressed only once.
+	 */
+	class CompressedEntryCache {
+		const std::filesystem::path m_dir;
+
+		std::atomic_uint64_t m_hits = 0;
+		std::atomic_uint64_t m_misses = 0;
+
+	public:
+		CompressedEntryCache(std::filesystem::path dir);
+
+		/// \brief Returns the cached entry built from raw, or calls build and stores its result on miss.
+		[[nodiscard]] std::shared_ptr<EntryProvider> GetOrBuild(
+			const EntryPathSpec& pathSpec,
+			const RandomAccessStream& raw,
+			SqData::FileEntryType type,
+			int compressionLevel,
+			const std::function<std::shared_ptr<EntryProvider>()>& build);
+
+		/// \brief Removes least recently used cache files until the total size is at most maxBytes.
+		void Trim(uint64_t maxBytes) const;
+
+		[[nodiscard]] uint64_t Hits() const { return m_hits; }
+		[[nodiscard]] uint64_t Misses() const { return m_misses; }
+
+	private:
+		[[nodiscard]] std::filesystem::path GetCachePath(const RandomAccessStream& raw, SqData::FileEntryType type, int compressionLevel) const;
+	};
+}
@@ -0,0 +1,70 @@
+#include "pch.h"
+#include "XivAlexanderCommon/Sqex/Sqpack/CompressionPolicy.h"
+
+void Sqex::Sqpack::to_json(nlohmann::json& j, const CompressionPolicy& value) {
+	switch (value) {
+		case CompressionPolicy::None:
+			j = "None";
+			break;
+		case CompressionPolicy::Fastest:
+			j = "Fastest";
+			break;
+		case CompressionPolicy::Maximum:
+			j = "Maximum";
+			break;
+		case CompressionPolicy::Balanced:
+		default:
+			j = "Balanced";
+	}
+}
+
+void Sqex::Sqpack::from_json(const nlohmann::json& j, CompressionPolicy& newValue) {
+	auto newValueString = FromUtf8(j.get<std::string>());
+	CharLowerW(&newValueString[0]);
+
+	newValue = CompressionPolicy::Balanced;
+	if (newValueString.empty())
+		return;
+
+	if (newValueString.substr(0, std::min<size_t>(4, newValueString.size())) == L"none")
+		newValue = CompressionPolicy::None;
+	else if (newValueString.substr(0, std::min<size_t>(7, newValueString.size())) == L"fastest")
+		newValue = CompressionPolicy::Fastest;
+	else if (newValueString.substr(0, std::min<size_t>(7, newValueString.size())) == L"maximum")
+		newValue = CompressionPolicy::Maximum;
+}
+
+int Sqex::Sqpack::GetCompressionLevel(CompressionPolicy policy, SqData::FileEntryType type, uint64_t rawSize) {
+	switch (policy) {
+		case CompressionPolicy::None:
+			return Z_NO_COMPRESSION;
+
+		case CompressionPolicy::Fastest:
+			return Z_BEST_SPEED;
+
+		case CompressionPolicy::Maximum:
+			return Z_BEST_COMPRESSION;
+
+		case CompressionPolicy::Balanced:
+		default:
+			break;
+	}
+
+	// Large textures and models are mostly block compressed pixel data or vertex buffers, where higher levels
+	// spend a lot more time for barely any size reduction; small files are cheap to compress well.
+	switch (type) {
+		case SqData::FileEntryType::Texture:
+			return rawSize >= 1048576 ? Z_BEST_SPEED : Z_DEFAULT_COMPRESSION;
+
+		case SqData::FileEntryType::Model:
+			return rawSize >= 1048576 ? 3 : Z_DEFAULT_COMPRESSION;
+
+		case SqData::FileEntryType::Binary:
+			if (rawSize <= 65536)
+				return Z_BEST_COMPRESSION;
+			return rawSize >= 4194304 ? 3 : Z_DEFAULT_COMPRESSION;
+
+		default:
+			return Z_DEFAULT_COMPRESSION;
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "XivAlexanderCommon/Sqex/Sqpack.h"
+
+namespace Sqex::Sqpack {
+	enum class CompressionPolicy {
+		None,
+		Fastest,
+		Balanced,
+		Maximum,
+	};
+
+	void to_json(nlohmann::json&, const CompressionPolicy&);
+	void from_json(const nlohmann::json&, CompressionPolicy&);
+
+	/// \brief Decides the deflate level to use for an entry of given type and decoded size.
+	/// \returns Z_NO_COMPRESSION to store blocks as-is, or a zlib compression level otherwise.
+	[[nodiscard]] int GetCompressionLevel(CompressionPolicy policy, SqData::FileEntryType type, uint64_t rawSize);
+}
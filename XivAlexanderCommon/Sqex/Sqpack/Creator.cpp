@@ -1,6 +1,10 @@
 #include "pch.h"
 #include "XivAlexanderCommon/Sqex/Sqpack/Creator.h"
 
+#include <condition_variable>
+#include <deque>
+#include <list>
+
 #include "XivAlexanderCommon/Sqex/Model.h"
 #include "XivAlexanderCommon/Sqex/Sqpack/BinaryEntryProvider.h"
 #include "XivAlexanderCommon/Sqex/Sqpack/EmptyOrObfuscatedEntryProvider.h"
@@ -383,6 +387,11 @@ public:
 		, m_buffer(std::move(buffer)) {
 	}
 
+	~DataView() override {
+		if (m_buffer)
+			m_buffer->Forget(this);
+	}
+
 	uint64_t ReadStreamPartial(uint64_t offset, void* buf, uint64_t length) const override {
 		const auto st = Utils::QpcUs();
 		m_pLastEntryProviders.clear();
@@ -428,7 +437,7 @@ public:
 				const auto& entry = **it;
 				m_lastAccessedEntryIndex = it - m_entries.begin();
 
-				const auto buf = m_buffer ? m_buffer->GetBuffer(this, &entry) : nullptr;
+				const auto buf = m_buffer ? m_buffer->GetBuffer(this, m_entries, m_lastAccessedEntryIndex) : nullptr;
 
 				if (relativeOffset < entry.EntrySize) {
 					const auto available = std::min(out.size_bytes(), static_cast<size_t>(entry.EntrySize - relativeOffset));
@@ -460,6 +469,10 @@ public:
 		for (const auto& [p, off, len] : m_pLastEntryProviders) {
 			res += std::format(" [{}: {}->{}: {}]", p->PathSpec(), off, len, p->DescribeState());
 		}
+		if (m_buffer) {
+			const auto stats = m_buffer->GetPrefetchStatistics();
+			res += std::format(" prefetch(hit={:.1f}% {}/{}, claimed={}, wasted={}, {} bytes)", stats.HitRate() * 100, stats.Hits, stats.Hits + stats.Misses, stats.Claimed, stats.Wasted, stats.BytesInUse);
+		}
 		return res;
 	}
 
@@ -801,17 +814,307 @@ void Sqex::Sqpack::Creator::WriteToFiles(const std::filesystem::path & dir, bool
 			dataSubheaders.size(), std::move(fileEntries2), std::move(conflictEntries2), m_pImpl->m_sqpackIndex2Segment3, std::vector<SqIndex::PathHashLocator>(), strict)));
 }
 
+class Sqex::Sqpack::Creator::SqpackViewEntryCache::Prefetcher {
+	// Number of consecutive identical strides required before a stride is trusted.
+	static constexpr size_t StrideConfirmationCount = 2;
+
+	// Number of entries ahead to prefetch along a confirmed stride.
+	static constexpr size_t StrideLookahead = 2;
+
+	// Number of distinct successors remembered for each entry.
+	static constexpr size_t MaxFollowersPerEntry = 4;
+
+	struct ViewAccessPattern {
+		size_t LastIndex = SIZE_MAX;
+		ptrdiff_t LastStride = 0;
+		size_t StrideRepeatCount = 0;
+	};
+
+	using ViewEntry = std::pair<const DataView*, const Entry*>;
+
+	struct QueuedEntry {
+		const DataView* View;
+		const Entry* Target;
+
+		// Entries are owned by SqpackViews and may be gone by the time the worker gets to them,
+		// so the worker reads through its own reference to the provider.
+		std::shared_ptr<EntryProvider> Provider;
+		uint32_t EntrySize;
+	};
+
+	struct PrefetchedEntry {
+		const DataView* View;
+		const Entry* Target;
+		std::vector<uint8_t> Data;
+	};
+
+	const uint64_t m_budget;
+
+	// Accessed only from the reading thread.
+	std::map<const DataView*, ViewAccessPattern> m_patterns;
+	ViewEntry m_lastEntry{};
+	std::map<ViewEntry, std::vector<std::pair<ViewEntry, uint32_t>>> m_followers;
+
+	// Shared with the worker thread; guarded by m_mtx.
+	mutable std::mutex m_mtx;
+	std::condition_variable m_cv;
+	std::deque<QueuedEntry> m_queue;
+	std::list<PrefetchedEntry> m_prefetched;  // least recently prefetched first
+	std::map<const Entry*, std::list<PrefetchedEntry>::iterator> m_prefetchedIndex;
+	std::condition_variable m_inFlightCv;
+	ViewEntry m_inFlight{};  // being read by the worker thread right now
+	uint64_t m_generation = 0;
+	bool m_stopping = false;
+	PrefetchStatistics m_stats;
+
+	Utils::Win32::Thread m_worker;
+
+public:
+	Prefetcher(uint64_t budget)
+		: m_budget(budget)
+		, m_worker(L"SqpackViewEntryCache::Prefetcher", [this]() { Run(); }) {
+	}
+
+	~Prefetcher() {
+		{
+			const auto lock = std::lock_guard(m_mtx);
+			m_stopping = true;
+		}
+		m_cv.notify_all();
+		m_worker.Wait();
+	}
+
+	std::optional<std::vector<uint8_t>> Take(const DataView* view, const Entry* entry) {
+		auto lock = std::unique_lock(m_mtx);
+
+		// Not started yet; the caller is going to read it anyway, so the worker should not read it again.
+		if (const auto it = std::ranges::find(m_queue, entry, &QueuedEntry::Target); it != m_queue.end()) {
+			m_queue.erase(it);
+			m_stats.Claimed++;
+			return std::nullopt;
+		}
+
+		// Already being read; waiting for it is cheaper than reading it a second time.
+		m_inFlightCv.wait(lock, [this, entry]() { return m_inFlight.second != entry; });
+
+		const auto it = m_prefetchedIndex.find(entry);
+		if (it == m_prefetchedIndex.end() || it->second->View != view) {
+			m_stats.Misses++;
+			return std::nullopt;
+		}
+
+		auto data = std::move(it->second->Data);
+		m_stats.BytesInUse -= data.size();
+		m_stats.Hits++;
+		m_prefetched.erase(it->second);
+		m_prefetchedIndex.erase(it);
+		return data;
+	}
+
+	void OnAccess(const DataView* view, std::span<Entry* const> entries, size_t entryIndex) {
+		const auto current = ViewEntry(view, entries[entryIndex]);
+		std::vector<ViewEntry> predictions;
+
+		// Entries that were read right after this one before.
+		if (m_lastEntry.second && m_lastEntry != current)
+			RecordFollower(m_lastEntry, current);
+		m_lastEntry = current;
+		if (const auto it = m_followers.find(current); it != m_followers.end()) {
+			for (const auto& follower : it->second | std::views::keys)
+				predictions.emplace_back(follower);
+		}
+
+		// Sequential or strided reads within the same view.
+		auto& pattern = m_patterns[view];
+		if (pattern.LastIndex != SIZE_MAX && pattern.LastIndex != entryIndex) {
+			const auto stride = static_cast<ptrdiff_t>(entryIndex) - static_cast<ptrdiff_t>(pattern.LastIndex);
+			if (stride == pattern.LastStride)
+				pattern.StrideRepeatCount++;
+			else {
+				pattern.LastStride = stride;
+				pattern.StrideRepeatCount = 1;
+			}
+
+			if (pattern.StrideRepeatCount >= StrideConfirmationCount) {
+				for (size_t i = 1; i <= StrideLookahead; ++i) {
+					const auto next = static_cast<ptrdiff_t>(entryIndex) + stride * static_cast<ptrdiff_t>(i);
+					if (next < 0 || next >= static_cast<ptrdiff_t>(entries.size()))
+						break;
+					predictions.emplace_back(view, entries[static_cast<size_t>(next)]);
+				}
+			}
+		}
+		pattern.LastIndex = entryIndex;
+
+		if (predictions.empty())
+			return;
+
+		{
+			const auto lock = std::lock_guard(m_mtx);
+			for (const auto& [predictedView, prediction] : predictions) {
+				// GetBuffer never takes entries that are too large to be buffered.
+				if (prediction->EntrySize > m_budget || prediction->EntrySize > LargeEntryBufferSizeMax)
+					continue;
+				if (m_prefetchedIndex.contains(prediction) || m_inFlight.second == prediction)
+					continue;
+				if (std::ranges::find(m_queue, prediction, &QueuedEntry::Target) != m_queue.end())
+					continue;
+				m_queue.emplace_back(QueuedEntry{ predictedView, prediction, prediction->Provider, prediction->EntrySize });
+				m_stats.Requested++;
+			}
+		}
+		m_cv.notify_one();
+	}
+
+	void Flush() {
+		const auto lock = std::lock_guard(m_mtx);
+		m_generation++;
+		m_queue.clear();
+		m_stats.Wasted += m_prefetched.size();
+		m_stats.BytesInUse = 0;
+		m_prefetched.clear();
+		m_prefetchedIndex.clear();
+	}
+
+	// Drops everything that refers to the view or its entries, waiting for a read in progress to finish first.
+	void Forget(const DataView* view) {
+		m_patterns.erase(view);
+		if (m_lastEntry.first == view)
+			m_lastEntry = {};
+		std::erase_if(m_followers, [view](const auto& item) { return item.first.first == view; });
+		for (auto& followers : m_followers | std::views::values)
+			std::erase_if(followers, [view](const auto& item) { return item.first.first == view; });
+
+		auto lock = std::unique_lock(m_mtx);
+		std::erase_if(m_queue, [view](const auto& item) { return item.View == view; });
+		m_inFlightCv.wait(lock, [this, view]() { return m_inFlight.first != view; });
+		for (auto it = m_prefetched.begin(); it != m_prefetched.end();) {
+			if (it->View != view) {
+				++it;
+				continue;
+			}
+			m_stats.BytesInUse -= it->Data.size();
+			m_stats.Wasted++;
+			m_prefetchedIndex.erase(it->Target);
+			it = m_prefetched.erase(it);
+		}
+	}
+
+	PrefetchStatistics Statistics() const {
+		const auto lock = std::lock_guard(m_mtx);
+		return m_stats;
+	}
+
+private:
+	void RecordFollower(const ViewEntry& from, const ViewEntry& to) {
+		auto& followers = m_followers[from];
+		auto it = std::ranges::find(followers, to, &std::pair<ViewEntry, uint32_t>::first);
+		if (it == followers.end()) {
+			if (followers.size() >= MaxFollowersPerEntry)
+				followers.pop_back();
+			followers.emplace_back(to, 0);
+			it = followers.end() - 1;
+		}
+		it->second++;
+
+		// Keep the most frequent follower at the front.
+		while (it != followers.begin() && (it - 1)->second < it->second) {
+			std::iter_swap(it - 1, it);
+			--it;
+		}
+	}
+
+	void Run() {
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+
+		auto lock = std::unique_lock(m_mtx);
+		while (true) {
+			m_cv.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+			if (m_stopping)
+				return;
+
+			const auto queued = std::move(m_queue.front());
+			m_queue.pop_front();
+			if (m_prefetchedIndex.contains(queued.Target))
+				continue;
+
+			const auto generation = m_generation;
+			m_inFlight = ViewEntry(queued.View, queued.Target);
+			lock.unlock();
+
+			std::vector<uint8_t> data;
+			try {
+				data.resize(queued.EntrySize);
+				queued.Provider->ReadStream(0, std::span(data));
+			} catch (...) {
+				// Leave it to the synchronous read path to report errors.
+				data.clear();
+			}
+
+			lock.lock();
+			m_inFlight = {};
+			if (!data.empty() && generation == m_generation && !m_prefetchedIndex.contains(queued.Target))
+				Store(queued.View, queued.Target, std::move(data));
+			m_inFlightCv.notify_all();
+		}
+	}
+
+	void Store(const DataView* view, const Entry* entry, std::vector<uint8_t>&& data) {
+		while (!m_prefetched.empty() && m_stats.BytesInUse + data.size() > m_budget) {
+			m_stats.BytesInUse -= m_prefetched.front().Data.size();
+			m_stats.Wasted++;
+			m_prefetchedIndex.erase(m_prefetched.front().Target);
+			m_prefetched.pop_front();
+		}
+
+		m_stats.BytesInUse += data.size();
+		m_stats.Completed++;
+		m_prefetched.emplace_back(PrefetchedEntry{ view, entry, std::move(data) });
+		m_prefetchedIndex.emplace(entry, std::prev(m_prefetched.end()));
+	}
+};
+
+Sqex::Sqpack::Creator::SqpackViewEntryCache::SqpackViewEntryCache(uint64_t prefetchBudget)
+	: m_prefetcher(prefetchBudget ? std::make_unique<Prefetcher>(prefetchBudget) : nullptr) {
+}
+
+Sqex::Sqpack::Creator::SqpackViewEntryCache::~SqpackViewEntryCache() = default;
+
 void Sqex::Sqpack::Creator::SqpackViewEntryCache::Flush() {
 	m_lastActiveEntry.ClearEntry();
+	if (m_prefetcher)
+		m_prefetcher->Flush();
 }
 
-Sqex::Sqpack::Creator::SqpackViewEntryCache::BufferedEntry* Sqex::Sqpack::Creator::SqpackViewEntryCache::GetBuffer(const DataView * view, const Entry * entry) {
+void Sqex::Sqpack::Creator::SqpackViewEntryCache::Forget(const DataView * view) {
+	if (m_lastActiveEntry.GetEntry().first == view)
+		m_lastActiveEntry.ClearEntry();
+	if (m_prefetcher)
+		m_prefetcher->Forget(view);
+}
+
+Sqex::Sqpack::Creator::SqpackViewEntryCache::BufferedEntry* Sqex::Sqpack::Creator::SqpackViewEntryCache::GetBuffer(const DataView * view, std::span<Entry* const> entries, size_t entryIndex) {
+	const auto entry = entries[entryIndex];
 	if (m_lastActiveEntry.IsEntry(view, entry))
 		return &m_lastActiveEntry;
 
+	if (m_prefetcher)
+		m_prefetcher->OnAccess(view, entries, entryIndex);
+
 	if (entry->EntrySize > LargeEntryBufferSizeMax)
 		return nullptr;
 
+	if (m_prefetcher) {
+		if (auto prefetched = m_prefetcher->Take(view, entry)) {
+			m_lastActiveEntry.SetEntry(view, entry, std::move(*prefetched));
+			return &m_lastActiveEntry;
+		}
+	}
+
 	m_lastActiveEntry.SetEntry(view, entry);
 	return &m_lastActiveEntry;
 }
+
+Sqex::Sqpack::Creator::SqpackViewEntryCache::PrefetchStatistics Sqex::Sqpack::Creator::SqpackViewEntryCache::GetPrefetchStatistics() const {
+	return m_prefetcher ? m_prefetcher->Statistics() : PrefetchStatistics{};
+}
@@ -57,12 +57,14 @@ namespace Sqex::Sqpack {
 		};
 
 		struct SqpackViews {
-			std::shared_ptr<Sqex::RandomAccessStream> Index1;
-			std::shared_ptr<Sqex::RandomAccessStream> Index2;
-			std::vector<std::shared_ptr<Sqex::RandomAccessStream>> Data;
 			std::vector<Entry*> Entries;
 			std::map<EntryPathSpec, std::unique_ptr<Entry>, EntryPathSpec::AllHashComparator> HashOnlyEntries;
 			std::map<EntryPathSpec, std::unique_ptr<Entry>, EntryPathSpec::FullPathComparator> FullPathEntries;
+
+			// Declared after the entries, so that views referring to them are destroyed first.
+			std::shared_ptr<Sqex::RandomAccessStream> Index1;
+			std::shared_ptr<Sqex::RandomAccessStream> Index2;
+			std::vector<std::shared_ptr<Sqex::RandomAccessStream>> Data;
 		};
 
 		class SqpackViewEntryCache {
@@ -97,6 +99,13 @@ namespace Sqex::Sqpack {
 					return std::make_pair(m_view, m_entry);
 				}
 
+				void SetEntry(const DataView* view, const Entry* entry, std::vector<uint8_t>&& prefetched) {
+					m_view = view;
+					m_entry = entry;
+					m_bufferTemporary = std::move(prefetched);
+					m_bufferActive = std::span(m_bufferTemporary);
+				}
+
 				void SetEntry(const DataView* view, const Entry* entry) {
 					m_view = view;
 					m_entry = entry;
@@ -119,12 +128,38 @@ namespace Sqex::Sqpack {
 				}
 			};
 
+			static constexpr uint64_t DefaultPrefetchBudget = (INTPTR_MAX == INT64_MAX ? 256 : 32) * 1048576;
+
+			struct PrefetchStatistics {
+				uint64_t Requested{};
+				uint64_t Completed{};
+				uint64_t Hits{};
+				uint64_t Misses{};
+				uint64_t Claimed{};  // Requested but not started by the time it was needed; read by the caller instead
+				uint64_t Wasted{};
+				uint64_t BytesInUse{};
+
+				[[nodiscard]] double HitRate() const {
+					return Hits + Misses ? static_cast<double>(Hits) / static_cast<double>(Hits + Misses) : 0.;
+				}
+			};
+
 		private:
 			BufferedEntry m_lastActiveEntry;
 
+			class Prefetcher;
+			const std::unique_ptr<Prefetcher> m_prefetcher;
+
 		public:
-			BufferedEntry* GetBuffer(const DataView* view, const Entry* entry);
+			// Set prefetchBudget to 0 to disable background prefetching.
+			SqpackViewEntryCache(uint64_t prefetchBudget = DefaultPrefetchBudget);
+			~SqpackViewEntryCache();
+
+			BufferedEntry* GetBuffer(const DataView* view, std::span<Entry* const> entries, size_t entryIndex);
 			void Flush();
+			void Forget(const DataView* view);
+
+			[[nodiscard]] PrefetchStatistics GetPrefetchStatistics() const;
 		};
 
 		SqpackViews AsViews(bool strict, const std::shared_ptr<SqpackViewEntryCache>& buffer = nullptr);
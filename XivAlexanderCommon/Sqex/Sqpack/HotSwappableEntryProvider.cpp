@@ -14,9 +14,7 @@ Sqex::Sqpack::HotSwappableEntryProvider::HotSwappableEntryProvider(const EntryPa
 std::shared_ptr<const Sqex::Sqpack::EntryProvider> Sqex::Sqpack::HotSwappableEntryProvider::SwapStream(std::shared_ptr<const EntryProvider> newStream /*= nullptr*/) {
 	if (newStream && newStream->StreamSize() > m_reservedSize)
 		throw std::invalid_argument("Provided stream requires more space than reserved size");
-	auto oldStream{ std::move(m_stream) };
-	m_stream = std::move(newStream);
-	return oldStream;
+	return m_stream.exchange(std::move(newStream), std::memory_order_acq_rel);
 }
 
 std::shared_ptr<const Sqex::Sqpack::EntryProvider> Sqex::Sqpack::HotSwappableEntryProvider::GetBaseStream() const {
@@ -33,8 +31,10 @@ uint64_t Sqex::Sqpack::HotSwappableEntryProvider::ReadStreamPartial(uint64_t off
 	if (offset + length > m_reservedSize)
 		length = m_reservedSize - offset;
 
+	// Hold on to a single snapshot so that the size and the data come from the same stream even if it gets swapped mid-read.
+	const auto stream = CurrentStream();
 	auto target = std::span(static_cast<uint8_t*>(buf), static_cast<SSIZE_T>(length));
-	const auto& underlyingStream = m_stream ? *m_stream : m_baseStream ? *m_baseStream : EmptyOrObfuscatedEntryProvider::Instance();
+	const auto& underlyingStream = stream ? *stream : EmptyOrObfuscatedEntryProvider::Instance();
 	const auto underlyingStreamLength = underlyingStream.StreamSize();
 	const auto dataLength = offset < underlyingStreamLength ? std::min(length, underlyingStreamLength - offset) : 0;
 
@@ -50,13 +50,21 @@ uint64_t Sqex::Sqpack::HotSwappableEntryProvider::ReadStreamPartial(uint64_t off
 }
 
 Sqex::Sqpack::SqData::FileEntryType Sqex::Sqpack::HotSwappableEntryProvider::EntryType() const {
-	return m_stream ? m_stream->EntryType() : (m_baseStream ? m_baseStream->EntryType() : EmptyOrObfuscatedEntryProvider::Instance().EntryType());
+	const auto stream = CurrentStream();
+	return stream ? stream->EntryType() : EmptyOrObfuscatedEntryProvider::Instance().EntryType();
 }
 
 std::string Sqex::Sqpack::HotSwappableEntryProvider::DescribeState() const {
+	const auto stream = m_stream.load(std::memory_order_acquire);
 	return std::format("HotSwappableEntryProvider(reserved={}, base={}, override={})",
 		m_reservedSize,
 		m_baseStream ? m_baseStream->DescribeState() : std::string(),
-		m_stream ? m_stream->DescribeState() : std::string());
+		stream ? stream->DescribeState() : std::string());
+}
+
+std::shared_ptr<const Sqex::Sqpack::EntryProvider> Sqex::Sqpack::HotSwappableEntryProvider::CurrentStream() const {
+	if (auto stream = m_stream.load(std::memory_order_acquire))
+		return stream;
+	return m_baseStream;
 }
 
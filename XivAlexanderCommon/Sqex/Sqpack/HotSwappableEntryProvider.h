@@ -1,12 +1,17 @@
 #pragma once
 
+#include <atomic>
+
 #include "XivAlexanderCommon/Sqex/Sqpack/EntryProvider.h"
 
 namespace Sqex::Sqpack {
 	class HotSwappableEntryProvider : public EntryProvider {
 		const uint32_t m_reservedSize;
 		const std::shared_ptr<const EntryProvider> m_baseStream;
-		std::shared_ptr<const EntryProvider> m_stream;
+
+		// Readers take a snapshot through an atomic load and keep it alive for the duration of a read;
+		// a swapped out stream is released once the last in-flight reader drops its reference.
+		std::atomic<std::shared_ptr<const EntryProvider>> m_stream;
 
 	public:
 		HotSwappableEntryProvider(const EntryPathSpec& pathSpec, uint32_t reservedSize, std::shared_ptr<const EntryProvider> stream = nullptr);
@@ -18,5 +23,8 @@ namespace Sqex::Sqpack {
 		uint64_t ReadStreamPartial(uint64_t offset, void* buf, uint64_t length) const override;
 		[[nodiscard]] SqData::FileEntryType EntryType() const override;
 		[[nodiscard]] std::string DescribeState() const override;
+
+	private:
+		[[nodiscard]] std::shared_ptr<const EntryProvider> CurrentStream() const;
 	};
 }
@@ -324,24 +324,21 @@ void Sqex::Sqpack::MemoryModelEntryProvider::Initialize(const RandomAccessStream
 	entryHeader.HeaderSize = Align(static_cast<uint32_t>(sizeof entryHeader + sizeof modelHeader + std::span(paddedBlockSizes).size_bytes()));
 	entryHeader.SetSpaceUnits(entryBody.size());
 
-	m_data.reserve(Align(entryHeader.HeaderSize + entryBody.size()));
-	m_data.insert(m_data.end(), reinterpret_cast<char*>(&entryHeader), reinterpret_cast<char*>(&entryHeader + 1));
-	m_data.insert(m_data.end(), reinterpret_cast<char*>(&modelHeader), reinterpret_cast<char*>(&modelHeader + 1));
+	std::vector<uint8_t> data;
+	data.reserve(Align(entryHeader.HeaderSize + entryBody.size()));
+	data.insert(data.end(), reinterpret_cast<char*>(&entryHeader), reinterpret_cast<char*>(&entryHeader + 1));
+	data.insert(data.end(), reinterpret_cast<char*>(&modelHeader), reinterpret_cast<char*>(&modelHeader + 1));
 	if (!paddedBlockSizes.empty()) {
-		m_data.insert(m_data.end(), reinterpret_cast<char*>(&paddedBlockSizes.front()), reinterpret_cast<char*>(&paddedBlockSizes.back() + 1));
-		m_data.resize(entryHeader.HeaderSize, 0);
-		m_data.insert(m_data.end(), entryBody.begin(), entryBody.end());
+		data.insert(data.end(), reinterpret_cast<char*>(&paddedBlockSizes.front()), reinterpret_cast<char*>(&paddedBlockSizes.back() + 1));
+		data.resize(entryHeader.HeaderSize, 0);
+		data.insert(data.end(), entryBody.begin(), entryBody.end());
 	} else
-		m_data.resize(entryHeader.HeaderSize, 0);
+		data.resize(entryHeader.HeaderSize, 0);
 
-	m_data.resize(Align(m_data.size()));
+	data.resize(Align(data.size()));
+	m_data = TieredEntryDataStore::Instance()->Add(std::move(data));
 }
 
 uint64_t Sqex::Sqpack::MemoryModelEntryProvider::ReadStreamPartial(const RandomAccessStream& stream, uint64_t offset, void* buf, uint64_t length) const {
-	const auto available = static_cast<size_t>(std::min(length, m_data.size() - offset));
-	if (!available)
-		return 0;
-
-	memcpy(buf, &m_data[static_cast<size_t>(offset)], available);
-	return available;
+	return m_data->Read(offset, buf, length);
 }
@@ -366,29 +366,26 @@ void Sqex::Sqpack::MemoryTextureEntryProvider::Initialize(const RandomAccessStre
 		std::span(subBlockSizes).size_bytes()));
 	entryHeader.SetSpaceUnits(texHeaderBytes.size() + entryBody.size());
 
-	m_data.insert(m_data.end(),
+	std::vector<uint8_t> data;
+	data.insert(data.end(),
 		reinterpret_cast<char*>(&entryHeader),
 		reinterpret_cast<char*>(&entryHeader + 1));
-	m_data.insert(m_data.end(),
+	data.insert(data.end(),
 		reinterpret_cast<char*>(&blockLocators.front()),
 		reinterpret_cast<char*>(&blockLocators.back() + 1));
-	m_data.insert(m_data.end(),
+	data.insert(data.end(),
 		reinterpret_cast<char*>(&subBlockSizes.front()),
 		reinterpret_cast<char*>(&subBlockSizes.back() + 1));
-	m_data.resize(entryHeader.HeaderSize);
-	m_data.insert(m_data.end(),
+	data.resize(entryHeader.HeaderSize);
+	data.insert(data.end(),
 		texHeaderBytes.begin(),
 		texHeaderBytes.end());
-	m_data.insert(m_data.end(), entryBody.begin(), entryBody.end());
+	data.insert(data.end(), entryBody.begin(), entryBody.end());
 
-	m_data.resize(Align(m_data.size()));
+	data.resize(Align(data.size()));
+	m_data = TieredEntryDataStore::Instance()->Add(std::move(data));
 }
 
 uint64_t Sqex::Sqpack::MemoryTextureEntryProvider::ReadStreamPartial(const RandomAccessStream& stream, uint64_t offset, void* buf, uint64_t length) const {
-	const auto available = static_cast<size_t>(std::min(length, m_data.size() - offset));
-	if (!available)
-		return 0;
-
-	memcpy(buf, &m_data[static_cast<size_t>(offset)], available);
-	return available;
+	return m_data->Read(offset, buf, length);
 }
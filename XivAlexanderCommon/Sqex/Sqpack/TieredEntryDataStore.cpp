@@ -0,0 +1,357 @@
+#include "pch.h"
+#include "XivAlexanderCommon/Sqex/Sqpack/TieredEntryDataStore.h"
+
+Sqex::Sqpack::TieredEntryDataStore::Item::Item(std::shared_ptr<TieredEntryDataStore> store, std::vector<uint8_t> data)
+	: m_store(std::move(store))
+	, m_size(data.size())
+	, m_raw(std::make_shared<const std::vector<uint8_t>>(std::move(data))) {
+}
+
+Sqex::Sqpack::TieredEntryDataStore::Item::~Item() {
+	auto lock = std::unique_lock(m_store->m_mtx);
+	m_store->m_itemCv.wait(lock, [this]() { return !m_busy; });
+	m_store->Unlink(*this);
+}
+
+uint64_t Sqex::Sqpack::TieredEntryDataStore::Item::Read(uint64_t offset, void* buf, uint64_t length) {
+	if (offset >= m_size)
+		return 0;
+
+	const auto available = static_cast<size_t>(std::min(length, m_size - offset));
+	if (!available)
+		return 0;
+
+	const auto raw = m_store->AcquireRaw(*this);
+	memcpy(buf, &(*raw)[static_cast<size_t>(offset)], available);
+	return available;
+}
+
+Sqex::Sqpack::TieredEntryDataStore::TieredEntryDataStore(uint64_t rawBudget, uint64_t memoryBudget)
+	: m_rawBudget(rawBudget)
+	, m_memoryBudget(std::max(rawBudget, memoryBudget)) {
+}
+
+Sqex::Sqpack::TieredEntryDataStore::~TieredEntryDataStore() = default;
+
+const std::shared_ptr<Sqex::Sqpack::TieredEntryDataStore>& Sqex::Sqpack::TieredEntryDataStore::Instance() {
+	static const auto s_instance = std::make_shared<TieredEntryDataStore>();
+	return s_instance;
+}
+
+std::unique_ptr<Sqex::Sqpack::TieredEntryDataStore::Item> Sqex::Sqpack::TieredEntryDataStore::Add(std::vector<uint8_t> data) {
+	auto item = std::unique_ptr<Item>(new Item(shared_from_this(), std::move(data)));
+
+	const auto lock = std::lock_guard(m_mtx);
+	item->m_lruIterator = m_rawLru.insert(m_rawLru.end(), item.get());
+	m_stats.RawBytes += item->m_size;
+	m_stats.OriginalBytes += item->m_size;
+	m_stats.RawCount++;
+	ScheduleDemotion();
+	return item;
+}
+
+void Sqex::Sqpack::TieredEntryDataStore::SetBudget(uint64_t rawBudget, uint64_t memoryBudget) {
+	const auto lock = std::lock_guard(m_mtx);
+	m_rawBudget = rawBudget;
+	m_memoryBudget = std::max(rawBudget, memoryBudget);
+	ScheduleDemotion();
+}
+
+Sqex::Sqpack::TieredEntryDataStore::Statistics Sqex::Sqpack::TieredEntryDataStore::GetStatistics() const {
+	const auto lock = std::lock_guard(m_mtx);
+	auto stats = m_stats;
+	stats.SpillFileBytes = m_spillFileSize;
+	stats.SpillFileFreeBytes = m_spillFreeBytes;
+	return stats;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> Sqex::Sqpack::TieredEntryDataStore::AcquireRaw(Item& item) {
+	auto lock = std::unique_lock(m_mtx);
+
+	// An item being demoted still has its raw data until the demotion is done, so only wait for promotions.
+	m_itemCv.wait(lock, [&item]() { return item.m_raw || !item.m_busy; });
+	if (item.m_raw) {
+		if (item.m_tier == Tier::Raw)
+			m_rawLru.splice(m_rawLru.end(), m_rawLru, item.m_lruIterator);
+		return item.m_raw;
+	}
+
+	item.m_busy = true;
+	const auto tier = item.m_tier;
+	const auto compressed = item.m_compressed;
+	lock.unlock();
+
+	std::shared_ptr<const std::vector<uint8_t>> raw;
+	try {
+		raw = Expand(item, compressed);
+	} catch (...) {
+		lock.lock();
+		item.m_busy = false;
+		m_itemCv.notify_all();
+		throw;
+	}
+
+	lock.lock();
+	if (tier == Tier::Compressed) {
+		m_compressedLru.erase(item.m_lruIterator);
+		m_stats.CompressedBytes -= item.m_compressed->size();
+		m_stats.CompressedCount--;
+		item.m_compressed.reset();
+	} else {
+		m_stats.SpilledBytes -= item.m_spillLength;
+		m_stats.SpilledCount--;
+	}
+
+	item.m_raw = raw;
+	item.m_tier = Tier::Raw;
+	item.m_lruIterator = m_rawLru.insert(m_rawLru.end(), &item);
+	m_stats.RawBytes += item.m_size;
+	m_stats.RawCount++;
+	m_stats.Promotions++;
+
+	item.m_busy = false;
+	m_itemCv.notify_all();
+	ScheduleDemotion();
+	return raw;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> Sqex::Sqpack::TieredEntryDataStore::Expand(const Item& item, std::shared_ptr<const std::vector<uint8_t>> compressed) const {
+	if (!compressed) {
+		auto spilled = std::vector<uint8_t>(item.m_spillLength);
+		m_spillFile.Read(item.m_spillOffset, std::span(spilled));
+		compressed = std::make_shared<const std::vector<uint8_t>>(std::move(spilled));
+	}
+
+	if (item.m_incompressible)
+		return compressed;
+
+	auto raw = std::vector<uint8_t>(static_cast<size_t>(item.m_size));
+	const auto decompressed = LZ4_decompress_safe(
+		reinterpret_cast<const char*>(&(*compressed)[0]), reinterpret_cast<char*>(&raw[0]),
+		static_cast<int>(compressed->size()), static_cast<int>(raw.size()));
+	if (decompressed != static_cast<int>(item.m_size))
+		throw std::runtime_error(std::format("TieredEntryDataStore: LZ4_decompress_safe returned {} (expected {})", decompressed, item.m_size));
+	return std::make_shared<const std::vector<uint8_t>>(std::move(raw));
+}
+
+void Sqex::Sqpack::TieredEntryDataStore::Unlink(Item& item) {
+	switch (item.m_tier) {
+		case Tier::Raw:
+			m_rawLru.erase(item.m_lruIterator);
+			m_stats.RawBytes -= item.m_size;
+			m_stats.RawCount--;
+			break;
+
+		case Tier::Compressed:
+			m_compressedLru.erase(item.m_lruIterator);
+			m_stats.CompressedBytes -= item.m_compressed->size();
+			m_stats.CompressedCount--;
+			break;
+
+		case Tier::Spilled:
+			m_stats.SpilledBytes -= item.m_spillLength;
+			m_stats.SpilledCount--;
+			break;
+	}
+	m_stats.OriginalBytes -= item.m_size;
+
+	if (item.m_spillOffset != UINT64_MAX)
+		FreeSpillRange(item.m_spillOffset, item.m_spillLength);
+}
+
+bool Sqex::Sqpack::TieredEntryDataStore::IsOverBudget() const {
+	return m_stats.RawBytes > m_rawBudget || m_stats.RawBytes + m_stats.CompressedBytes > m_memoryBudget;
+}
+
+void Sqex::Sqpack::TieredEntryDataStore::ScheduleDemotion() {
+	if (m_demotionScheduled || !IsOverBudget())
+		return;
+
+	const auto ctx = new std::shared_ptr<TieredEntryDataStore>(shared_from_this());
+	if (!TrySubmitThreadpoolCallback([](PTP_CALLBACK_INSTANCE, void* ctx) {
+		const auto self = std::unique_ptr<std::shared_ptr<TieredEntryDataStore>>(static_cast<std::shared_ptr<TieredEntryDataStore>*>(ctx));
+		(*self)->Demote();
+	}, ctx, nullptr)) {
+		// Try again on the next state change.
+		delete ctx;
+		return;
+	}
+	m_demotionScheduled = true;
+}
+
+void Sqex::Sqpack::TieredEntryDataStore::Demote() {
+	auto lock = std::unique_lock(m_mtx);
+	const auto findIdle = [](const std::list<Item*>& lru, const Item* exclude) -> Item* {
+		for (const auto item : lru) {
+			if (item == exclude)
+				break;
+			if (!item->m_busy)
+				return item;
+		}
+		return nullptr;
+	};
+
+	try {
+		while (true) {
+			// The most recently used item is never demoted, so that an item larger than the budget does not get demoted on every read.
+			const auto mostRecent = m_rawLru.empty() ? nullptr : m_rawLru.back();
+
+			if (m_stats.RawBytes > m_rawBudget) {
+				if (const auto item = findIdle(m_rawLru, mostRecent)) {
+					Compress(*item, lock);
+					continue;
+				}
+			}
+
+			if (m_stats.RawBytes + m_stats.CompressedBytes > m_memoryBudget) {
+				if (const auto item = findIdle(m_compressedLru, nullptr)) {
+					Spill(*item, lock);
+					continue;
+				}
+				if (const auto item = findIdle(m_rawLru, mostRecent)) {
+					Compress(*item, lock);
+					continue;
+				}
+			}
+			break;
+		}
+	} catch (...) {
+		// Nothing to report to; the item stays where it was, and gets another chance on the next state change.
+	}
+	m_demotionScheduled = false;
+}
+
+void Sqex::Sqpack::TieredEntryDataStore::Compress(Item& item, std::unique_lock<std::mutex>& lock) {
+	item.m_busy = true;
+	const auto raw = item.m_raw;
+	lock.unlock();
+
+	auto compressed = raw;
+	try {
+		if (!item.m_size)
+			item.m_incompressible = true;
+		if (!item.m_incompressible) {
+			auto buffer = std::vector<uint8_t>(LZ4_compressBound(static_cast<int>(item.m_size)));
+			const auto compressedSize = LZ4_compress_default(
+				reinterpret_cast<const char*>(&(*raw)[0]), reinterpret_cast<char*>(&buffer[0]),
+				static_cast<int>(item.m_size), static_cast<int>(buffer.size()));
+			if (compressedSize <= 0 || static_cast<uint64_t>(compressedSize) >= item.m_size)
+				item.m_incompressible = true;
+			else {
+				buffer.resize(compressedSize);
+				buffer.shrink_to_fit();
+				compressed = std::make_shared<const std::vector<uint8_t>>(std::move(buffer));
+			}
+		}
+	} catch (...) {
+		lock.lock();
+		item.m_busy = false;
+		m_itemCv.notify_all();
+		throw;
+	}
+
+	lock.lock();
+	m_rawLru.erase(item.m_lruIterator);
+	m_stats.RawBytes -= item.m_size;
+	m_stats.RawCount--;
+
+	item.m_raw.reset();
+	item.m_compressed = std::move(compressed);
+	item.m_tier = Tier::Compressed;
+	item.m_lruIterator = m_compressedLru.insert(m_compressedLru.end(), &item);
+	m_stats.CompressedBytes += item.m_compressed->size();
+	m_stats.CompressedCount++;
+	m_stats.Demotions++;
+
+	item.m_busy = false;
+	m_itemCv.notify_all();
+}
+
+void Sqex::Sqpack::TieredEntryDataStore::Spill(Item& item, std::unique_lock<std::mutex>& lock) {
+	// Entry data never changes, so a previously written copy can be reused as-is.
+	if (item.m_spillOffset == UINT64_MAX) {
+		item.m_busy = true;
+		const auto compressed = item.m_compressed;
+		const auto offset = AllocateSpillRange(compressed->size());
+		lock.unlock();
+
+		try {
+			if (!m_spillFile) {
+				std::wstring tempDir(MAX_PATH + 1, L'\0');
+				tempDir.resize(GetTempPathW(static_cast<DWORD>(tempDir.size()), &tempDir[0]));
+				std::wstring tempPath(MAX_PATH + 1, L'\0');
+				if (!GetTempFileNameW(tempDir.c_str(), L"xas", 0, &tempPath[0]))
+					throw Utils::Win32::Error("GetTempFileNameW");
+				tempPath.resize(wcslen(tempPath.c_str()));
+				m_spillFile = Utils::Win32::Handle::FromCreateFile(tempPath, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE);
+			}
+			m_spillFile.Write(offset, std::span(*compressed));
+		} catch (...) {
+			lock.lock();
+			FreeSpillRange(offset, compressed->size());
+			item.m_busy = false;
+			m_itemCv.notify_all();
+			throw;
+		}
+
+		lock.lock();
+		item.m_spillOffset = offset;
+		item.m_spillLength = static_cast<uint32_t>(compressed->size());
+		item.m_busy = false;
+		m_itemCv.notify_all();
+	}
+
+	m_compressedLru.erase(item.m_lruIterator);
+	m_stats.CompressedBytes -= item.m_compressed->size();
+	m_stats.CompressedCount--;
+	item.m_compressed.reset();
+
+	item.m_tier = Tier::Spilled;
+	m_stats.SpilledBytes += item.m_spillLength;
+	m_stats.SpilledCount++;
+	m_stats.Demotions++;
+}
+
+uint64_t Sqex::Sqpack::TieredEntryDataStore::AllocateSpillRange(uint64_t length) {
+	for (auto it = m_spillFreeRanges.begin(); it != m_spillFreeRanges.end(); ++it) {
+		const auto [offset, available] = *it;
+		if (available < length)
+			continue;
+
+		m_spillFreeRanges.erase(it);
+		if (available > length)
+			m_spillFreeRanges.emplace(offset + length, available - length);
+		m_spillFreeBytes -= length;
+		return offset;
+	}
+
+	const auto offset = m_spillFileSize;
+	m_spillFileSize += length;
+	return offset;
+}
+
+void Sqex::Sqpack::TieredEntryDataStore::FreeSpillRange(uint64_t offset, uint64_t length) {
+	if (!length)
+		return;
+
+	m_spillFreeBytes += length;
+	auto it = m_spillFreeRanges.emplace(offset, length).first;
+	if (const auto next = std::next(it); next != m_spillFreeRanges.end() && it->first + it->second == next->first) {
+		it->second += next->second;
+		m_spillFreeRanges.erase(next);
+	}
+	if (it != m_spillFreeRanges.begin()) {
+		if (const auto prev = std::prev(it); prev->first + prev->second == it->first) {
+			prev->second += it->second;
+			m_spillFreeRanges.erase(it);
+			it = prev;
+		}
+	}
+
+	// A free range at the end is not a hole; the file just gets written from there again.
+	if (it->first + it->second == m_spillFileSize) {
+		m_spillFileSize = it->first;
+		m_spillFreeBytes -= it->second;
+		m_spillFreeRanges.erase(it);
+	}
+}
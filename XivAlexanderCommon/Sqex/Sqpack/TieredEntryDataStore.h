@@ -0,0 +1,119 @@
+#pragma once
+
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "XivAlexanderCommon/Utils/Win32/Handle.h"
+
+namespace Sqex::Sqpack {
+	/*
+	 * Holds fully built entry data for Memory*EntryProvider under a global memory budget.
+	 * - Raw: plain bytes, most recently used ones are kept here.
+	 * - Compressed: LZ4 compressed bytes, demoted from Raw in least recently used order.
+	 * - Spilled: only exists in a temporary file, demoted from Compressed in least recently used order.
+	 * Reading from an item promotes it back to Raw.
+	 *
+	 * m_mtx is held only while an item changes tiers or LRU position; compression, decompression, and spill file I/O happen
+	 * outside of it, while the item is marked busy. Demotion runs on the process thread pool whenever a budget is exceeded.
+	 */
+	class TieredEntryDataStore : public std::enable_shared_from_this<TieredEntryDataStore> {
+	public:
+		static constexpr uint64_t DefaultRawBudget = (INTPTR_MAX == INT64_MAX ? 512 : 64) * 1048576;
+		static constexpr uint64_t DefaultMemoryBudget = (INTPTR_MAX == INT64_MAX ? 1024 : 128) * 1048576;
+
+		enum class Tier {
+			Raw,
+			Compressed,
+			Spilled,
+		};
+
+		struct Statistics {
+			uint64_t RawBytes{};
+			uint64_t CompressedBytes{};
+			uint64_t SpilledBytes{};
+			uint64_t OriginalBytes{};
+			size_t RawCount{};
+			size_t CompressedCount{};
+			size_t SpilledCount{};
+			uint64_t Promotions{};
+			uint64_t Demotions{};
+			uint64_t SpillFileBytes{};
+			uint64_t SpillFileFreeBytes{};  // Left by released items, and reused for later spills
+		};
+
+		class Item {
+			friend class TieredEntryDataStore;
+
+			const std::shared_ptr<TieredEntryDataStore> m_store;
+			const uint64_t m_size;
+
+			// Guarded by m_store->m_mtx. While m_busy is set, only the thread that set it may change the item.
+			Tier m_tier = Tier::Raw;
+			bool m_busy = false;
+			std::shared_ptr<const std::vector<uint8_t>> m_raw;  // Readers keep their own reference while copying out of it
+			std::shared_ptr<const std::vector<uint8_t>> m_compressed;
+			bool m_incompressible = false;
+			uint64_t m_spillOffset = UINT64_MAX;
+			uint32_t m_spillLength = 0;
+			std::list<Item*>::iterator m_lruIterator;
+
+			Item(std::shared_ptr<TieredEntryDataStore> store, std::vector<uint8_t> data);
+
+		public:
+			Item(const Item&) = delete;
+			Item(Item&&) = delete;
+			Item& operator=(const Item&) = delete;
+			Item& operator=(Item&&) = delete;
+			~Item();
+
+			[[nodiscard]] uint64_t Size() const { return m_size; }
+			uint64_t Read(uint64_t offset, void* buf, uint64_t length);
+		};
+
+	private:
+		mutable std::mutex m_mtx;
+		std::condition_variable m_itemCv;  // Notified whenever an item stops being busy
+		uint64_t m_rawBudget;
+		uint64_t m_memoryBudget;
+
+		std::list<Item*> m_rawLru;  // least recently used first
+		std::list<Item*> m_compressedLru;  // least recently demoted first
+		bool m_demotionScheduled = false;
+
+		Utils::Win32::Handle m_spillFile;  // Created once by the demotion worker, and never replaced
+		uint64_t m_spillFileSize = 0;
+		std::map<uint64_t, uint64_t> m_spillFreeRanges;  // offset -> length; adjacent ranges are always merged
+		uint64_t m_spillFreeBytes = 0;
+
+		Statistics m_stats;
+
+	public:
+		TieredEntryDataStore(uint64_t rawBudget = DefaultRawBudget, uint64_t memoryBudget = DefaultMemoryBudget);
+		~TieredEntryDataStore();
+
+		static const std::shared_ptr<TieredEntryDataStore>& Instance();
+
+		[[nodiscard]] std::unique_ptr<Item> Add(std::vector<uint8_t> data);
+
+		void SetBudget(uint64_t rawBudget, uint64_t memoryBudget);
+		[[nodiscard]] Statistics GetStatistics() const;
+
+	private:
+		std::shared_ptr<const std::vector<uint8_t>> AcquireRaw(Item& item);
+		std::shared_ptr<const std::vector<uint8_t>> Expand(const Item& item, std::shared_ptr<const std::vector<uint8_t>> compressed) const;
+		void Unlink(Item& item);
+
+		[[nodiscard]] bool IsOverBudget() const;
+		void ScheduleDemotion();
+		void Demote();
+		void Compress(Item& item, std::unique_lock<std::mutex>& lock);
+		void Spill(Item& item, std::unique_lock<std::mutex>& lock);
+
+		uint64_t AllocateSpillRange(uint64_t length);
+		void FreeSpillRange(uint64_t offset, uint64_t length);
+	};
+}
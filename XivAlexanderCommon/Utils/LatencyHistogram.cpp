@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "XivAlexanderCommon/Utils/LatencyHistogram.h"
+
+#include <bit>
+#include <cmath>
+
+size_t Utils::LatencyHistogram::IndexOf(uint64_t magnitude) {
+	if (magnitude < SubBucketCount)
+		return static_cast<size_t>(magnitude);
+
+	const auto shift = static_cast<size_t>(std::bit_width(magnitude)) - SubBucketBits;
+	const auto index = SubBucketCount + (shift - 1) * SubBucketHalfCount + static_cast<size_t>(magnitude >> shift) - SubBucketHalfCount;
+	return (std::min)(index, BucketCount - 1);
+}
+
+uint64_t Utils::LatencyHistogram::LowestMagnitudeAt(size_t index) {
+	if (index < SubBucketCount)
+		return index;
+
+	index -= SubBucketCount;
+	const auto shift = index / SubBucketHalfCount + 1;
+	return static_cast<uint64_t>(index % SubBucketHalfCount + SubBucketHalfCount) << shift;
+}
+
+uint64_t Utils::LatencyHistogram::HighestMagnitudeAt(size_t index) {
+	if (index < SubBucketCount)
+		return index;
+	if (index == BucketCount - 1)
+		return INT64_MAX;
+
+	return LowestMagnitudeAt(index + 1) - 1;
+}
+
+double Utils::LatencyHistogram::Snapshot::Mean() const {
+	return m_count ? static_cast<double>(m_sum) / static_cast<double>(m_count) : 0.;
+}
+
+int64_t Utils::LatencyHistogram::Snapshot::ValueAtPercentile(double percentile) const {
+	if (!m_count)
+		return 0;
+
+	const auto target = (std::max)(uint64_t{ 1 }, static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0., 100.) / 100. * static_cast<double>(m_count))));
+	auto result = m_max;
+	auto seen = uint64_t{};
+	ForEachBucket([&](int64_t, int64_t high, uint64_t count) {
+		if (seen < target && (seen += count) >= target)
+			result = high;
+	});
+	return std::clamp(result, m_min, m_max);
+}
+
+nlohmann::json Utils::LatencyHistogram::Snapshot::ToJson() const {
+	auto buckets = nlohmann::json::array();
+	ForEachBucket([&](int64_t low, int64_t high, uint64_t count) {
+		buckets.push_back(nlohmann::json::array({ low, high, count }));
+	});
+
+	auto percentiles = nlohmann::json::object();
+	for (const auto percentile : { 50., 90., 99., 99.9, 99.99 })
+		percentiles[std::format("{}", percentile)] = ValueAtPercentile(percentile);
+
+	return nlohmann::json::object({
+		{"count", m_count},
+		{"min", m_count ? m_min : 0},
+		{"max", m_count ? m_max : 0},
+		{"mean", Mean()},
+		{"percentiles", std::move(percentiles)},
+		{"buckets", std::move(buckets)},
+	});
+}
+
+void Utils::LatencyHistogram::Snapshot::WriteCsv(std::ostream& out, std::string_view prefix) const {
+	ForEachBucket([&](int64_t low, int64_t high, uint64_t count) {
+		out << std::format("{},{},{},{}\n", prefix, low, high, count);
+	});
+}
+
+Utils::LatencyHistogram::LatencyHistogram(bool allowNegative)
+	: m_positive(std::make_unique<std::atomic<uint64_t>[]>(BucketCount))
+	, m_negative(allowNegative ? std::make_unique<std::atomic<uint64_t>[]>(BucketCount) : nullptr) {
+	Reset();
+}
+
+Utils::LatencyHistogram::~LatencyHistogram() = default;
+
+void Utils::LatencyHistogram::Record(int64_t value) {
+	if (value < 0 && !m_negative)
+		value = 0;
+
+	if (value < 0)
+		m_negative[IndexOf(0 - static_cast<uint64_t>(value))].fetch_add(1, std::memory_order_relaxed);
+	else
+		m_positive[IndexOf(static_cast<uint64_t>(value))].fetch_add(1, std::memory_order_relaxed);
+
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(value, std::memory_order_relaxed);
+
+	for (auto prev = m_min.load(std::memory_order_relaxed); value < prev && !m_min.compare_exchange_weak(prev, value, std::memory_order_relaxed);) {}
+	for (auto prev = m_max.load(std::memory_order_relaxed); value > prev && !m_max.compare_exchange_weak(prev, value, std::memory_order_relaxed);) {}
+}
+
+void Utils::LatencyHistogram::Reset() {
+	for (size_t i = 0; i < BucketCount; ++i) {
+		m_positive[i].store(0, std::memory_order_relaxed);
+		if (m_negative)
+			m_negative[i].store(0, std::memory_order_relaxed);
+	}
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_min.store(INT64_MAX, std::memory_order_relaxed);
+	m_max.store(INT64_MIN, std::memory_order_relaxed);
+}
+
+uint64_t Utils::LatencyHistogram::Count() const {
+	return m_count.load(std::memory_order_relaxed);
+}
+
+Utils::LatencyHistogram::Snapshot Utils::LatencyHistogram::TakeSnapshot() const {
+	Snapshot result;
+	result.m_sum = m_sum.load(std::memory_order_relaxed);
+	result.m_min = m_min.load(std::memory_order_relaxed);
+	result.m_max = m_max.load(std::memory_order_relaxed);
+
+	// Count is taken from the copied buckets, so that percentiles stay consistent even if values are being recorded meanwhile.
+	result.m_positive.resize(BucketCount);
+	for (size_t i = 0; i < BucketCount; ++i)
+		result.m_count += result.m_positive[i] = m_positive[i].load(std::memory_order_relaxed);
+	if (m_negative) {
+		result.m_negative.resize(BucketCount);
+		for (size_t i = 0; i < BucketCount; ++i)
+			result.m_count += result.m_negative[i] = m_negative[i].load(std::memory_order_relaxed);
+	}
+	if (result.m_count && result.m_min > result.m_max)
+		result.m_min = result.m_max = 0;
+	return result;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace Utils {
+	/*
+	 * Log-linear histogram of integer values, in the spirit of HdrHistogram.
+	 * Magnitudes below SubBucketCount are counted exactly; every power of two range above is split into
+	 * SubBucketHalfCount buckets, so the relative error of any reported value stays under 1 / SubBucketHalfCount.
+	 *
+	 * Storage is allocated on construction, and recording is a few relaxed atomic operations,
+	 * so values can be recorded from any thread without locking or allocating.
+	 * Negative values are counted in a mirrored set of buckets if enabled; otherwise they are recorded as zero.
+	 */
+	class LatencyHistogram {
+	public:
+		static constexpr size_t SubBucketBits = 7;
+		static constexpr size_t MaxValueBits = 40;  // Larger magnitudes are counted in the last bucket
+		static constexpr size_t SubBucketCount = size_t{ 1 } << SubBucketBits;
+		static constexpr size_t SubBucketHalfCount = SubBucketCount / 2;
+		static constexpr size_t BucketCount = SubBucketCount + (MaxValueBits - SubBucketBits) * SubBucketHalfCount;
+
+		[[nodiscard]] static size_t IndexOf(uint64_t magnitude);
+		[[nodiscard]] static uint64_t LowestMagnitudeAt(size_t index);
+		[[nodiscard]] static uint64_t HighestMagnitudeAt(size_t index);
+
+		class Snapshot {
+			friend class LatencyHistogram;
+
+			uint64_t m_count = 0;
+			int64_t m_sum = 0;
+			int64_t m_min = 0;
+			int64_t m_max = 0;
+			std::vector<uint64_t> m_positive;
+			std::vector<uint64_t> m_negative;
+
+		public:
+			[[nodiscard]] uint64_t Count() const { return m_count; }
+			[[nodiscard]] int64_t Sum() const { return m_sum; }
+			[[nodiscard]] int64_t Min() const { return m_min; }
+			[[nodiscard]] int64_t Max() const { return m_max; }
+			[[nodiscard]] double Mean() const;
+
+			// Highest value equivalent to the value at the given percentile (0 to 100), clamped to [Min, Max].
+			[[nodiscard]] int64_t ValueAtPercentile(double percentile) const;
+
+			// Calls fn(lowestValue, highestValue, count) for every non-empty bucket, in ascending order of values.
+			template<typename Fn>
+			void ForEachBucket(const Fn& fn) const {
+				for (size_t i = m_negative.size(); i-- > 0;) {
+					if (m_negative[i])
+						fn(-static_cast<int64_t>(HighestMagnitudeAt(i)), -static_cast<int64_t>(LowestMagnitudeAt(i)), m_negative[i]);
+				}
+				for (size_t i = 0; i < m_positive.size(); ++i) {
+					if (m_positive[i])
+						fn(static_cast<int64_t>(LowestMagnitudeAt(i)), static_cast<int64_t>(HighestMagnitudeAt(i)), m_positive[i]);
+				}
+			}
+
+			[[nodiscard]] nlohmann::json ToJson() const;
+
+			// Writes one "prefix,low,high,count" line per non-empty bucket.
+			void WriteCsv(std::ostream& out, std::string_view prefix) const;
+		};
+
+	private:
+		const std::unique_ptr<std::atomic<uint64_t>[]> m_positive;
+		const std::unique_ptr<std::atomic<uint64_t>[]> m_negative;
+		std::atomic<uint64_t> m_count = 0;
+		std::atomic<int64_t> m_sum = 0;
+		std::atomic<int64_t> m_min = INT64_MAX;
+		std::atomic<int64_t> m_max = INT64_MIN;
+
+	public:
+		LatencyHistogram(bool allowNegative = false);
+		LatencyHistogram(const LatencyHistogram&) = delete;
+		LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+		~LatencyHistogram();
+
+		void Record(int64_t value);
+		void Reset();
+
+		[[nodiscard]] uint64_t Count() const;
+		[[nodiscard]] Snapshot TakeSnapshot() const;
+	};
+}
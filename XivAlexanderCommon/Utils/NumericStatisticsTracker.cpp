@@ -1,37 +1,218 @@
 #include "pch.h"
 #include "XivAlexanderCommon/Utils/NumericStatisticsTracker.h"
+
+#include <cmath>
+#include <thread>
+
 #include "XivAlexanderCommon/Utils/Utils.h"
 
-Utils::NumericStatisticsTracker::Entry::Entry(int64_t value, int64_t maxAgeUs)
-	: Value(value)
-	, TimestampUs(Utils::QpcUs())
-	, ExpiryUs(maxAgeUs == INT64_MAX ? INT64_MAX : TimestampUs + maxAgeUs) {
+class Utils::NumericStatisticsTracker::Snapshot {
+	const NumericStatisticsTracker& m_tracker;
+	const uint64_t m_added;
+	const size_t m_count;
+	const uint64_t m_sum;
+	const uint64_t m_squareSum;
+
+public:
+	const int64_t PublishedMin;
+	const int64_t PublishedMax;
+	const int64_t PublishedMedian;
+
+	Snapshot(const NumericStatisticsTracker& tracker)
+		: m_tracker(tracker)
+		, m_added(tracker.m_added.load(std::memory_order_relaxed))
+		, m_count(static_cast<size_t>(std::min<uint64_t>(m_added, std::min(tracker.m_trackCount, tracker.m_count.load(std::memory_order_relaxed)))))
+		, m_sum(tracker.m_sum.load(std::memory_order_relaxed))
+		, m_squareSum(tracker.m_squareSum.load(std::memory_order_relaxed))
+		, PublishedMin(tracker.m_min.load(std::memory_order_relaxed))
+		, PublishedMax(tracker.m_max.load(std::memory_order_relaxed))
+		, PublishedMedian(tracker.m_median.load(std::memory_order_relaxed)) {
+	}
+
+	[[nodiscard]] size_t Count() const {
+		return m_count;
+	}
+
+	// Index 0 is the oldest value.
+	[[nodiscard]] const Slot& operator[](size_t index) const {
+		return m_tracker.m_slots[(m_added - m_count + index) % m_tracker.m_trackCount];
+	}
+
+	// Index of the first value that has not expired at nowUs and has been added no earlier than sinceUs.
+	// Both conditions hold for a suffix, as timestamps only increase.
+	[[nodiscard]] size_t Begin(int64_t sinceUs, int64_t nowUs) const {
+		size_t lo = 0, hi = m_count;
+		while (lo < hi) {
+			const auto mid = lo + (hi - lo) / 2;
+			const auto& slot = (*this)[mid];
+			if (slot.ExpiryUs.load(std::memory_order_relaxed) < nowUs || slot.TimestampUs.load(std::memory_order_relaxed) < sinceUs)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo;
+	}
+
+	[[nodiscard]] uint64_t SumFrom(size_t index) const {
+		return m_sum - (*this)[index].SumBefore.load(std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] uint64_t SquareSumFrom(size_t index) const {
+		return m_squareSum - (*this)[index].SquareSumBefore.load(std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] int64_t Value(size_t index) const {
+		return (*this)[index].Value.load(std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] int64_t TimestampUs(size_t index) const {
+		return (*this)[index].TimestampUs.load(std::memory_order_relaxed);
+	}
+};
+
+template<typename Fn>
+auto Utils::NumericStatisticsTracker::Read(const Fn& fn) const {
+	// Values only expire if a maximum age is set; skip reading the clock otherwise.
+	const auto nowUs = m_maxAgeUs == INT64_MAX ? INT64_MIN : Utils::QpcUs();
+
+	while (true) {
+		const auto sequence = m_sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		auto result = fn(Snapshot(*this), nowUs);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_sequence.load(std::memory_order_relaxed) == sequence)
+			return result;
+	}
 }
 
 Utils::NumericStatisticsTracker::NumericStatisticsTracker(size_t trackCount, int64_t emptyValue, int64_t maxAgeUs)
-	: m_trackCount(trackCount)
+	: m_trackCount(std::max<size_t>(1, trackCount))
 	, m_emptyValue(emptyValue)
-	, m_maxAgeUs(maxAgeUs) {
+	, m_maxAgeUs(maxAgeUs)
+	, m_slots(std::make_unique<Slot[]>(m_trackCount))
+	, m_sortedIterators(m_trackCount)
+	, m_lowerMedian(m_sorted.end()) {
 }
 
 Utils::NumericStatisticsTracker::~NumericStatisticsTracker() = default;
 
-void Utils::NumericStatisticsTracker::AddValue(int64_t v) {
-	{
-		const auto lock = std::lock_guard(m_mtx);
-		m_values.emplace_back(v, m_maxAgeUs);
+void Utils::NumericStatisticsTracker::BeginWrite() {
+	m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+void Utils::NumericStatisticsTracker::EndWrite() {
+	m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+Utils::NumericStatisticsTracker::SortedSet::node_type Utils::NumericStatisticsTracker::RemoveOldest() {
+	const auto count = m_count.load(std::memory_order_relaxed);
+	const auto it = m_sortedIterators[(m_added.load(std::memory_order_relaxed) - count) % m_trackCount];
+	m_count.store(count - 1, std::memory_order_relaxed);
+
+	// Keep m_lowerMedian at index (size - 1) / 2 of what remains.
+	const auto size = m_sorted.size();
+	if (size == 1)
+		m_lowerMedian = m_sorted.end();
+	else if (it == m_lowerMedian)
+		m_lowerMedian = size % 2 ? std::prev(m_lowerMedian) : std::next(m_lowerMedian);
+	else if (*it < *m_lowerMedian) {
+		if (size % 2 == 0)
+			++m_lowerMedian;
+	} else if (size % 2)
+		--m_lowerMedian;
+	return m_sorted.extract(it);
+}
+
+void Utils::NumericStatisticsTracker::InsertSorted(size_t slotIndex, int64_t value, SortedSet::node_type node) {
+	const auto key = std::make_pair(value, m_added.load(std::memory_order_relaxed));
+	SortedSet::iterator it;
+	if (node) {
+		node.value() = key;
+		it = m_sorted.insert(std::move(node)).position;
+	} else
+		it = m_sorted.emplace(key).first;
+	m_sortedIterators[slotIndex] = it;
+
+	// Keep m_lowerMedian at index (size - 1) / 2.
+	const auto size = m_sorted.size();
+	if (size == 1)
+		m_lowerMedian = it;
+	else if (key < *m_lowerMedian) {
+		if (size % 2 == 0)
+			--m_lowerMedian;
+	} else if (size % 2)
+		++m_lowerMedian;
+}
+
+void Utils::NumericStatisticsTracker::RemoveExpired(int64_t nowUs) {
+	while (const auto count = m_count.load(std::memory_order_relaxed)) {
+		if (m_slots[(m_added.load(std::memory_order_relaxed) - count) % m_trackCount].ExpiryUs.load(std::memory_order_relaxed) >= nowUs)
+			break;
+		RemoveOldest();
 	}
-	void(RemoveExpired(m_values.back().TimestampUs));
 }
 
-const std::deque<Utils::NumericStatisticsTracker::Entry>& Utils::NumericStatisticsTracker::RemoveExpired(int64_t nowUs) const {
-	const auto lock = std::lock_guard(m_mtx);
-	while (!m_values.empty() && (
-		m_values.size() > m_trackCount || 
-		m_values.front().ExpiryUs < nowUs
-	))
-		m_values.pop_front();
-	return m_values;
+void Utils::NumericStatisticsTracker::UpdateOrderStatistics() {
+	if (m_sorted.empty())
+		return;
+
+	m_min.store(m_sorted.begin()->first, std::memory_order_relaxed);
+	m_max.store(m_sorted.rbegin()->first, std::memory_order_relaxed);
+	if (m_sorted.size() % 2 == 0) {
+		// even
+		m_median.store((m_lowerMedian->first + std::next(m_lowerMedian)->first) / 2, std::memory_order_relaxed);
+	} else {
+		// odd
+		m_median.store(m_lowerMedian->first, std::memory_order_relaxed);
+	}
+}
+
+void Utils::NumericStatisticsTracker::AddValue(int64_t v) {
+	const auto lock = std::lock_guard(m_writeMtx);
+	const auto nowUs = Utils::QpcUs();
+
+	BeginWrite();
+	SortedSet::node_type reusedNode;
+	if (m_count.load(std::memory_order_relaxed) == m_trackCount)
+		reusedNode = RemoveOldest();
+
+	const auto added = m_added.load(std::memory_order_relaxed);
+	const auto sum = m_sum.load(std::memory_order_relaxed);
+	const auto squareSum = m_squareSum.load(std::memory_order_relaxed);
+	auto& slot = m_slots[added % m_trackCount];
+	slot.Value.store(v, std::memory_order_relaxed);
+	slot.TimestampUs.store(nowUs, std::memory_order_relaxed);
+	slot.ExpiryUs.store(m_maxAgeUs == INT64_MAX ? INT64_MAX : nowUs + m_maxAgeUs, std::memory_order_relaxed);
+	slot.SumBefore.store(sum, std::memory_order_relaxed);
+	slot.SquareSumBefore.store(squareSum, std::memory_order_relaxed);
+	m_sum.store(sum + static_cast<uint64_t>(v), std::memory_order_relaxed);
+	m_squareSum.store(squareSum + static_cast<uint64_t>(v) * static_cast<uint64_t>(v), std::memory_order_relaxed);
+	InsertSorted(added % m_trackCount, v, std::move(reusedNode));
+	m_added.store(added + 1, std::memory_order_relaxed);
+	m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	RemoveExpired(nowUs);
+	UpdateOrderStatistics();
+	EndWrite();
+}
+
+void Utils::NumericStatisticsTracker::Clear() {
+	const auto lock = std::lock_guard(m_writeMtx);
+	BeginWrite();
+	m_count.store(0, std::memory_order_relaxed);
+	m_sorted.clear();
+	m_lowerMedian = m_sorted.end();
+	EndWrite();
+}
+
+bool Utils::NumericStatisticsTracker::Empty() const {
+	return !Count();
 }
 
 int64_t Utils::NumericStatisticsTracker::InvalidValue() const {
@@ -39,102 +220,94 @@ int64_t Utils::NumericStatisticsTracker::InvalidValue() const {
 }
 
 int64_t Utils::NumericStatisticsTracker::Latest() const {
-	const auto vals = RemoveExpired();
-	if (vals.empty())
-		return m_emptyValue;
-	return vals.back().Value;
+	return Read([this](const Snapshot& s, int64_t nowUs) {
+		if (s.Begin(0, nowUs) == s.Count())
+			return m_emptyValue;
+		return s.Value(s.Count() - 1);
+	});
 }
 
 int64_t Utils::NumericStatisticsTracker::Min(int64_t sinceUs) const {
-	const auto vals = RemoveExpired();
-	auto found = false;
-	int64_t minValue{};
-	for (const auto& v : std::ranges::reverse_view(vals)) {
-		if (v.TimestampUs < sinceUs)
-			break;
-		if (!found || minValue > v.Value)
-			minValue = v.Value;
-		found = true;
-	}
-	return found ? minValue : m_emptyValue;
+	return Read([this, sinceUs](const Snapshot& s, int64_t nowUs) {
+		const auto begin = s.Begin(sinceUs, nowUs);
+		if (begin == s.Count())
+			return m_emptyValue;
+		if (begin == 0)
+			return s.PublishedMin;
+
+		auto minValue = s.Value(begin);
+		for (auto i = begin + 1; i < s.Count(); ++i)
+			minValue = std::min(minValue, s.Value(i));
+		return minValue;
+	});
 }
 
 int64_t Utils::NumericStatisticsTracker::Max(int64_t sinceUs) const {
-	const auto vals = RemoveExpired();
-	auto found = false;
-	int64_t maxValue{};
-	for (const auto& v : std::ranges::reverse_view(vals)) {
-		if (v.TimestampUs < sinceUs)
-			break;
-		if (!found || maxValue < v.Value)
-			maxValue = v.Value;
-		found = true;
-	}
-	return found ? maxValue : m_emptyValue;
+	return Read([this, sinceUs](const Snapshot& s, int64_t nowUs) {
+		const auto begin = s.Begin(sinceUs, nowUs);
+		if (begin == s.Count())
+			return m_emptyValue;
+		if (begin == 0)
+			return s.PublishedMax;
+
+		auto maxValue = s.Value(begin);
+		for (auto i = begin + 1; i < s.Count(); ++i)
+			maxValue = std::max(maxValue, s.Value(i));
+		return maxValue;
+	});
 }
 
 int64_t Utils::NumericStatisticsTracker::Median(int64_t sinceUs) const {
-	const auto vals = RemoveExpired();
+	return Read([this, sinceUs](const Snapshot& s, int64_t nowUs) {
+		const auto begin = s.Begin(sinceUs, nowUs);
+		if (begin == s.Count())
+			return m_emptyValue;
+		if (begin == 0)
+			return s.PublishedMedian;
 
-	std::vector<int64_t> sorted;
-	sorted.reserve(vals.size());
-	for (const auto& v : std::ranges::reverse_view(vals)) {
-		if (v.TimestampUs < sinceUs)
-			break;
-		sorted.emplace_back(v.Value);
-	}
-	if (sorted.empty())
-		return m_emptyValue;
-	std::ranges::sort(sorted);
+		std::vector<int64_t> values;
+		values.reserve(s.Count() - begin);
+		for (auto i = begin; i < s.Count(); ++i)
+			values.emplace_back(s.Value(i));
 
-	if (sorted.size() % 2 == 0) {
-		// even
-		return (sorted[sorted.size() / 2] + sorted[sorted.size() / 2 - 1]) / 2;
-	} else {
-		// odd
-		return sorted[sorted.size() / 2];
-	}
+		const auto upper = values.begin() + values.size() / 2;
+		std::ranges::nth_element(values, upper);
+		if (values.size() % 2 == 0) {
+			// even
+			return (*upper + *std::max_element(values.begin(), upper)) / 2;
+		} else {
+			// odd
+			return *upper;
+		}
+	});
 }
 
 int64_t Utils::NumericStatisticsTracker::Mean(int64_t sinceUs) const {
-	const auto vals = RemoveExpired();
-	int64_t count = 0;
-	int64_t acc{};
-	for (const auto& v : std::ranges::reverse_view(vals)) {
-		if (v.TimestampUs < sinceUs)
-			break;
-		acc += v.Value;
-		++count;
-	}
-	return count ? acc / count : m_emptyValue;
+	return Read([this, sinceUs](const Snapshot& s, int64_t nowUs) {
+		const auto begin = s.Begin(sinceUs, nowUs);
+		const auto count = static_cast<int64_t>(s.Count() - begin);
+		return count ? static_cast<int64_t>(s.SumFrom(begin)) / count : m_emptyValue;
+	});
 }
 
 std::pair<int64_t, int64_t> Utils::NumericStatisticsTracker::MeanAndDeviation(int64_t sinceUs) const {
-	const auto vals = RemoveExpired();
+	return Read([this, sinceUs](const Snapshot& s, int64_t nowUs) -> std::pair<int64_t, int64_t> {
+		const auto begin = s.Begin(sinceUs, nowUs);
+		const auto count = static_cast<int64_t>(s.Count() - begin);
+		const auto acc = static_cast<int64_t>(s.SumFrom(begin));
 
-	int64_t count = 0;
-	int64_t acc{};
-	for (const auto& v : std::ranges::reverse_view(vals)) {
-		if (v.TimestampUs < sinceUs)
-			break;
-		acc += v.Value;
-		++count;
-	}
+		if (count == 0)
+			return {m_emptyValue, 0};
+		if (count == 1)
+			return {acc, 0};
+		const auto mean = acc / count;
 
-	if (count == 0)
-		return {m_emptyValue, 0};
-	if (count == 1)
-		return {acc, 0};
-	const auto mean = acc / count;
+		// sum((v - mean)^2) = sum(v^2) - 2 * mean * sum(v) + count * mean^2
+		const auto umean = static_cast<uint64_t>(mean);
+		const auto diffSquaredSum = static_cast<int64_t>(s.SquareSumFrom(begin) - 2 * umean * static_cast<uint64_t>(acc) + static_cast<uint64_t>(count) * umean * umean);
 
-	int64_t diffSquaredSum = 0;
-	for (const auto& v : std::ranges::reverse_view(vals)) {
-		if (v.TimestampUs < sinceUs)
-			break;
-		diffSquaredSum += (v.Value - mean) * (v.Value - mean);
-	}
-
-	return {mean, static_cast<int64_t>(std::sqrt(diffSquaredSum / count))};
+		return {mean, static_cast<int64_t>(std::sqrt(diffSquaredSum / count))};
+	});
 }
 
 int64_t Utils::NumericStatisticsTracker::Deviation(int64_t sinceUs) const {
@@ -142,45 +315,34 @@ int64_t Utils::NumericStatisticsTracker::Deviation(int64_t sinceUs) const {
 }
 
 size_t Utils::NumericStatisticsTracker::Count(int64_t sinceUs) const {
-	const auto vals = RemoveExpired();
-	if (!sinceUs)
-		return vals.size();
-
-	size_t count = 0;
-	for (const auto& v : std::ranges::reverse_view(vals)) {
-		if (v.TimestampUs < sinceUs)
-			break;
-		++count;
-	}
-	return count;
+	return Read([sinceUs](const Snapshot& s, int64_t nowUs) {
+		return s.Count() - s.Begin(sinceUs, nowUs);
+	});
 }
 
 int64_t Utils::NumericStatisticsTracker::NextBlankInUs() const {
-	const auto s = RemoveExpired();
-	if (s.size() < m_trackCount)
-		return 0;
-	return s.front().Value - Entry(0, 0).Value;
+	return Read([this](const Snapshot& s, int64_t nowUs) -> int64_t {
+		const auto begin = s.Begin(0, nowUs);
+		if (s.Count() - begin < m_trackCount)
+			return 0;
+		return s.Value(begin);
+	});
 }
 
 double Utils::NumericStatisticsTracker::CountFractional(int64_t sinceUs) const {
-	const auto vals = RemoveExpired();
-	if (!sinceUs)
-		return static_cast<double>(vals.size());
-
-	size_t count = 0;
-	int64_t lastTimestamp = INT64_MIN;
-	for (const auto& v : std::ranges::reverse_view(vals)) {
-		if (v.TimestampUs < sinceUs) {
-			if (lastTimestamp != INT64_MIN) {
-				const auto window = lastTimestamp - v.TimestampUs;
-				const auto elapsed = sinceUs - v.TimestampUs;
-				if (window > elapsed)
-					return static_cast<double>(count) + static_cast<double>(elapsed) / static_cast<double>(window);
-			}
-			break;
+	return Read([sinceUs](const Snapshot& s, int64_t nowUs) {
+		const auto validBegin = s.Begin(0, nowUs);
+		if (!sinceUs)
+			return static_cast<double>(s.Count() - validBegin);
+
+		const auto begin = s.Begin(sinceUs, nowUs);
+		const auto count = s.Count() - begin;
+		if (begin > validBegin && begin < s.Count()) {
+			const auto window = s.TimestampUs(begin) - s.TimestampUs(begin - 1);
+			const auto elapsed = sinceUs - s.TimestampUs(begin - 1);
+			if (window > elapsed)
+				return static_cast<double>(count) + static_cast<double>(elapsed) / static_cast<double>(window);
 		}
-		++count;
-		lastTimestamp = v.TimestampUs;
-	}
-	return static_cast<double>(count);
+		return static_cast<double>(count);
+	});
 }
@@ -1,37 +1,73 @@
 #pragma once
 
-#include <deque>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
 #include "XivAlexanderCommon/Utils/Utils.h"
 
 namespace Utils {
+	/*
+	 * Keeps the latest values in a fixed size ring, along with running sums and an ordered set of the values,
+	 * so that statistics of the whole window are available without scanning it.
+	 * Adding a value is O(log n); once the window is full, the node of the value that leaves the window is reused.
+	 *
+	 * Writers are serialized with a mutex. Readers never lock; they read under a sequence counter and retry if a
+	 * writer has been active in the meantime.
+	 */
 	class NumericStatisticsTracker {
 		const size_t m_trackCount;
 		const int64_t m_emptyValue;
 		const int64_t m_maxAgeUs;
 
-		struct Entry {
-			const int64_t Value;
-			const int64_t TimestampUs;
-			const int64_t ExpiryUs;
+		struct Slot {
+			std::atomic<int64_t> Value;
+			std::atomic<int64_t> TimestampUs;
+			std::atomic<int64_t> ExpiryUs;
 
-			Entry(int64_t value, int64_t maxAgeUs);
+			// Running sums of all values added before this one. Wrapping arithmetic keeps differences exact.
+			std::atomic<uint64_t> SumBefore;
+			std::atomic<uint64_t> SquareSumBefore;
 		};
 
-		mutable std::mutex m_mtx;
-		mutable std::deque<Entry> m_values;
+		const std::unique_ptr<Slot[]> m_slots;
+		std::atomic<uint64_t> m_sequence = 0;  // Odd while a writer is modifying the content
+		std::atomic<uint64_t> m_added = 0;  // Number of values ever added; the newest value is at (m_added - 1) % m_trackCount
+		std::atomic<size_t> m_count = 0;
+		std::atomic<uint64_t> m_sum = 0;
+		std::atomic<uint64_t> m_squareSum = 0;
+		std::atomic<int64_t> m_min = 0;
+		std::atomic<int64_t> m_max = 0;
+		std::atomic<int64_t> m_median = 0;
+
+		// Only touched by writers. Keys are (value, number of values added before), so that equal values are still ordered.
+		using SortedSet = std::set<std::pair<int64_t, uint64_t>>;
+		std::mutex m_writeMtx;
+		SortedSet m_sorted;
+		std::vector<SortedSet::iterator> m_sortedIterators;  // Indexed like m_slots
+		SortedSet::iterator m_lowerMedian;  // Element at index (size - 1) / 2
+
+		class Snapshot;
+
+		void BeginWrite();
+		void EndWrite();
+		SortedSet::node_type RemoveOldest();
+		void RemoveExpired(int64_t nowUs);
+		void InsertSorted(size_t slotIndex, int64_t value, SortedSet::node_type node);
+		void UpdateOrderStatistics();
+
+		template<typename Fn>
+		auto Read(const Fn& fn) const;
 
 	public:
 		NumericStatisticsTracker(size_t trackCount, int64_t emptyValue, int64_t maxAgeUs = INT64_MAX);
 		~NumericStatisticsTracker();
 
 		void AddValue(int64_t);
-		void Clear() { m_values.clear(); };
-		bool Empty() const { return m_values.empty(); }
-
-	private:
-		[[nodiscard]] const std::deque<Entry>& RemoveExpired(int64_t nowUs = Utils::QpcUs()) const;
+		void Clear();
+		[[nodiscard]] bool Empty() const;
 
-	public:
 		[[nodiscard]] int64_t InvalidValue() const;
 		[[nodiscard]] int64_t Latest() const;
 		[[nodiscard]] int64_t Min(int64_t sinceUs = 0) const;
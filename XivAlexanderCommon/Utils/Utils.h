@@ -1,9 +1,11 @@
 #pragma once
 
 #include <cinttypes>
+#include <string>
+#ifdef _WIN32
 #include <inaddr.h>
 #include <minwinbase.h>
-#include <string>
+#endif
 #include <nlohmann/json.hpp>
 
 namespace Utils {
@@ -100,12 +102,16 @@ namespace Utils {
 		}
 	};
 
+#ifdef _WIN32
 	SYSTEMTIME EpochToLocalSystemTime(int64_t epochMilliseconds);
+#endif
 	int64_t QpcUs();
 
 	int CompareSockaddr(const void* x, const void* y);
 
+#ifdef _WIN32
 	in_addr ParseIp(const std::string& s);
+#endif
 	uint16_t ParsePort(const std::string& s);
 
 	std::vector<std::pair<uint32_t, uint32_t>> ParseIpRange(const std::string& s, bool allowAll, bool allowPrivate, bool allowLoopback);
@@ -135,7 +141,9 @@ namespace Utils {
 		ClearStdContainer(std::forward<Args>(args)...);
 	}
 
+#ifdef _WIN32
 	std::map<std::pair<char32_t, char32_t>, SSIZE_T> ParseKerningTable(std::span<const char> data, const std::map<uint16_t, char32_t>& GlyphIndexToCharCodeMap);
+#endif
 
 	nlohmann::json ParseJsonFromFile(const std::filesystem::path& path, size_t maxSize = 1024 * 1024 * 16);
 	void SaveJsonToFile(const std::filesystem::path& path, const nlohmann::json& json);
@@ -1,6 +1,10 @@
 #include "pch.h"
 #include "XivAlexanderCommon/Utils/Win32/ThreadPool.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
 static DWORD GetNumberOfProcessors() {
 	SYSTEM_INFO sysInfo;
 	GetNativeSystemInfo(&sysInfo);
@@ -93,3 +97,58 @@ void Utils::Win32::TpEnvironment::Cancel() {
 
 	m_cancelling = false;
 }
+
+void Utils::Win32::ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+	struct State {
+		const std::function<void(size_t)>* Fn;
+		size_t Count;
+		std::atomic<size_t> Next = 0;
+		std::mutex Mtx;
+		std::condition_variable Cv;
+		size_t Done = 0;
+		std::exception_ptr Error;
+
+		void Drain() {
+			for (size_t i; (i = Next++) < Count;) {
+				std::exception_ptr error;
+				try {
+					(*Fn)(i);
+				} catch (...) {
+					error = std::current_exception();
+				}
+
+				const auto lock = std::lock_guard(Mtx);
+				if (error && !Error)
+					Error = error;
+				if (++Done == Count)
+					Cv.notify_all();
+			}
+		}
+	};
+
+	if (count == 0)
+		return;
+
+	const auto state = std::make_shared<State>();
+	state->Fn = &fn;
+	state->Count = count;
+
+	const auto helperCount = std::min<size_t>(count, std::max(1U, std::thread::hardware_concurrency())) - 1;
+	for (size_t i = 0; i < helperCount; ++i) {
+		const auto ctx = new std::shared_ptr<State>(state);
+		if (!TrySubmitThreadpoolCallback([](PTP_CALLBACK_INSTANCE, void* ctx) {
+			const auto state = std::unique_ptr<std::shared_ptr<State>>(static_cast<std::shared_ptr<State>*>(ctx));
+			(*state)->Drain();
+		}, ctx, nullptr)) {
+			delete ctx;
+			break;
+		}
+	}
+
+	state->Drain();
+
+	auto lock = std::unique_lock(state->Mtx);
+	state->Cv.wait(lock, [&state]() { return state->Done == state->Count; });
+	if (state->Error)
+		std::rethrow_exception(state->Error);
+}
@@ -27,4 +27,9 @@ namespace Utils::Win32 {
 		void WaitOutstanding();
 		void Cancel();
 	};
+
+	// Calls fn(0) to fn(count - 1) and returns when all of them are done.
+	// Idle threads of the process thread pool pick up whatever the calling thread has not gotten to yet,
+	// so the calling thread never waits for a helper that has not started.
+	void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
 }
\ No newline at end of file
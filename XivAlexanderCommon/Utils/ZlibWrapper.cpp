@@ -114,14 +114,20 @@ Utils::ZlibReusableDeflater::~ZlibReusableDeflater() {
 		deflateEnd(&m_zstream);
 }
 
+size_t Utils::ZlibReusableDeflater::Bound(size_t sourceSize) {
+	// Without an initialized stream, zlib gives a bound that holds for any parameters.
+	return deflateBound(m_initialized ? &m_zstream : nullptr, static_cast<uLong>(sourceSize));
+}
+
 std::span<uint8_t> Utils::ZlibReusableDeflater::Deflate(std::span<const uint8_t> source) {
 	Initialize();
 
 	m_zstream.next_in = &source[0];
 	m_zstream.avail_in = static_cast<uint32_t>(source.size());
 
-	if (m_buffer.size() < m_defaultBufferSize)
-		m_buffer.resize(m_defaultBufferSize);
+	// Size the buffer so that it usually completes in a single pass; it is kept for later calls.
+	if (const auto bound = std::max(m_defaultBufferSize, static_cast<size_t>(deflateBound(&m_zstream, static_cast<uLong>(source.size())))); m_buffer.size() < bound)
+		m_buffer.resize(std::bit_ceil(bound));
 	while (true) {
 		m_zstream.next_out = &m_buffer[m_zstream.total_out];
 		m_zstream.avail_out = static_cast<uint32_t>(m_buffer.size() - m_zstream.total_out);
@@ -138,3 +144,17 @@ std::span<uint8_t> Utils::ZlibReusableDeflater::Deflate(std::span<const uint8_t>
 
 	return m_latestResult = std::span(m_buffer).subspan(0, m_zstream.total_out);
 }
+
+std::span<uint8_t> Utils::ZlibReusableDeflater::Deflate(std::span<const uint8_t> source, std::span<uint8_t> target) {
+	Initialize();
+
+	m_zstream.next_in = &source[0];
+	m_zstream.avail_in = static_cast<uint32_t>(source.size());
+	m_zstream.next_out = &target[0];
+	m_zstream.avail_out = static_cast<uint32_t>(target.size());
+
+	if (const auto res = deflate(&m_zstream, Z_FINISH); res != Z_STREAM_END)
+		throw ZlibError(res == Z_OK ? Z_BUF_ERROR : res);
+
+	return m_latestResult = target.subspan(0, m_zstream.total_out);
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <bit>
 #include <stdexcept>
 #include <vector>
 #include <zlib.h>
@@ -11,20 +12,20 @@ namespace Utils {
 		explicit ZlibError(int returnCode);
 	};
 
-	using OodleNetwork1_Shared_Size = int(__stdcall)(int htbits);
-	using OodleNetwork1_Shared_SetWindow = void(__stdcall)(void* data, int htbits, void* window, int windowSize);
-	using OodleNetwork1UDP_Train = void(__stdcall)(void* state, void* shared, const void* const* trainingPacketPointers, const int* trainingPacketSizes, int trainingPacketCount);
-	using OodleNetwork1UDP_Decode = bool(__stdcall)(void* state, void* shared, const void* compressed, size_t compressedSize, void* raw, size_t rawSize);
-	using OodleNetwork1UDP_Encode = int(__stdcall)(const void* state, const void* shared, const void* raw, size_t rawSize, void* compressed);
-	using OodleNetwork1UDP_State_Size = int(__stdcall)();
+	using OodleNetwork1_Shared_Size = int __stdcall(int htbits);
+	using OodleNetwork1_Shared_SetWindow = void __stdcall(void* data, int htbits, void* window, int windowSize);
+	using OodleNetwork1UDP_Train = void __stdcall(void* state, void* shared, const void* const* trainingPacketPointers, const int* trainingPacketSizes, int trainingPacketCount);
+	using OodleNetwork1UDP_Decode = bool __stdcall(void* state, void* shared, const void* compressed, size_t compressedSize, void* raw, size_t rawSize);
+	using OodleNetwork1UDP_Encode = int __stdcall(const void* state, const void* shared, const void* raw, size_t rawSize, void* compressed);
+	using OodleNetwork1UDP_State_Size = int __stdcall();
 
 	struct OodleNetworkFunctions {
-		OodleNetwork1_Shared_Size* OodleNetwork1_Shared_Size;
-		OodleNetwork1_Shared_SetWindow* OodleNetwork1_Shared_SetWindow;
-		OodleNetwork1UDP_Train* OodleNetwork1UDP_Train;
-		OodleNetwork1UDP_Decode* OodleNetwork1UDP_Decode;
-		OodleNetwork1UDP_Encode* OodleNetwork1UDP_Encode;
-		OodleNetwork1UDP_State_Size* OodleNetwork1UDP_State_Size;
+		Utils::OodleNetwork1_Shared_Size* OodleNetwork1_Shared_Size;
+		Utils::OodleNetwork1_Shared_SetWindow* OodleNetwork1_Shared_SetWindow;
+		Utils::OodleNetwork1UDP_Train* OodleNetwork1UDP_Train;
+		Utils::OodleNetwork1UDP_Decode* OodleNetwork1UDP_Decode;
+		Utils::OodleNetwork1UDP_Encode* OodleNetwork1UDP_Encode;
+		Utils::OodleNetwork1UDP_State_Size* OodleNetwork1UDP_State_Size;
 		int htbits = 0;
 		bool found = false;
 	};
@@ -39,6 +40,13 @@ namespace Utils {
 		std::vector<uint8_t> m_window;
 		
 		std::vector<uint8_t> m_buffer;
+
+		// Grows in powers of two and never shrinks, so that buffers are not reallocated or cleared for every call.
+		std::span<uint8_t> Scratch(size_t length) {
+			if (m_buffer.size() < length)
+				m_buffer.resize(std::bit_ceil(length));
+			return std::span(m_buffer).subspan(0, length);
+		}
 		
 	public:
 		Oodler(const OodleNetworkFunctions& funcs)
@@ -54,23 +62,34 @@ namespace Utils {
 			}
 		}
 
+		// Incompressible input may come out slightly bigger than it was.
+		static size_t EncodeBound(size_t rawSize) {
+			return rawSize + rawSize / 4 + 256;
+		}
+
 		std::span<uint8_t> decode(std::span<const uint8_t> source, size_t decodedLength) {
 			if (!m_funcs.found)
 				throw std::runtime_error("Oodle not initialized");
-			m_buffer.resize(decodedLength);
-			if (!m_funcs.OodleNetwork1UDP_Decode(&m_state[0], &m_shared[0], &source[0], static_cast<int>(source.size()), &m_buffer[0], static_cast<int>(decodedLength)))
+			const auto target = Scratch(decodedLength);
+			if (!m_funcs.OodleNetwork1UDP_Decode(&m_state[0], &m_shared[0], &source[0], static_cast<int>(source.size()), target.data(), static_cast<int>(decodedLength)))
 				throw std::runtime_error("OodleNetwork1UDP_Decode error");
-			return std::span(m_buffer);
+			return target;
 		}
 
 		std::span<uint8_t> encode(std::span<const uint8_t> source) {
+			return encode(source, Scratch(EncodeBound(source.size())));
+		}
+
+		/// \param target Must be at least EncodeBound(source.size()) bytes long.
+		std::span<uint8_t> encode(std::span<const uint8_t> source, std::span<uint8_t> target) {
 			if (!m_funcs.found)
 				throw std::runtime_error("Oodle not initialized");
-			m_buffer.resize(source.size());
-			const auto size = m_funcs.OodleNetwork1UDP_Encode(&m_state[0], &m_shared[0], &source[0], static_cast<int>(source.size()), &m_buffer[0]);
+			if (target.size() < EncodeBound(source.size()))
+				throw std::invalid_argument("Target buffer too small");
+			const auto size = m_funcs.OodleNetwork1UDP_Encode(&m_state[0], &m_shared[0], &source[0], static_cast<int>(source.size()), target.data());
 			if (!size)
 				throw std::runtime_error("OodleNetwork1UDP_Encode error");
-			return std::span(m_buffer).subspan(0, size);
+			return target.subspan(0, size);
 		}
 	};
 
@@ -121,8 +140,14 @@ namespace Utils {
 
 		~ZlibReusableDeflater();
 
+		/// \brief Upper bound of the size of data Deflate can produce from sourceSize bytes.
+		size_t Bound(size_t sourceSize);
+
 		std::span<uint8_t> Deflate(std::span<const uint8_t> source);
 
+		/// \brief Deflates into target in one pass. Throws if target is smaller than needed; use Bound to size it.
+		std::span<uint8_t> Deflate(std::span<const uint8_t> source, std::span<uint8_t> target);
+
 		std::span<uint8_t> operator()(std::span<const uint8_t> source) {
 			return Deflate(source);
 		}
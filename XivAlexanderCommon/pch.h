@@ -63,6 +63,7 @@
 #include <curlpp/Easy.hpp>
 #include <curlpp/Options.hpp>
 #include <freetype/freetype.h>
+#include <lz4.h>
 #include <nlohmann/json.hpp>
 #include <srell.hpp>
 #include <vorbis/codec.h>